@@ -0,0 +1,516 @@
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <cstdlib>
+
+#include "dynamics/SkeletonDynamics.h"
+#include "dynamics/ConstraintDynamics.h"
+#include "kinematics/FileInfoSkel.hpp"
+#include "utils/Paths.h"
+#include "utils/Timer.h"
+#include "math/UtilsMath.h"
+#include "simulation/World.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using namespace std;
+using namespace Eigen;
+using namespace kinematics;
+using namespace dynamics;
+
+// Random pose and velocity of all the dofs
+void randomState(SkeletonDynamics* _skel, VectorXd& _q, VectorXd& _qdot)
+{
+    int nDof = _skel->getNumDofs();
+    _q.resize(nDof);
+    _qdot.resize(nDof);
+    for (int i = 0; i < nDof; i++)
+    {
+        _q[i] = math::random(-1.0, 1.0);
+        _qdot[i] = math::random(-5.0, 5.0);
+    }
+}
+
+// Prints the times per iteration of a baseline and a new method, given in
+// seconds, the speedup and the largest difference of their results unless it
+// is negative
+void report(const string& _name, const string& _baseName, double _baseTime,
+            const string& _newName, double _newTime, double _maxDiff = -1.0)
+{
+    bool ms = min(_baseTime, _newTime) >= 1.0e-3;
+    double scale = ms ? 1.0e3 : 1.0e6;
+    const char* unit = ms ? " ms" : " us";
+    int width = max(max(_baseName.size(), _newName.size()), string("speedup").size());
+    cout << _name << endl;
+    cout << "  " << left << setw(width) << _baseName << ": " << _baseTime * scale << unit << endl;
+    cout << "  " << left << setw(width) << _newName << ": " << _newTime * scale << unit << endl;
+    cout << "  " << left << setw(width) << "speedup" << ": " << _baseTime / _newTime << endl;
+    if (_maxDiff >= 0.0)
+        cout << "  max difference: " << _maxDiff << endl;
+}
+
+// Mass matrix assembly: composite rigid body algorithm vs. per-node J^T*M*J
+void benchmarkMassMatrix(SkeletonDynamics* _skel, int _iterations)
+{
+    Vector3d gravity(0.0, -9.81, 0.0);
+    int nDof = _skel->getNumDofs();
+    VectorXd q, qdot;
+    randomState(_skel, q, qdot);
+    _skel->setPose(q, false, false);
+    _skel->computeDynamics(gravity, qdot, true, false, false);
+
+    utils::Timer jacobianTimer("mass matrix (Jacobians)");
+    _skel->setUseCRBA(false);
+    jacobianTimer.startTimer();
+    for (int i = 0; i < _iterations; i++)
+        _skel->computeMassMatrix(false);
+    jacobianTimer.stopTimer();
+    MatrixXd Mjacobian = _skel->getMassMatrix();
+
+    utils::Timer crbaTimer("mass matrix (CRBA)");
+    _skel->setUseCRBA(true);
+    crbaTimer.startTimer();
+    for (int i = 0; i < _iterations; i++)
+        _skel->computeMassMatrix(false);
+    crbaTimer.stopTimer();
+    MatrixXd Mcrba = _skel->getMassMatrix();
+
+    ostringstream name;
+    name << "Mass matrix, " << nDof << " dofs, " << _iterations << " iterations";
+    report(name.str(), "Jacobians", jacobianTimer.lastElapsed() / _iterations,
+           "CRBA", crbaTimer.lastElapsed() / _iterations, (Mjacobian - Mcrba).cwiseAbs().maxCoeff());
+}
+
+// M^{-1}*J^T for a 3-row Jacobian: tree-sparse LTL solve vs. dense inverse
+void benchmarkMassSolve(SkeletonDynamics* _skel, int _iterations)
+{
+    Vector3d gravity(0.0, -9.81, 0.0);
+    int nDof = _skel->getNumDofs();
+    VectorXd q, qdot;
+    randomState(_skel, q, qdot);
+    MatrixXd Jt(nDof, 3);
+    for (int i = 0; i < nDof; i++)
+        for (int j = 0; j < 3; j++)
+            Jt(i, j) = math::random(-1.0, 1.0);
+    _skel->setPose(q, false, false);
+    _skel->computeDynamics(gravity, qdot, true, false, true);
+
+    utils::Timer denseTimer("mass solve (dense inverse)");
+    MatrixXd Xdense;
+    denseTimer.startTimer();
+    for (int i = 0; i < _iterations; i++)
+    {
+        MatrixXd MInv = _skel->getMassMatrix().ldlt().solve(MatrixXd::Identity(nDof, nDof));
+        Xdense = MInv * Jt;
+    }
+    denseTimer.stopTimer();
+
+    utils::Timer treeTimer("mass solve (tree LTL)");
+    MatrixXd Xtree;
+    treeTimer.startTimer();
+    for (int i = 0; i < _iterations; i++)
+    {
+        _skel->factorizeMassMatrix();
+        Xtree = _skel->solveMassMatrixMultiple(Jt);
+    }
+    treeTimer.stopTimer();
+
+    ostringstream name;
+    name << "Mass solve M^-1*J^T, " << nDof << " dofs, " << _iterations << " iterations";
+    report(name.str(), "dense inverse", denseTimer.lastElapsed() / _iterations,
+           "tree LTL", treeTimer.lastElapsed() / _iterations, (Xdense - Xtree).cwiseAbs().maxCoeff());
+}
+
+// Operational space inertia of two end effectors: tree LTL solve vs. dense
+// inverse of M
+void benchmarkTaskDynamics(SkeletonDynamics* _skel, int _iterations)
+{
+    Vector3d gravity(0.0, -9.81, 0.0);
+    int nDof = _skel->getNumDofs();
+    VectorXd q, qdot;
+    randomState(_skel, q, qdot);
+    _skel->setPose(q, false, false);
+    _skel->computeDynamics(gravity, qdot, true, false, true);
+
+    vector<BodyNode*> nodes;
+    vector<Vector3d> offsets;
+    nodes.push_back(_skel->getNode(_skel->getNumNodes() - 1));
+    nodes.push_back(_skel->getNode(_skel->getNumNodes() / 2));
+    offsets.resize(nodes.size(), Vector3d::Zero());
+    _skel->computeTaskDynamics(nodes, offsets, true);
+    MatrixXd J = _skel->getTaskJacobian();
+
+    utils::Timer denseTimer("task inertia (dense inverse)");
+    MatrixXd LambdaDense;
+    denseTimer.startTimer();
+    for (int i = 0; i < _iterations; i++)
+    {
+        MatrixXd MInv = _skel->getMassMatrix().ldlt().solve(MatrixXd::Identity(nDof, nDof));
+        LambdaDense = (J * MInv * J.transpose()).inverse();
+    }
+    denseTimer.stopTimer();
+
+    utils::Timer treeTimer("task inertia (tree LTL)");
+    treeTimer.startTimer();
+    for (int i = 0; i < _iterations; i++)
+    {
+        _skel->factorizeMassMatrix();
+        _skel->computeTaskDynamics(nodes, offsets, true);
+    }
+    treeTimer.stopTimer();
+
+    ostringstream name;
+    name << "Task dynamics, " << J.rows() << " task rows, " << nDof << " dofs, " << _iterations << " iterations";
+    report(name.str(), "dense inverse", denseTimer.lastElapsed() / _iterations,
+           "tree LTL", treeTimer.lastElapsed() / _iterations, (LambdaDense - _skel->getTaskInertia()).cwiseAbs().maxCoeff());
+}
+
+// dtau/dq and dtau/dqdot: analytical derivatives vs. central differences of
+// the recursive inverse dynamics
+void benchmarkDynamicsDerivatives(SkeletonDynamics* _skel, int _iterations)
+{
+    Vector3d gravity(0.0, -9.81, 0.0);
+    int nDof = _skel->getNumDofs();
+    VectorXd q, qdot;
+    randomState(_skel, q, qdot);
+    VectorXd qdd(nDof);
+    for (int i = 0; i < nDof; i++)
+        qdd[i] = math::random(-5.0, 5.0);
+
+    utils::Timer diffTimer("dynamics derivatives (central differences)");
+    double h = 1.0e-6;
+    MatrixXd dtaudq(nDof, nDof);
+    MatrixXd dtaudqdot(nDof, nDof);
+    VectorXd tauPlus, tauMinus;
+    diffTimer.startTimer();
+    for (int i = 0; i < _iterations; i++)
+    {
+        for (int j = 0; j < nDof; j++)
+        {
+            VectorXd dq = VectorXd::Unit(nDof, j) * h;
+            _skel->setPose(q + dq, true, false);
+            _skel->computeInverseDynamicsLinear(gravity, &qdot, &qdd, tauPlus, false, false);
+            _skel->setPose(q - dq, true, false);
+            _skel->computeInverseDynamicsLinear(gravity, &qdot, &qdd, tauMinus, false, false);
+            dtaudq.col(j) = (tauPlus - tauMinus) / (2.0 * h);
+
+            _skel->setPose(q, true, false);
+            VectorXd qdotPlus = qdot + dq;
+            VectorXd qdotMinus = qdot - dq;
+            _skel->computeInverseDynamicsLinear(gravity, &qdotPlus, &qdd, tauPlus, false, false);
+            _skel->computeInverseDynamicsLinear(gravity, &qdotMinus, &qdd, tauMinus, false, false);
+            dtaudqdot.col(j) = (tauPlus - tauMinus) / (2.0 * h);
+        }
+    }
+    diffTimer.stopTimer();
+
+    utils::Timer analyticTimer("dynamics derivatives (analytical)");
+    _skel->setPose(q, true, false);
+    analyticTimer.startTimer();
+    for (int i = 0; i < _iterations; i++)
+        _skel->computeInverseDynamicsDerivatives(gravity, qdot, qdd);
+    analyticTimer.stopTimer();
+
+    ostringstream name;
+    name << "Inverse dynamics derivatives, " << nDof << " dofs, " << _iterations << " iterations";
+    report(name.str(), "central differences", diffTimer.lastElapsed() / _iterations,
+           "analytical", analyticTimer.lastElapsed() / _iterations,
+           max((dtaudq - _skel->getTorqueDerivPose()).cwiseAbs().maxCoeff(),
+               (dtaudqdot - _skel->getTorqueDerivVelocity()).cwiseAbs().maxCoeff()));
+}
+
+// Root translation prescribed, the rest simulated: hybrid articulated body
+// algorithm vs. a dense solve with M and Cg
+void benchmarkHybridDynamics(SkeletonDynamics* _skel, int _iterations)
+{
+    Vector3d gravity(0.0, -9.81, 0.0);
+    int nDof = _skel->getNumDofs();
+    VectorXd q, qdot;
+    randomState(_skel, q, qdot);
+    VectorXd tau = VectorXd::Zero(nDof);
+    Vector3d rootAccel(1.0, 0.0, -2.0);
+    for (int i = 3; i < nDof; i++)
+        tau[i] = math::random(-10.0, 10.0);
+    _skel->setPose(q, false, false);
+
+    utils::Timer denseTimer("hybrid dynamics (dense)");
+    VectorXd qddotDense;
+    denseTimer.startTimer();
+    for (int i = 0; i < _iterations; i++)
+    {
+        _skel->computeDynamics(gravity, qdot, true, false, true);
+        MatrixXd A = _skel->getMassMatrix();
+        A.block(0, 0, 3, nDof).setZero();
+        A.block(0, 0, 3, 3).setIdentity();
+        A.block(3, 0, nDof - 3, 3).setZero();
+        VectorXd b = tau - _skel->getCombinedVector() - _skel->getMassMatrix().leftCols(3) * rootAccel;
+        b.head(3) = rootAccel;
+        qddotDense = A.partialPivLu().solve(b);
+    }
+    denseTimer.stopTimer();
+
+    utils::Timer abaTimer("hybrid dynamics (ABA)");
+    std::vector<bool> prescribed(nDof, false);
+    prescribed[0] = prescribed[1] = prescribed[2] = true;
+    VectorXd qddotABA = VectorXd::Zero(nDof);
+    VectorXd tauABA = tau;
+    abaTimer.startTimer();
+    for (int i = 0; i < _iterations; i++)
+    {
+        qddotABA.head(3) = rootAccel;
+        tauABA.tail(nDof - 3) = tau.tail(nDof - 3);
+        _skel->computeHybridDynamics(gravity, qdot, prescribed, qddotABA, tauABA);
+    }
+    abaTimer.stopTimer();
+
+    ostringstream name;
+    name << "Hybrid dynamics, " << nDof << " dofs, " << _iterations << " iterations";
+    report(name.str(), "dense", denseTimer.lastElapsed() / _iterations,
+           "ABA", abaTimer.lastElapsed() / _iterations, (qddotDense - qddotABA).cwiseAbs().maxCoeff());
+}
+
+// World::setState with the skeletons evaluated by 1, 2, 4, ... threads
+void benchmarkWorldThreads(SkeletonDynamics* _skel, int _numSkeletons, int _iterations)
+{
+    simulation::World world;
+    vector<SkeletonDynamics*> skels;
+    for (int i = 0; i < _numSkeletons; i++)
+    {
+        skels.push_back(_skel->clone());
+        world.addSkeleton(skels.back());
+    }
+    VectorXd state = world.getState();
+    for (int i = 0; i < state.size(); i++)
+        state[i] += math::random(-0.5, 0.5);
+
+    int maxThreads = 1;
+#ifdef _OPENMP
+    maxThreads = omp_get_max_threads();
+#endif
+
+    cout << "World::setState, " << _numSkeletons << " skeletons of "
+         << _skel->getNumDofs() << " dofs, " << _iterations << " iterations" << endl;
+    double serialTime = 0.0;
+    for (int numThreads = 1; numThreads <= maxThreads; numThreads *= 2)
+    {
+        world.setNumThreads(numThreads);
+        // utils::Timer measures processor time, which adds up over threads
+#ifdef _OPENMP
+        double start = omp_get_wtime();
+        for (int i = 0; i < _iterations; i++)
+            world.setState(state);
+        double elapsed = omp_get_wtime() - start;
+#else
+        utils::Timer timer("world setState");
+        timer.startTimer();
+        for (int i = 0; i < _iterations; i++)
+            world.setState(state);
+        timer.stopTimer();
+        double elapsed = timer.lastElapsed();
+#endif
+        if (numThreads == 1)
+            serialTime = elapsed;
+        cout << "  " << numThreads << " threads: " << elapsed / _iterations * 1.0e6
+             << " us, speedup " << serialTime / elapsed << endl;
+    }
+
+    for (int i = 0; i < _numSkeletons; i++)
+        delete skels[i];
+}
+
+// Free motion of a skeleton without joint limits: fixed 1 ms steps vs.
+// Dormand-Prince steps adapted to the tolerance
+void benchmarkAdaptiveTimeStep(SkeletonDynamics* _skel, double _duration, double _tolerance)
+{
+    int nDof = _skel->getNumDofs();
+    SkeletonDynamics* fixedSkel = _skel->clone();
+    SkeletonDynamics* adaptiveSkel = _skel->clone();
+    fixedSkel->setJointLimitState(false);
+    adaptiveSkel->setJointLimitState(false);
+    simulation::World fixedWorld, adaptiveWorld;
+    fixedWorld.addSkeleton(fixedSkel);
+    adaptiveWorld.addSkeleton(adaptiveSkel);
+    VectorXd state = fixedWorld.getState();
+    for (int i = 6; i < nDof; i++)
+        state[nDof + i] = math::random(-1.0, 1.0);
+
+    utils::Timer fixedTimer("fixed time step");
+    fixedWorld.setState(state);
+    int numFixedSteps = _duration / fixedWorld.getTimeStep() + 0.5;
+    fixedTimer.startTimer();
+    for (int i = 0; i < numFixedSteps; i++)
+        fixedWorld.step();
+    fixedTimer.stopTimer();
+
+    utils::Timer adaptiveTimer("adaptive time step");
+    adaptiveWorld.setState(state);
+    adaptiveWorld.setAdaptiveTimeStep(true);
+    adaptiveWorld.setTolerance(_tolerance);
+    adaptiveWorld.resetStepStatistics();
+    adaptiveTimer.startTimer();
+    adaptiveWorld.step(_duration);
+    adaptiveTimer.stopTimer();
+
+    ostringstream name;
+    name << "Adaptive time step, " << nDof << " dofs, " << _duration << " s, tolerance " << _tolerance;
+    report(name.str(), "fixed steps", fixedTimer.lastElapsed(),
+           "adaptive steps", adaptiveTimer.lastElapsed(),
+           (fixedWorld.getState() - adaptiveWorld.getState()).cwiseAbs().maxCoeff());
+    cout << "  " << numFixedSteps << " fixed steps of " << fixedWorld.getTimeStep() * 1.0e3 << " ms" << endl;
+    cout << "  adaptive steps accepted: " << adaptiveWorld.getNumAcceptedSteps()
+         << ", rejected: " << adaptiveWorld.getNumRejectedSteps()
+         << ", evalDeriv: " << adaptiveWorld.getNumDerivEvals()
+         << ", effective dt: " << adaptiveWorld.getEffectiveTimeStep() * 1.0e3 << " ms" << endl;
+
+    delete fixedSkel;
+    delete adaptiveSkel;
+}
+
+// Contact Jacobians at a point of each body: Jv + Jw x (p - COM) over the
+// dependent dofs vs. one derivative of the world transform per dof over all
+// the dofs
+void benchmarkContactJacobians(SkeletonDynamics* _skel, int _iterations)
+{
+    int nDof = _skel->getNumDofs();
+    VectorXd q, qdot;
+    randomState(_skel, q, qdot);
+    _skel->setPose(q, true, true);
+    simulation::World world;
+    world.addSkeleton(_skel);
+
+    int nNodes = _skel->getNumNodes();
+    vector<Vector3d> points(nNodes);
+    for (int i = 0; i < nNodes; i++)
+        points[i] = _skel->getNode(i)->getWorldCOM() + Vector3d(0.05, 0.05, 0.05);
+
+    utils::Timer derivTimer("contact Jacobians (transform derivatives)");
+    vector<MatrixXd> Jderiv(nNodes);
+    derivTimer.startTimer();
+    for (int k = 0; k < _iterations; k++)
+    {
+        for (int i = 0; i < nNodes; i++)
+        {
+            BodyNode* node = _skel->getNode(i);
+            Jderiv[i] = MatrixXd::Zero(nDof, 3);
+            Vector3d localPoint = math::xformHom(node->getWorldInvTransform(), points[i]);
+            for (int j = 0; j < node->getNumDependentDofs(); j++)
+                Jderiv[i].row(node->getDependentDof(j)) = math::xformHom(node->getDerivWorldTransform(j), localPoint);
+        }
+    }
+    derivTimer.stopTimer();
+
+    utils::Timer compactTimer("contact Jacobians (compact)");
+    vector<MatrixXd> Jcompact(nNodes);
+    compactTimer.startTimer();
+    for (int k = 0; k < _iterations; k++)
+    {
+        for (int i = 0; i < nNodes; i++)
+            Jcompact[i] = world.getCollisionHandle()->getJacobian(_skel->getNode(i), points[i]);
+    }
+    compactTimer.stopTimer();
+
+    double maxDiff = 0.0;
+    for (int i = 0; i < nNodes; i++)
+    {
+        BodyNode* node = _skel->getNode(i);
+        for (int j = 0; j < node->getNumDependentDofs(); j++)
+            maxDiff = max(maxDiff, (Jcompact[i].row(j) - Jderiv[i].row(node->getDependentDof(j))).cwiseAbs().maxCoeff());
+    }
+
+    ostringstream name;
+    name << "Contact Jacobians, " << nNodes << " bodies, " << _iterations << " iterations";
+    report(name.str(), "transform derivatives", derivTimer.lastElapsed() / _iterations,
+           "compact", compactTimer.lastElapsed() / _iterations, maxDiff);
+}
+
+// Contacts of stacks of cubes: time spent assembling the LCP matrix per cube
+// vs. from products over all the dofs of the stack; the rest of the step is
+// left out
+void benchmarkLCPAssembly(int _numStacks, int _cubesPerStack, int _iterations)
+{
+    FileInfoSkel<SkeletonDynamics> groundFile, cubeFile;
+    groundFile.loadFile(DART_DATA_PATH"skel/ground1.skel", SKEL);
+    cubeFile.loadFile(DART_DATA_PATH"skel/cube1.skel", SKEL);
+    SkeletonDynamics* ground = static_cast<SkeletonDynamics*>(groundFile.getSkel());
+    SkeletonDynamics* cube = static_cast<SkeletonDynamics*>(cubeFile.getSkel());
+    ground->setImmobileState(true);
+    VectorXd pose = ground->getPose();
+    pose[1] = -0.35;
+    ground->setPose(pose);
+
+    double elapsed[2];
+    int numContacts = 0;
+    for (int k = 0; k < 2; k++)
+    {
+        simulation::World world;
+        world.setGravity(Vector3d(0.0, -9.81, 0.0));
+        world.addSkeleton(ground);
+        vector<SkeletonDynamics*> cubes;
+        for (int i = 0; i < _numStacks; i++)
+        {
+            for (int j = 0; j < _cubesPerStack; j++)
+            {
+                // slightly sunk so that the contacts exist from the first step
+                cubes.push_back(cube->clone());
+                pose = cubes.back()->getPose();
+                pose[0] = 0.2 * i;
+                pose[1] = -0.326 + 0.049 * j;
+                cubes.back()->setPose(pose);
+                world.addSkeleton(cubes.back());
+            }
+        }
+        world.getCollisionHandle()->setSparseLCPMatrix(k == 0);
+
+        elapsed[k] = 0.0;
+        for (int i = 0; i < _iterations; i++)
+        {
+            world.step();
+            elapsed[k] += world.getCollisionHandle()->getLCPAssemblyTime();
+        }
+        numContacts = world.getCollisionHandle()->getNumContacts();
+
+        for (unsigned int i = 0; i < cubes.size(); i++)
+            delete cubes[i];
+    }
+
+    ostringstream name;
+    name << "LCP assembly, " << _numStacks << " x " << _cubesPerStack << " cubes, " << numContacts << " contacts, " << _iterations << " steps";
+    report(name.str(), "dense LCP matrix", elapsed[1] / _iterations, "sparse LCP matrix", elapsed[0] / _iterations);
+}
+
+int main(int argc, char* argv[])
+{
+    const char* skelFile = DART_DATA_PATH"skel/fullbody.skel";
+    int iterations = 1000;
+    if (argc > 1)
+        skelFile = argv[1];
+    if (argc > 2)
+        iterations = atoi(argv[2]);
+
+    FileInfoSkel<SkeletonDynamics> model;
+    if (!model.loadFile(skelFile, SKEL))
+    {
+        cerr << "Failed to load " << skelFile << endl;
+        return 1;
+    }
+    SkeletonDynamics* skel = static_cast<SkeletonDynamics*>(model.getSkel());
+    skel->initDynamics();
+
+    benchmarkMassMatrix(skel, iterations);
+    benchmarkMassSolve(skel, iterations);
+    benchmarkTaskDynamics(skel, iterations);
+    benchmarkDynamicsDerivatives(skel, iterations / 10 + 1);
+    benchmarkHybridDynamics(skel, iterations);
+    benchmarkWorldThreads(skel, 32, iterations / 10 + 1);
+    benchmarkAdaptiveTimeStep(skel, 1.0, 1.0e-4);
+    benchmarkContactJacobians(skel, iterations);
+    benchmarkLCPAssembly(1, 10, iterations / 10 + 1);
+    benchmarkLCPAssembly(1, 30, iterations / 10 + 1);
+    benchmarkLCPAssembly(4, 20, iterations / 10 + 1);
+    benchmarkLCPAssembly(1, 60, iterations / 10 + 1);
+
+    return 0;
+}
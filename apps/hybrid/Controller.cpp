@@ -37,7 +37,10 @@ void Controller::computeTorques(const VectorXd& _dof, const VectorXd& _dofVel) {
     mTorques = -mKp * (_dof - mDesiredDofs) - mKd * _dofVel;
     for (int i = 0; i < 3; i++)
         mTorques[i] = 0.0;
-    mTorques = mSkel->getMassMatrix() * mTorques; // scaled by accumulated mass
+    // scaled by accumulated mass: M * tau is the inverse dynamics of the
+    // accelerations tau without velocity or gravity, so M is never formed
+    VectorXd zero = VectorXd::Zero(mSkel->getNumDofs());
+    mTorques = mSkel->computeInverseDynamicsLinear(Vector3d::Zero(), &zero, &mTorques, false, false);
 
     
     mFrame++;
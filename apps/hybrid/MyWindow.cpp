@@ -31,8 +31,6 @@ void MyWindow::initDyn()
     for (unsigned int i = 0; i < mSkels.size(); i++) {
         mSkels[i]->initDynamics();
         mSkels[i]->setPose(mDofs[i], false, false);
-        // compute dynamics here because computation of control force at first iteration needs to access mass matrix
-        mSkels[i]->computeDynamics(mGravity, mDofVels[i], false);
     }
     
     // init controller
@@ -76,18 +74,12 @@ VectorXd MyWindow::evalDeriv() {
             desiredAccel[0] = -5.0;       
 
         int nDof = mSkels[i]->getNumDofs();
-        MatrixXd J(3, nDof);
-        J.setZero();
-        J(0, 0) = 1.0;
-        J(1, 1) = 1.0;
-        J(2, 2) = 1.0;
- 
-        MatrixXd A = mSkels[i]->getMassMatrix();
-        A.block(0, 0, nDof, 3) = J.transpose();
-        VectorXd b = -mSkels[i]->getCombinedVector() + mSkels[i]->getInternalForces() - mSkels[i]->getMassMatrix().block(0, 0, nDof, 3) * desiredAccel;
-        VectorXd x = A.inverse() * b;
-        VectorXd qddot = x;
+        std::vector<bool> prescribed(nDof, false);
+        prescribed[0] = prescribed[1] = prescribed[2] = true;
+        VectorXd qddot = VectorXd::Zero(nDof);
         qddot.head(3) = desiredAccel;
+        VectorXd tau = mSkels[i]->getInternalForces();
+        mSkels[i]->computeHybridDynamics(mGravity, mDofVels[i], prescribed, qddot, tau);
         mSkels[i]->clampRotation(mDofs[i], mDofVels[i]);
         deriv.segment(start, size) = mDofVels[i] + (qddot * mTimeStep); // set velocities
         deriv.segment(start + size, size) = qddot; // set qddot (accelerations)
@@ -106,12 +98,9 @@ void MyWindow::setState(const VectorXd &newState) {
 
 void MyWindow::setPose() {
     for (unsigned int i = 0; i < mSkels.size(); i++) {
-        if (mSkels[i]->getImmobileState()) {
-            mSkels[i]->setPose(mDofs[i], false, false);
-        } else {
-            mSkels[i]->setPose(mDofs[i], false, false);
-            mSkels[i]->computeDynamics(mGravity, mDofVels[i], true);
-        }
+        // the hybrid dynamics update the transforms themselves and need
+        // neither M nor Cg
+        mSkels[i]->setPose(mDofs[i], false, false);
     }
 }
 
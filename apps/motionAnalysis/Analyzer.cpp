@@ -1,8 +1,12 @@
 #include "Analyzer.h"
 #include "dynamics/SkeletonDynamics.h"
 #include "dynamics/BodyNodeDynamics.h"
+#include "dynamics/BatchDynamics.h"
 #include "kinematics/FileInfoDof.h"
 #include <fstream>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 using namespace Eigen;
 using namespace std;
@@ -22,15 +26,18 @@ Analyzer::Analyzer(kinematics::FileInfoDof *_motion, dynamics::SkeletonDynamics
 }
 
 void Analyzer::computeTorques() {
-    int nFrame = mMotion->getNumFrames();
-    double timestep = 1.0 / mMotion->getFPS();
-    for (int i = 0; i < nFrame - 2; i++) {
-        VectorXd qdot = (mMotion->getPoseAtFrame(i + 1) - mMotion->getPoseAtFrame(i)) / timestep;
-
-        VectorXd qddot = (mMotion->getPoseAtFrame(i + 2) - 2 * mMotion->getPoseAtFrame(i + 1)+ mMotion->getPoseAtFrame(i)) / (timestep * timestep);
-        mSkel->setPose(mMotion->getPoseAtFrame(i), true, false);
-        mTorques[i] = mSkel->computeInverseDynamicsLinear(mGravity, &qdot, &qddot, false, false);
-    }
+    // one clone of the skeleton per additional thread
+    std::vector<SkeletonDynamics*> workers(1, mSkel);
+#ifdef _OPENMP
+    for (int i = 1; i < omp_get_max_threads(); i++)
+        workers.push_back(mSkel->clone());
+#endif
+    MatrixXd torques;
+    computeInverseDynamicsBatch(workers, *mMotion, mGravity, torques);
+    for (int i = 0; i < torques.cols(); i++)
+        mTorques[i] = torques.col(i);
+    for (unsigned int i = 1; i < workers.size(); i++)
+        delete workers[i];
 }
 
 void Analyzer::analyze() {
@@ -41,12 +48,13 @@ void Analyzer::analyze() {
     int nFrame = mMotion->getNumFrames();
     double timestep = 1.0 / mMotion->getFPS();
     for (int i = 0; i < nFrame - 1; i++) {
-        mSkel->setPose(mMotion->getPoseAtFrame(i), true, true);
+        mSkel->setPose(mMotion->getPoseAtFrame(i), true, false);
         VectorXd qdot = (mMotion->getPoseAtFrame(i + 1) - mMotion->getPoseAtFrame(i)) / timestep;
-        Vector3d lin = evalLinMomentum(qdot);
-        Vector3d ang = evalAngMomentum(qdot);
-        mLinMomentum.push_back(lin);
-        mAngMomentum.push_back(ang);
+        // the linear part is written as the velocity of the center of mass
+        mSkel->computeCentroidalMomentum(qdot);
+        const VectorXd& momentum = mSkel->getCentroidalMomentum();
+        mLinMomentum.push_back(momentum.tail<3>() / mSkel->getMass());
+        mAngMomentum.push_back(momentum.head<3>());
     }
     // last frame
     Vector3d zero(0, 0, 0);
@@ -68,31 +76,3 @@ void Analyzer::analyze() {
         outFile << mAngMomentum[i][0] << " " << mAngMomentum[i][1] << " " << mAngMomentum[i][2] << endl;
     outFile.close();
 }
-
-Vector3d Analyzer::evalLinMomentum(const VectorXd& _dofVel) {
-    MatrixXd J(MatrixXd::Zero(3, mSkel->getNumDofs()));
-    for (int i = 0; i < mSkel->getNumNodes(); i++) {
-        BodyNodeDynamics *node = (BodyNodeDynamics*)mSkel->getNode(i);
-        MatrixXd localJ = node->getJacobianLinear() * node->getMass();
-        for (int j = 0; j < node->getNumDependentDofs(); j++) {
-            int index = node->getDependentDof(j);
-            J.col(index) += localJ.col(j);
-        }
-    }
-    Vector3d cDot = J * _dofVel;
-    return cDot / mSkel->getMass();
-}
-
-Vector3d Analyzer::evalAngMomentum(const VectorXd& _dofVel) {
-    Vector3d c = mSkel->getWorldCOM();
-    Vector3d sum = Vector3d::Zero();
-    Vector3d temp = Vector3d::Zero();
-    for (int i = 0; i < mSkel->getNumNodes(); i++) {
-        BodyNodeDynamics *node = (BodyNodeDynamics*)mSkel->getNode(i);
-        node->evalVelocity(_dofVel);
-        node->evalOmega(_dofVel);
-        sum += node->getWorldInertia() * node->mOmega;
-        sum += node->getMass() * (node->getWorldCOM() - c).cross(node->mVel);
-    }
-    return sum;
-}
@@ -22,9 +22,6 @@ class Analyzer {
     dynamics::SkeletonDynamics* getSkel() { return mSkel; };
 
  protected: 
-    Eigen::Vector3d evalLinMomentum(const Eigen::VectorXd& _dofVel);
-    Eigen::Vector3d evalAngMomentum(const Eigen::VectorXd& _dofVel);
-
     dynamics::SkeletonDynamics *mSkel;
     kinematics::FileInfoDof *mMotion;
     std::vector<Eigen::VectorXd> mTorques;
@@ -21,10 +21,8 @@ Controller::Controller(kinematics::FileInfoDof *_motion, dynamics::SkeletonDynam
     }
 
 #ifdef SPD
-    for (int i = 0; i < nDof; i++) {
-        mKp(i, i) = 15.0;
-        mKd(i, i) = 2.0;
-    }
+    // the servos of the skeleton are integrated implicitly in MyWindow::evalDeriv
+    mSkel->setPDGains(VectorXd::Constant(nDof, 15.0), VectorXd::Constant(nDof, 2.0));
 #else
     for (int i = 0; i < nDof; i++) {
         mKp(i, i) = 800.0;
@@ -44,11 +42,8 @@ void Controller::computeTorques(const VectorXd& _dof, const VectorXd& _dofVel) {
     
     mDesiredDofs = mMotion->getPoseAtFrame(motionFrame);
 #ifdef SPD
-    MatrixXd invM = (mSkel->getMassMatrix() + mKd * mTimestep).inverse();
-    VectorXd p = -mKp * (_dof + _dofVel * mTimestep - mDesiredDofs);
-    VectorXd d = -mKd * _dofVel;
-    VectorXd qddot = invM * (-mSkel->getCombinedVector() + p + d);
-    mTorques = p + d - mKd * qddot * mTimestep;
+    mSkel->setPDTarget(mDesiredDofs);
+    mTorques.setZero();
 #else
     mTorques = -mKp * (_dof - mDesiredDofs) - mKd * _dofVel;
     mTorques = mSkel->getMassMatrix() * mTorques; // scaled by accumulated mass
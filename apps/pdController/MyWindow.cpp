@@ -56,6 +56,7 @@ VectorXd MyWindow::evalDeriv() {
         } else {
             mSkels[i]->setPose(mDofs[i], false, false);
             mSkels[i]->computeDynamics(mGravity, mDofVels[i], true);
+            mSkels[i]->computePDForces(mTimeStep);
         }
     }
     VectorXd deriv = VectorXd::Zero(mIndices.back() * 2);    
@@ -65,7 +66,7 @@ VectorXd MyWindow::evalDeriv() {
             continue;
         int start = mIndices[i] * 2;
         int size = mDofs[i].size();
-        VectorXd qddot = mSkels[i]->getInvMassMatrix() * (-mSkels[i]->getCombinedVector() + mSkels[i]->getExternalForces() + mSkels[i]->getInternalForces());
+        VectorXd qddot = mSkels[i]->getInvMassMatrix() * (-mSkels[i]->getCombinedVector() + mSkels[i]->getExternalForces() + mSkels[i]->getInternalForces() + mSkels[i]->getPDForces());
         mSkels[i]->clampRotation(mDofs[i], mDofVels[i]);
         deriv.segment(start, size) = mDofVels[i] + (qddot * mTimeStep); // set velocities
         deriv.segment(start + size, size) = qddot; // set qddot (accelerations)
@@ -35,6 +35,9 @@
  *   POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <algorithm>
+#include <cmath>
+
 #include "kinematics/BodyNode.h"
 #include "kinematics/Skeleton.h"
 
@@ -44,7 +47,159 @@
 namespace collision
 {
 
-CollisionDetector::CollisionDetector() {
+namespace {
+
+// Spatial hash of a grid cell, from Teschner et al., "Optimized Spatial
+// Hashing for Collision Detection of Deformable Objects"; _mask is the
+// number of buckets minus one, which is a power of two
+inline unsigned int hashCell(long long _x, long long _y, long long _z, unsigned int _mask) {
+    return ((unsigned int)(_x * 73856093LL) ^ (unsigned int)(_y * 19349663LL)
+            ^ (unsigned int)(_z * 83492791LL)) & _mask;
+}
+
+} // namespace
+
+void removeDuplicateContacts(std::vector<Contact>* _contacts, double _tolerance) {
+    int numContacts = _contacts->size();
+    if (numContacts <= 1)
+        return;
+
+    // the buckets chain the kept contacts through flat arrays, so an insert
+    // takes constant time and allocates nothing; cells that share a bucket
+    // only cost a few more distance tests
+    unsigned int numBuckets = 1;
+    while (numBuckets < 2 * (unsigned int)numContacts)
+        numBuckets <<= 1;
+    unsigned int mask = numBuckets - 1;
+    std::vector<int> firstInBucket(numBuckets, -1);
+    std::vector<int> nextInBucket;
+    nextInBucket.reserve(numContacts);
+
+    std::vector<Contact> kept;
+    kept.reserve(numContacts);
+    double tolerance2 = _tolerance * _tolerance;
+
+    for (int i = 0; i < numContacts; i++) {
+        const Eigen::Vector3d& point = (*_contacts)[i].point;
+        long long x = (long long)std::floor(point[0] / _tolerance);
+        long long y = (long long)std::floor(point[1] / _tolerance);
+        long long z = (long long)std::floor(point[2] / _tolerance);
+
+        // a point within _tolerance lies in one of the 27 surrounding cells
+        bool duplicate = false;
+        for (long long nx = x - 1; nx <= x + 1 && !duplicate; nx++) {
+            for (long long ny = y - 1; ny <= y + 1 && !duplicate; ny++) {
+                for (long long nz = z - 1; nz <= z + 1 && !duplicate; nz++) {
+                    int j = firstInBucket[hashCell(nx, ny, nz, mask)];
+                    for (; j >= 0; j = nextInBucket[j]) {
+                        if ((kept[j].point - point).squaredNorm() < tolerance2) {
+                            duplicate = true;
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+
+        if (!duplicate) {
+            unsigned int bucket = hashCell(x, y, z, mask);
+            nextInBucket.push_back(firstInBucket[bucket]);
+            firstInBucket[bucket] = kept.size();
+            kept.push_back((*_contacts)[i]);
+        }
+    }
+
+    _contacts->swap(kept);
+}
+
+void reduceContactManifold(std::vector<Contact>* _contacts, int _maxNumContacts,
+                           double _tolerance) {
+    int numContacts = _contacts->size();
+    if (numContacts <= 1 || _maxNumContacts < 1)
+        return;
+
+    // start from the point farthest from the centroid and the point farthest
+    // from that one
+    Eigen::Vector3d centroid = Eigen::Vector3d::Zero();
+    for (int i = 0; i < numContacts; i++)
+        centroid += (*_contacts)[i].point;
+    centroid /= numContacts;
+
+    std::vector<int> polygon;
+    int first = 0;
+    for (int i = 1; i < numContacts; i++) {
+        if (((*_contacts)[i].point - centroid).squaredNorm()
+                > ((*_contacts)[first].point - centroid).squaredNorm())
+            first = i;
+    }
+    polygon.push_back(first);
+
+    int second = -1;
+    double maxDist = _tolerance;
+    for (int i = 0; i < numContacts; i++) {
+        double dist = ((*_contacts)[i].point - (*_contacts)[first].point).norm();
+        if (dist > maxDist) {
+            maxDist = dist;
+            second = i;
+        }
+    }
+    if (second >= 0 && _maxNumContacts > 1)
+        polygon.push_back(second);
+
+    // the third point spans the largest triangle and fixes the plane normal
+    Eigen::Vector3d normal = Eigen::Vector3d::Zero();
+    if (polygon.size() == 2 && _maxNumContacts > 2) {
+        const Eigen::Vector3d& a = (*_contacts)[first].point;
+        Eigen::Vector3d edge = (*_contacts)[second].point - a;
+        int third = -1;
+        double maxArea = _tolerance * edge.norm();
+        for (int i = 0; i < numContacts; i++) {
+            Eigen::Vector3d n = edge.cross((*_contacts)[i].point - a);
+            if (n.norm() > maxArea) {
+                maxArea = n.norm();
+                normal = n;
+                third = i;
+            }
+        }
+        if (third >= 0) {
+            polygon.push_back(third);
+            normal.normalize();
+        }
+    }
+
+    // the polygon is counterclockwise about the normal; a point outside an
+    // edge adds the triangle it forms with that edge
+    while (polygon.size() >= 3 && (int)polygon.size() < _maxNumContacts) {
+        int bestPoint = -1;
+        int bestEdge = -1;
+        double bestArea = 0.0;
+        for (int i = 0; i < numContacts; i++) {
+            const Eigen::Vector3d& p = (*_contacts)[i].point;
+            for (unsigned int e = 0; e < polygon.size(); e++) {
+                const Eigen::Vector3d& a = (*_contacts)[polygon[e]].point;
+                const Eigen::Vector3d& b = (*_contacts)[polygon[(e + 1) % polygon.size()]].point;
+                double area = -0.5 * (b - a).cross(p - a).dot(normal);
+                if (area > bestArea && 2.0 * area > _tolerance * (b - a).norm()) {
+                    bestArea = area;
+                    bestPoint = i;
+                    bestEdge = e;
+                }
+            }
+        }
+        if (bestPoint < 0)
+            break;
+        polygon.insert(polygon.begin() + bestEdge + 1, bestPoint);
+    }
+
+    std::vector<Contact> reduced(polygon.size());
+    for (unsigned int i = 0; i < polygon.size(); i++)
+        reduced[i] = (*_contacts)[polygon[i]];
+    _contacts->swap(reduced);
+}
+
+CollisionDetector::CollisionDetector()
+    : mNumOverlappingPairs(0),
+      mSweepAxis(0) {
 }
 
 CollisionDetector::~CollisionDetector() {
@@ -127,4 +282,83 @@ void CollisionDetector::updateBodyNodeCollidableState() {
     }
 }
 
+void CollisionDetector::_updateBroadPhase() {
+    unsigned int numCollisionNodes = mCollisionNodes.size();
+
+    mBroadPhasePairs.clear();
+    mNumOverlappingPairs = 0;
+
+    if (mSweepOrder.size() != numCollisionNodes) {
+        mSweepOrder.resize(numCollisionNodes);
+        for (unsigned int i = 0; i < numCollisionNodes; ++i)
+            mSweepOrder[i] = i;
+    }
+
+    // sweep along the axis where the boxes are spread the most
+    Eigen::Vector3d sum = Eigen::Vector3d::Zero();
+    Eigen::Vector3d sumSq = Eigen::Vector3d::Zero();
+    unsigned int numBounded = 0;
+    for (unsigned int i = 0; i < numCollisionNodes; ++i) {
+        mCollisionNodes[i]->updateWorldAABB();
+        if (!mCollisionNodes[i]->hasLocalAABB())
+            continue;
+        Eigen::Vector3d center = 0.5 * (mCollisionNodes[i]->getWorldAABBMin()
+                                        + mCollisionNodes[i]->getWorldAABBMax());
+        sum += center;
+        sumSq += center.cwiseProduct(center);
+        numBounded++;
+    }
+    if (numBounded > 1)
+        (sumSq - sum.cwiseProduct(sum) / numBounded).maxCoeff(&mSweepAxis);
+
+    // insertion sort of the order from the last call
+    for (unsigned int i = 1; i < numCollisionNodes; ++i) {
+        unsigned int node = mSweepOrder[i];
+        double lower = mCollisionNodes[node]->getWorldAABBMin()[mSweepAxis];
+        unsigned int j = i;
+        for (; j > 0 && mCollisionNodes[mSweepOrder[j - 1]]->getWorldAABBMin()[mSweepAxis] > lower; --j)
+            mSweepOrder[j] = mSweepOrder[j - 1];
+        mSweepOrder[j] = node;
+    }
+
+    for (unsigned int i = 0; i < numCollisionNodes; ++i) {
+        CollisionNode* node1 = mCollisionNodes[mSweepOrder[i]];
+        double upper = node1->getWorldAABBMax()[mSweepAxis];
+
+        for (unsigned int j = i + 1; j < numCollisionNodes; ++j) {
+            CollisionNode* node2 = mCollisionNodes[mSweepOrder[j]];
+            if (node2->getWorldAABBMin()[mSweepAxis] > upper)
+                break;
+
+            bool overlap = true;
+            for (int k = 0; k < 3 && overlap; ++k) {
+                overlap = node1->getWorldAABBMin()[k] <= node2->getWorldAABBMax()[k]
+                          && node2->getWorldAABBMin()[k] <= node1->getWorldAABBMax()[k];
+            }
+            if (!overlap)
+                continue;
+
+            mNumOverlappingPairs++;
+            if (node1->isResting() && node2->isResting())
+                continue;
+            unsigned int idx1 = std::min(mSweepOrder[i], mSweepOrder[j]);
+            unsigned int idx2 = std::max(mSweepOrder[i], mSweepOrder[j]);
+            if (_isCollidable(idx1, idx2))
+                mBroadPhasePairs.push_back(std::make_pair(idx1, idx2));
+        }
+    }
+
+    // the narrowphase visits the pairs in the same order as a full scan
+    std::sort(mBroadPhasePairs.begin(), mBroadPhasePairs.end());
+}
+
+bool CollisionDetector::_isCollidable(unsigned int _idx1,
+                                      unsigned int _idx2) const {
+    // index of the pair (_idx1, _idx2) as laid out by _rebuildBodyNodePairs
+    unsigned int numCollisionNodes = mCollisionNodes.size();
+    unsigned int pairIndex = _idx1 * numCollisionNodes - _idx1 * (_idx1 + 1) / 2
+                             + _idx2 - _idx1 - 1;
+    return mCollisionNodePairs[pairIndex].collidable;
+}
+
 } // namespace collision
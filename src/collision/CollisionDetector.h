@@ -39,6 +39,7 @@
 #define COLLISION_CONLLISION_DETECTOR_H
 
 #include <vector>
+#include <utility>
 #include <Eigen/Dense>
 #include "collision/CollisionNode.h"
 
@@ -79,6 +80,19 @@ struct Contact {
     int triID2;
 };
 
+/// @brief Remove the contacts that lie within _tolerance of an earlier
+/// contact. The points are hashed into a grid of cells of size _tolerance,
+/// so only the neighboring cells are searched, in expected O(1) time each.
+void removeDuplicateContacts(std::vector<Contact>* _contacts, double _tolerance);
+
+/// @brief Reduce the contacts between a pair of bodies to at most
+/// _maxNumContacts points that span the largest area: the two points
+/// farthest apart, then greedily the point that grows their convex polygon
+/// the most. Points inside the polygon or on its edges, including interior
+/// points of collinear contacts, are dropped.
+void reduceContactManifold(std::vector<Contact>* _contacts, int _maxNumContacts,
+                           double _tolerance);
+
 /// @brief
 class CollisionDetector {
     // CONSTRUCTORS AND DESTRUCTOR ---------------------------------------------
@@ -102,6 +116,12 @@ public:
     virtual bool checkCollision(bool _checkAllCollisions,
                                 bool _calculateContactPoints) = 0;
 
+    /// @brief
+    unsigned int getNumCollisionNodes() const { return mCollisionNodes.size(); }
+
+    /// @brief
+    CollisionNode* getCollisionNode(int _idx) const { return mCollisionNodes[_idx]; }
+
     /// @brief
     unsigned int getNumContacts() { return mContacts.size(); }
 
@@ -117,6 +137,14 @@ public:
     /// @brief
     void updateBodyNodeCollidableState();
 
+    /// @brief Number of node pairs whose world bounding boxes overlapped in
+    /// the last broadphase, collidable or not.
+    unsigned int getNumOverlappingPairs() const { return mNumOverlappingPairs; }
+
+    /// @brief Number of overlapping, collidable node pairs the last
+    /// broadphase passed on to the narrowphase.
+    unsigned int getNumBroadPhasePairs() const { return mBroadPhasePairs.size(); }
+
 protected:
     /// @brief
     void _rebuildBodyNodePairs();
@@ -124,6 +152,16 @@ protected:
     /// @brief
     void _setAllBodyNodePairsCollidable(bool _collidable);
 
+    /// @brief Sweep and prune: update the world bounding boxes of the
+    /// collision nodes and collect the overlapping, collidable pairs into
+    /// mBroadPhasePairs, ordered by node index. Pairs of two resting nodes
+    /// are left out.
+    void _updateBroadPhase();
+
+    /// @brief Whether the nodes with indices _idx1 < _idx2 in
+    /// mCollisionNodes should be checked by the narrowphase.
+    virtual bool _isCollidable(unsigned int _idx1, unsigned int _idx2) const;
+
     /// @brief
     std::vector<Contact> mContacts;
 
@@ -133,8 +171,21 @@ protected:
     /// @brief
     std::vector<CollisionNodePair> mCollisionNodePairs;
 
+    /// @brief Index pairs (i < j) of the nodes to be checked by the
+    /// narrowphase.
+    std::vector<std::pair<unsigned int, unsigned int> > mBroadPhasePairs;
+
+    /// @brief
+    unsigned int mNumOverlappingPairs;
+
 private:
+    /// @brief Node indices sorted by the lower bound of their boxes along
+    /// mSweepAxis. The order is kept between calls, so re-sorting a scene
+    /// that moved a little is nearly linear.
+    std::vector<unsigned int> mSweepOrder;
 
+    /// @brief
+    int mSweepAxis;
 };
 
 } // namespace collision
@@ -35,18 +35,55 @@
  *   POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <limits>
+
+#include "kinematics/BodyNode.h"
+#include "kinematics/Shape.h"
+
 #include "collision/CollisionNode.h"
 
 namespace collision
 {
 
 CollisionNode::CollisionNode(kinematics::BodyNode* _bodyNode)
-    : mBodyNode(_bodyNode) {
+    : mBodyNode(_bodyNode),
+      mResting(false),
+      mHasLocalAABB(false),
+      mLocalAABBMin(Eigen::Vector3d::Zero()),
+      mLocalAABBMax(Eigen::Vector3d::Zero()) {
+    mWorldAABBMin.setConstant(-std::numeric_limits<double>::infinity());
+    mWorldAABBMax.setConstant(std::numeric_limits<double>::infinity());
 }
 
 CollisionNode::~CollisionNode() {
 }
 
+void CollisionNode::setLocalAABB(const Eigen::Vector3d& _min,
+                                 const Eigen::Vector3d& _max) {
+    mLocalAABBMin = _min;
+    mLocalAABBMax = _max;
+    mHasLocalAABB = true;
+}
+
+void CollisionNode::updateWorldAABB() {
+    if (!mHasLocalAABB)
+        return;
+
+    Eigen::Matrix4d worldTrans
+            = mBodyNode->getWorldTransform()
+              * mBodyNode->getCollisionShape()->getTransform().matrix();
+    Eigen::Matrix3d R = worldTrans.topLeftCorner<3,3>();
+
+    // the rotated box is enclosed by the box with half extents |R| * h
+    Eigen::Vector3d center = 0.5 * (mLocalAABBMin + mLocalAABBMax);
+    Eigen::Vector3d halfExtents = 0.5 * (mLocalAABBMax - mLocalAABBMin);
+    Eigen::Vector3d worldCenter = R * center + worldTrans.topRightCorner<3,1>();
+    Eigen::Vector3d worldHalfExtents = R.cwiseAbs() * halfExtents;
+
+    mWorldAABBMin = worldCenter - worldHalfExtents;
+    mWorldAABBMax = worldCenter + worldHalfExtents;
+}
+
 
 
 } // namespace collision
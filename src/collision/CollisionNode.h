@@ -86,6 +86,32 @@ public: // setters and getters
     /// @brief
     int getBodyNodeID() const { return mBodyNodeID; }
 
+    /// @brief A resting node does not move, e.g. it belongs to a sleeping or
+    /// an immobile skeleton. Two resting nodes are not checked against each
+    /// other.
+    void setResting(bool _resting) { mResting = _resting; }
+
+    /// @brief
+    bool isResting() const { return mResting; }
+
+public: // bounding box
+    /// @brief Bounding box of the collision geometry in the frame of the
+    /// collision shape. Until it is set the node is treated as unbounded.
+    void setLocalAABB(const Eigen::Vector3d& _min, const Eigen::Vector3d& _max);
+
+    /// @brief
+    bool hasLocalAABB() const { return mHasLocalAABB; }
+
+    /// @brief Recompute the world axis-aligned bounding box from the current
+    /// world transform of the body node.
+    void updateWorldAABB();
+
+    /// @brief
+    const Eigen::Vector3d& getWorldAABBMin() const { return mWorldAABBMin; }
+
+    /// @brief
+    const Eigen::Vector3d& getWorldAABBMax() const { return mWorldAABBMax; }
+
 protected:
     /// @brief
     kinematics::BodyNode* mBodyNode;
@@ -93,6 +119,24 @@ protected:
     /// @brief
     int mBodyNodeID;
 
+    /// @brief
+    bool mResting;
+
+    /// @brief
+    bool mHasLocalAABB;
+
+    /// @brief
+    Eigen::Vector3d mLocalAABBMin;
+
+    /// @brief
+    Eigen::Vector3d mLocalAABBMax;
+
+    /// @brief
+    Eigen::Vector3d mWorldAABBMin;
+
+    /// @brief
+    Eigen::Vector3d mWorldAABBMax;
+
 private:
 };
 
@@ -35,6 +35,8 @@
  *   POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <algorithm>
+
 #include "kinematics/Shape.h"
 #include "kinematics/BodyNode.h"
 #include "kinematics/Skeleton.h"
@@ -47,7 +49,8 @@ namespace collision
 
 FCLCollisionDetector::FCLCollisionDetector()
     : CollisionDetector(),
-      mNumMaxContacts(100) {
+      mNumMaxContacts(100),
+      mNumThreads(1) {
 }
 
 FCLCollisionDetector::~FCLCollisionDetector() {
@@ -67,8 +70,42 @@ bool FCLCollisionDetector::checkCollision(bool _checkAllCollisions,
 
     clearAllContacts();
 
-    fcl::CollisionResult result;
+    _updateBroadPhase();
+
+    unsigned int numBroadPhasePairs = mBroadPhasePairs.size();
+    int numThreads = 1;
+#ifdef _OPENMP
+    numThreads = std::max(1, std::min<int>(mNumThreads, numBroadPhasePairs));
+#endif
+
+    if (numThreads == 1) {
+        _checkPairs(0, numBroadPhasePairs, _calculateContactPoints, &mContacts);
+        return !mContacts.empty();
+    }
+
+    // every thread checks a contiguous range of pairs into its own buffer;
+    // appending the buffers in thread order keeps the pair order of the
+    // serial loop
+    if (mThreadContacts.size() < (unsigned int)numThreads)
+        mThreadContacts.resize(numThreads);
+
+#pragma omp parallel for schedule(static, 1) num_threads(numThreads)
+    for (int i = 0; i < numThreads; ++i) {
+        unsigned int begin = (unsigned long)numBroadPhasePairs * i / numThreads;
+        unsigned int end = (unsigned long)numBroadPhasePairs * (i + 1) / numThreads;
+        mThreadContacts[i].clear();
+        _checkPairs(begin, end, _calculateContactPoints, &mThreadContacts[i]);
+    }
+
+    for (int i = 0; i < numThreads; ++i)
+        mContacts.insert(mContacts.end(), mThreadContacts[i].begin(), mThreadContacts[i].end());
 
+    return !mContacts.empty();
+}
+
+void FCLCollisionDetector::_checkPairs(unsigned int _begin, unsigned int _end,
+                                       bool _calculateContactPoints,
+                                       std::vector<Contact>* _contacts) const {
     // only evaluate contact points if data structure for returning the contact
     // points was provided
     fcl::CollisionRequest request;
@@ -78,19 +115,15 @@ bool FCLCollisionDetector::checkCollision(bool _checkAllCollisions,
 //    request.num_max_cost_sources;
 //    request.use_approximate_cost;
 
-    unsigned int numCollisionNodePairs = mCollisionNodePairs.size();
     FCLCollisionNode* collNode1 = NULL;
     FCLCollisionNode* collNode2 = NULL;
 
-    for (unsigned int i = 0; i < numCollisionNodePairs; ++i) {
-        const CollisionNodePair& collisionNodePair = mCollisionNodePairs[i];
-
-        if (collisionNodePair.collidable == false)
-            continue;
-
-        collNode1 = dynamic_cast<FCLCollisionNode*>(collisionNodePair.collisionNode1);
-        collNode2 = dynamic_cast<FCLCollisionNode*>(collisionNodePair.collisionNode2);
+    for (unsigned int i = _begin; i < _end; ++i) {
+        collNode1 = dynamic_cast<FCLCollisionNode*>(mCollisionNodes[mBroadPhasePairs[i].first]);
+        collNode2 = dynamic_cast<FCLCollisionNode*>(mCollisionNodes[mBroadPhasePairs[i].second]);
 
+        // fcl adds to the result, so every pair gets a fresh one
+        fcl::CollisionResult result;
         fcl::collide(collNode1->getCollisionGeometry(),
                      collNode1->getFCLTransform(),
                      collNode2->getCollisionGeometry(),
@@ -108,17 +141,15 @@ bool FCLCollisionDetector::checkCollision(bool _checkAllCollisions,
             contactPair.normal(0) = contact.normal[0];
             contactPair.normal(1) = contact.normal[1];
             contactPair.normal(2) = contact.normal[2];
-            contactPair.collisionNode1 = collisionNodePair.collisionNode1;
-            contactPair.collisionNode2 = collisionNodePair.collisionNode2;
+            contactPair.collisionNode1 = collNode1;
+            contactPair.collisionNode2 = collNode2;
             //contactPair.bdID1 = collisionNodePair.collisionNode1->getBodyNodeID();
             //contactPair.bdID2 = collisionNodePair.collisionNode2->getBodyNodeID();
             contactPair.penetrationDepth = contact.penetration_depth;
 
-            mContacts.push_back(contactPair);
+            _contacts->push_back(contactPair);
         }
     }
-
-    return !mContacts.empty();
 }
 
 } // namespace collision
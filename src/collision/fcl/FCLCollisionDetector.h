@@ -70,11 +70,30 @@ public:
     /// @brief
     void setNumMaxContacts(int _num) { mNumMaxContacts = _num; }
 
+    /// @brief Number of threads the narrowphase is split over. The contacts
+    /// are the same for any number of threads. Without OpenMP the
+    /// narrowphase always runs serially.
+    int getNumThreads() const { return mNumThreads; }
+
+    /// @brief
+    void setNumThreads(int _num) { mNumThreads = _num > 0 ? _num : 1; }
+
 protected:
+    /// @brief Run the narrowphase on the broadphase pairs in
+    /// [_begin, _end) and append the contacts found to _contacts.
+    void _checkPairs(unsigned int _begin, unsigned int _end,
+                     bool _calculateContactPoints,
+                     std::vector<Contact>* _contacts) const;
 
 private:
     /// @brief
     int mNumMaxContacts;
+
+    /// @brief
+    int mNumThreads;
+
+    /// @brief Contacts found by each thread, kept to reuse their storage.
+    std::vector<std::vector<Contact> > mThreadContacts;
 };
 
 } // namespace collision
@@ -49,7 +49,8 @@ namespace collision
 {
 
 FCLCollisionNode::FCLCollisionNode(kinematics::BodyNode* _bodyNode)
-    : CollisionNode(_bodyNode)
+    : CollisionNode(_bodyNode),
+      mCollisionGeometry(NULL)
 {
     kinematics::Shape* shape = _bodyNode->getCollisionShape();
 
@@ -103,6 +104,14 @@ FCLCollisionNode::FCLCollisionNode(kinematics::BodyNode* _bodyNode)
             break;
         }
     }
+
+    if (mCollisionGeometry)
+    {
+        mCollisionGeometry->computeLocalAABB();
+        const fcl::AABB& aabb = mCollisionGeometry->aabb_local;
+        setLocalAABB(Eigen::Vector3d(aabb.min_[0], aabb.min_[1], aabb.min_[2]),
+                     Eigen::Vector3d(aabb.max_[0], aabb.max_[1], aabb.max_[2]));
+    }
 }
 
 FCLCollisionNode::~FCLCollisionNode() {
@@ -27,7 +27,11 @@ void FCLMESHCollisionDetector::addCollisionSkeletonNode(kinematics::BodyNode *_b
 {
     if (_bRecursive == false || _bd->getNumChildJoints() == 0)
     {
-        FCLMESHCollisionNode* csnode = new FCLMESHCollisionNode(_bd);
+        FCLMESHCollisionNode* csnode;
+        if (mPrototype && mCollisionNodes.size() < mPrototype->getNumCollisionNodes())
+            csnode = new FCLMESHCollisionNode(_bd, static_cast<FCLMESHCollisionNode*>(mPrototype->getCollisionNode(mCollisionNodes.size())));
+        else
+            csnode = new FCLMESHCollisionNode(_bd);
         csnode->setBodyNodeID(mCollisionNodes.size());
         mCollisionNodes.push_back(csnode);
         mBodyCollisionMap[_bd] = csnode;
@@ -78,42 +82,43 @@ bool FCLMESHCollisionDetector::checkCollision(bool _checkAllCollisions,
         mCollisionNodes[i]->getBodyNode()->setColliding(false);
     }
 
-    for (int i = 0; i < mCollisionNodes.size(); i++)
+    _updateBroadPhase();
+
+    for (unsigned int k = 0; k < mBroadPhasePairs.size(); k++)
     {
+        int i = mBroadPhasePairs[k].first;
+        int j = mBroadPhasePairs[k].second;
         FCLMESHCollisionNode1 = static_cast<FCLMESHCollisionNode*>(mCollisionNodes[i]);
+        FCLMESHCollisionNode2 = static_cast<FCLMESHCollisionNode*>(mCollisionNodes[j]);
 
-        for (int j = i + 1; j < mCollisionNodes.size(); j++)
-        {
-            FCLMESHCollisionNode2 = static_cast<FCLMESHCollisionNode*>(mCollisionNodes[j]);
-
-            if (!mActiveMatrix[j][i])
-            {
-                continue;
-            }
-            const int numTriIntersection
-                    = FCLMESHCollisionNode1->checkCollision(
-                          FCLMESHCollisionNode2,
-                          _calculateContactPoints ? &mContacts : NULL,
-                          num_max_contact);
+        const int numTriIntersection
+                = FCLMESHCollisionNode1->checkCollision(
+                      FCLMESHCollisionNode2,
+                      _calculateContactPoints ? &mContacts : NULL,
+                      num_max_contact,
+                      mNumMaxContactsPerPair);
 
-            mNumTriIntersection += numTriIntersection;
+        mNumTriIntersection += numTriIntersection;
 
-            if(numTriIntersection > 0)
-            {
-                mCollisionNodes[i]->getBodyNode()->setColliding(true);
-                mCollisionNodes[j]->getBodyNode()->setColliding(true);
-            }
+        if(numTriIntersection > 0)
+        {
+            mCollisionNodes[i]->getBodyNode()->setColliding(true);
+            mCollisionNodes[j]->getBodyNode()->setColliding(true);
+        }
 
-            if(!_checkAllCollisions && mNumTriIntersection > 0)
-            {
-                return true;
-            }
+        if(!_checkAllCollisions && mNumTriIntersection > 0)
+        {
+            return true;
         }
     }
 
     return (mNumTriIntersection > 0);
 }
 
+bool FCLMESHCollisionDetector::_isCollidable(unsigned int _idx1, unsigned int _idx2) const {
+    return mActiveMatrix[_idx2][_idx1];
+}
+
 void FCLMESHCollisionDetector::draw() {
     for(int i=0;i<mCollisionNodes.size();i++)
         static_cast<FCLMESHCollisionNode*>(mCollisionNodes[i])->drawCollisionSkeletonNode();
@@ -73,7 +73,7 @@ class FCLMESHCollisionDetector : public CollisionDetector
 {
 public:
     /// @brief
-    FCLMESHCollisionDetector() { mNumTriIntersection = 0; }
+    FCLMESHCollisionDetector() { mNumTriIntersection = 0; mNumMaxContactsPerPair = 4; mPrototype = NULL; }
 
     /// @brief
     virtual ~FCLMESHCollisionDetector();
@@ -89,6 +89,12 @@ public:
     /// @brief
     inline int getNumTriangleIntersection(){return mNumTriIntersection;}
 
+    /// @brief Size of the contact manifold kept for each pair of bodies.
+    inline int getNumMaxContactsPerPair() const { return mNumMaxContactsPerPair; }
+
+    /// @brief
+    inline void setNumMaxContactsPerPair(int _num) { mNumMaxContactsPerPair = _num; }
+
     // Documentation inherited
     virtual bool checkCollision(bool _checkAllCollisions, bool _calculateContactPoints);
 
@@ -104,21 +110,37 @@ public:
             return NULL;
     }
 
+    /// @brief Let the nodes added from now on share the meshes of the nodes
+    /// of _prototype with the same indices, which are those of the bodies of
+    /// the same skeletons if both detectors are given clones of them in the
+    /// same order. NULL builds the meshes again.
+    inline void setPrototype(FCLMESHCollisionDetector* _prototype) { mPrototype = _prototype; }
+
     /// @brief
     void activatePair(const kinematics::BodyNode* node1, const kinematics::BodyNode* node2);
 
     /// @brief
     void deactivatePair(const kinematics::BodyNode* node1, const kinematics::BodyNode* node2);
 
+protected:
+    // Documentation inherited
+    virtual bool _isCollidable(unsigned int _idx1, unsigned int _idx2) const;
+
 public:
     /// @brief
     int mNumTriIntersection;
 
+    /// @brief
+    int mNumMaxContactsPerPair;
+
     /// @brief
     std::map<const kinematics::BodyNode*, FCLMESHCollisionNode*> mBodyCollisionMap;
 
     /// @brief
     std::vector<std::vector<bool> > mActiveMatrix;
+
+    /// @brief The detector whose meshes new nodes share; NULL if none.
+    FCLMESHCollisionDetector* mPrototype;
 };
 
 
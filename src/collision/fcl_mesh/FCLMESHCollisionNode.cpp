@@ -37,6 +37,7 @@
  */
 
 #include <iostream>
+#include <cmath>
 
 #include <fcl/shape/geometric_shapes.h>
 #include <fcl/BVH/BVH_model.h>
@@ -57,7 +58,8 @@ namespace collision {
 
 FCLMESHCollisionNode::FCLMESHCollisionNode(kinematics::BodyNode* _bodyNode)
     : CollisionNode(_bodyNode),
-      mMesh(NULL)
+      mMesh(NULL),
+      mMeshRefCount(new int(1))
 {
     kinematics::Shape *shape = _bodyNode->getCollisionShape();
 
@@ -90,18 +92,45 @@ FCLMESHCollisionNode::FCLMESHCollisionNode(kinematics::BodyNode* _bodyNode)
             std::cout << "ERROR: Collision checking does not support " << _bodyNode->getName() << "'s Shape type\n";
             break;
     }
+
+    if (mMesh) {
+        mMesh->computeLocalAABB();
+        const fcl::AABB& aabb = mMesh->aabb_local;
+        setLocalAABB(Eigen::Vector3d(aabb.min_[0], aabb.min_[1], aabb.min_[2]),
+                     Eigen::Vector3d(aabb.max_[0], aabb.max_[1], aabb.max_[2]));
+    }
+}
+
+FCLMESHCollisionNode::FCLMESHCollisionNode(kinematics::BodyNode* _bodyNode,
+                                           FCLMESHCollisionNode* _prototype)
+    : CollisionNode(_bodyNode),
+      mMesh(_prototype->mMesh),
+      mMeshRefCount(_prototype->mMeshRefCount)
+{
+    // the narrowphase only reads the mesh, so nodes checked in parallel may
+    // share it
+    ++*mMeshRefCount;
+    if (mMesh) {
+        const fcl::AABB& aabb = mMesh->aabb_local;
+        setLocalAABB(Eigen::Vector3d(aabb.min_[0], aabb.min_[1], aabb.min_[2]),
+                     Eigen::Vector3d(aabb.max_[0], aabb.max_[1], aabb.max_[2]));
+    }
 }
 
 FCLMESHCollisionNode::~FCLMESHCollisionNode()
 {
-    if (mMesh)
-        delete mMesh;
+    if (--*mMeshRefCount == 0) {
+        if (mMesh)
+            delete mMesh;
+        delete mMeshRefCount;
+    }
 }
 
 int FCLMESHCollisionNode::checkCollision(
         FCLMESHCollisionNode* _otherNode,
         std::vector<Contact>* _contactPoints,
-        int _num_max_contact)
+        int _num_max_contact,
+        int _max_num_manifold)
 {
     evalRT();
     _otherNode->evalRT();
@@ -163,48 +192,13 @@ int FCLMESHCollisionNode::checkCollision(
     }
 
     const double ZERO = 0.000001;
-    const double ZERO2 = ZERO*ZERO;
-
-    std::vector<bool> markForDeletion(unfilteredContactPoints.size(), false);
-
-    // mark all the repeated points
-    for (unsigned int i = 0; i < unfilteredContactPoints.size(); i++) {
-        for (unsigned int j = i + 1; j < unfilteredContactPoints.size(); j++) {
-            Eigen::Vector3d diff = unfilteredContactPoints[i].point - unfilteredContactPoints[j].point;
-            if (diff.dot(diff) < 3 * ZERO2) {
-                markForDeletion[i] = true;
-                break;
-            }
-        }
-    }
 
-    // remove all the co-linear contact points
-    bool bremove;
-    for (unsigned int i = 0; i < unfilteredContactPoints.size(); i++) {
-        if(markForDeletion[i])
-            continue;
-        for (unsigned int j = 0; j < unfilteredContactPoints.size(); j++) {
-            if (j == i || markForDeletion[j])
-                continue;
-            if (markForDeletion[i])
-                break;
-            for (int k = j + 1; k < unfilteredContactPoints.size(); k++) {
-                if (i == k)
-                    continue;
-                Eigen::Vector3d  v = (unfilteredContactPoints[i].point - unfilteredContactPoints[j].point).cross(unfilteredContactPoints[i].point - unfilteredContactPoints[k].point);
-                if (v.dot(v) < ZERO2 && ((unfilteredContactPoints[i].point - unfilteredContactPoints[j].point).dot(unfilteredContactPoints[i].point - unfilteredContactPoints[k].point) < 0)) {
-                    markForDeletion[i] = true;
-                    break;
-                }
-            }
-        }
-    }
+    removeDuplicateContacts(&unfilteredContactPoints, std::sqrt(3.0) * ZERO);
+    reduceContactManifold(&unfilteredContactPoints, _max_num_manifold, ZERO);
 
-    for (unsigned int i = 0; i < unfilteredContactPoints.size(); i++) {
-        if(!markForDeletion[i]) {
-            _contactPoints->push_back(unfilteredContactPoints[i]);
-        }
-    }
+    _contactPoints->insert(_contactPoints->end(),
+                           unfilteredContactPoints.begin(),
+                           unfilteredContactPoints.end());
 
     ////////////////////////////////////////////////////////////////////////
     // TODO: SPECIAL TEST CODE FOR GAZEBO SUPPORT BRANCH !!!
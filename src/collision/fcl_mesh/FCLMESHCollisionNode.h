@@ -59,6 +59,13 @@ public:
     EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 
     FCLMESHCollisionNode(kinematics::BodyNode* _bodyNode);
+
+    /// @brief A node that shares the mesh of _prototype instead of building
+    /// its own, for a body with the same collision shape, e.g. the body of a
+    /// clone of its skeleton. The mesh is deleted with the last node sharing
+    /// it.
+    FCLMESHCollisionNode(kinematics::BodyNode* _bodyNode, FCLMESHCollisionNode* _prototype);
+
     virtual ~FCLMESHCollisionNode();
 
     fcl::BVHModel<fcl::OBBRSS>* mMesh;
@@ -67,7 +74,10 @@ public:
     fcl::Transform3f mFclWorldTrans;
     Eigen::Matrix4d mWorldTrans;
 
-    int checkCollision(FCLMESHCollisionNode* _otherNode, std::vector<Contact>* _contactPoints, int _max_num_contact);
+    /// @brief Append the contacts with _otherNode, at most _max_num_manifold
+    /// of them, to _contactPoints. Returns the number of intersecting
+    /// triangle pairs.
+    int checkCollision(FCLMESHCollisionNode* _otherNode, std::vector<Contact>* _contactPoints, int _max_num_contact, int _max_num_manifold = 4);
     void evalRT();
 
     int evalContactPosition(fcl::CollisionResult& _result, FCLMESHCollisionNode* _other, int _idx, Eigen::Vector3d& _contactPosition1, Eigen::Vector3d& _contactPosition2);
@@ -76,6 +86,9 @@ public:
     void drawCollisionTriangle(int _tri);
 
 private:
+    /// @brief Number of nodes sharing mMesh.
+    int* mMeshRefCount;
+
     inline int FFtest(fcl::Vec3f& r1, fcl::Vec3f& r2, fcl::Vec3f& r3, fcl::Vec3f& R1, fcl::Vec3f& R2, fcl::Vec3f& R3, fcl::Vec3f& res1, fcl::Vec3f& res2);
     inline bool EFtest(fcl::Vec3f& p0, fcl::Vec3f&p1, fcl::Vec3f& r1, fcl::Vec3f& r2, fcl::Vec3f& r3, fcl::Vec3f& p);
     inline fcl::Vec3f TransformVertex(fcl::Vec3f& _v);
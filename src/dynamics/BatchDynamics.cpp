@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2011, Georgia Tech Research Corporation
+ * All rights reserved.
+ *
+ * Author(s):
+ * Date:
+ *
+ * Geoorgia Tech Graphics Lab and Humanoid Robotics Lab
+ *
+ * Directed by Prof. C. Karen Liu and Prof. Mike Stilman
+ * <karenliu@cc.gatech.edu> <mstilman@cc.gatech.edu>
+ *
+ * This file is provided under the following "BSD-style" License:
+ *   Redistribution and use in source and binary forms, with or
+ *   without modification, are permitted provided that the following
+ *   conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *   CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *   INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *   MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ *   USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ *   AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *   LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *   ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *   POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "BatchDynamics.h"
+
+#include <algorithm>
+#include "SkeletonDynamics.h"
+#include "kinematics/FileInfoDof.h"
+
+using namespace Eigen;
+
+namespace dynamics {
+
+    void computeInverseDynamicsBatch(const std::vector<SkeletonDynamics*>& _workers,
+                                     const MatrixXd& _poses, double _timeStep,
+                                     const Vector3d& _gravity, MatrixXd& _torques) {
+        assert(!_workers.empty());
+        int nDofs = _poses.rows();
+        int nFrames = std::max(0, (int)_poses.cols() - 2);
+        _torques.resize(nDofs, nFrames);
+        if (nFrames == 0)
+            return;
+
+        int numThreads = 1;
+#ifdef _OPENMP
+        numThreads = std::max(1, std::min<int>(_workers.size(), nFrames));
+#endif
+        double invTimeStep = 1.0 / _timeStep;
+
+#pragma omp parallel for schedule(static, 1) num_threads(numThreads)
+        for (int t = 0; t < numThreads; t++) {
+            SkeletonDynamics* skel = _workers[t];
+            assert(skel->getNumDofs() == nDofs);
+            int begin = (long)nFrames * t / numThreads;
+            int end = (long)nFrames * (t + 1) / numThreads;
+
+            // per-thread buffers; the loop over the frames does not allocate
+            VectorXd q(nDofs), qdot(nDofs), qddot(nDofs), tau(nDofs);
+            for (int i = begin; i < end; i++) {
+                q = _poses.col(i);
+                qdot = (_poses.col(i + 1) - _poses.col(i)) * invTimeStep;
+                qddot = (_poses.col(i + 2) - 2 * _poses.col(i + 1) + _poses.col(i)) * (invTimeStep * invTimeStep);
+                skel->setPose(q, true, false);
+                skel->computeInverseDynamicsLinear(_gravity, &qdot, &qddot, tau, false, false);
+                _torques.col(i) = tau;
+            }
+        }
+    }
+
+    void computeInverseDynamicsBatch(const std::vector<SkeletonDynamics*>& _workers,
+                                     kinematics::FileInfoDof& _motion,
+                                     const Vector3d& _gravity, MatrixXd& _torques) {
+        int nFrames = _motion.getNumFrames();
+        int nDofs = nFrames > 0 ? _motion.getPoseAtFrame(0).size() : 0;
+        MatrixXd poses(nDofs, nFrames);
+        for (int i = 0; i < nFrames; i++)
+            poses.col(i) = _motion.getPoseAtFrame(i);
+        computeInverseDynamicsBatch(_workers, poses, 1.0 / _motion.getFPS(), _gravity, _torques);
+    }
+
+} // namespace dynamics
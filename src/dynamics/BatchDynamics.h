@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2011, Georgia Tech Research Corporation
+ * All rights reserved.
+ *
+ * Author(s):
+ * Date:
+ *
+ * Geoorgia Tech Graphics Lab and Humanoid Robotics Lab
+ *
+ * Directed by Prof. C. Karen Liu and Prof. Mike Stilman
+ * <karenliu@cc.gatech.edu> <mstilman@cc.gatech.edu>
+ *
+ * This file is provided under the following "BSD-style" License:
+ *   Redistribution and use in source and binary forms, with or
+ *   without modification, are permitted provided that the following
+ *   conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *   CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *   INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *   MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ *   USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ *   AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *   LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *   ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *   POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef DYNAMICS_BATCH_DYNAMICS_H
+#define DYNAMICS_BATCH_DYNAMICS_H
+
+#include <vector>
+#include <Eigen/Dense>
+
+namespace kinematics {
+    class FileInfoDof;
+} // namespace kinematics
+
+namespace dynamics {
+    class SkeletonDynamics;
+
+    /// Inverse dynamics of a whole motion clip. Column i of _poses is the pose
+    /// at frame i; the velocities and accelerations of a frame are the forward
+    /// differences over _timeStep, so _torques receives one column per frame
+    /// except the last two: the generalized forces for gravity, Coriolis and
+    /// inertial terms, without external forces.
+    /// The frames are split into contiguous ranges evaluated in parallel, one
+    /// range per entry of _workers; the workers must be separate instances of
+    /// the same skeleton, e.g. clones (SkeletonDynamics::clone), since
+    /// evaluation changes their pose and caches, and
+    /// the results do not depend on their number. _torques is not reallocated
+    /// if it already has the right size.
+    void computeInverseDynamicsBatch(const std::vector<SkeletonDynamics*>& _workers,
+                                     const Eigen::MatrixXd& _poses, double _timeStep,
+                                     const Eigen::Vector3d& _gravity, Eigen::MatrixXd& _torques);
+
+    /// Same as above for the frames and the frame rate of _motion.
+    void computeInverseDynamicsBatch(const std::vector<SkeletonDynamics*>& _workers,
+                                     kinematics::FileInfoDof& _motion,
+                                     const Eigen::Vector3d& _gravity, Eigen::MatrixXd& _torques);
+
+} // namespace dynamics
+
+#endif // #ifndef DYNAMICS_BATCH_DYNAMICS_H
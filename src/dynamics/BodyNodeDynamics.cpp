@@ -36,7 +36,9 @@
  */
 
 #include "BodyNodeDynamics.h"
+#include "SkeletonDynamics.h"
 #include "kinematics/Joint.h"
+#include "kinematics/Dof.h"
 #include "kinematics/Shape.h"
 #include "kinematics/Transformation.h"
 //#include "utils/UtilsMath.h"
@@ -57,6 +59,15 @@ namespace dynamics{
           mOmegaDotBody(Vector3d::Zero()),
           mExtForceBody(Vector3d::Zero()),
           mExtTorqueBody(Vector3d::Zero()),
+          mVelSpatial(math::Vector6d::Zero()),
+          mAccSpatial(math::Vector6d::Zero()),
+          mAccBias(math::Vector6d::Zero()),
+          mArtBias(math::Vector6d::Zero()),
+          mArtAccBias(math::Vector6d::Zero()),
+          mAccVelocityProduct(math::Vector6d::Zero()),
+          mVelDeriv(math::Vector6d::Zero()),
+          mAccDeriv(math::Vector6d::Zero()),
+          mForceDeriv(math::Vector6d::Zero()),
           mInitializedInvDyn(false),
           mInitializedNonRecursiveDyn(false),
           mGravityMode(true) {
@@ -149,65 +160,35 @@ namespace dynamics{
 //    }
 
     void BodyNodeDynamics::computeInvDynVelocities( const Vector3d &_gravity, const VectorXd *_qdot, const VectorXd *_qdotdot, bool _computeJacobians ) {
-        // update the local transform mT and the world transform mW
-        BodyNode::updateTransform();
-
-        mJwJoint = MatrixXd::Zero(3, mJointParent->getNumDofsRot());
-        mJwDotJoint = MatrixXd::Zero(3, mJointParent->getNumDofsRot());
-        
-        Vector3d omegaJoint = Vector3d::Zero();
-        Vector3d omegaDotJoint = Vector3d::Zero();
-
-        // Local Rotation matrix transposed
-        Matrix3d RjointT = mT.topLeftCorner<3,3>().transpose();
-
-        if(mJointParent->getJointType() != Joint::J_UNKNOWN && mJointParent->getJointType() != Joint::J_TRANS){
-            // ASSUME: trans dofs before rotation dofs
-            VectorXd qDotJoint = _qdot->segment(mJointParent->getFirstRotDofIndex(), mJointParent->getNumDofsRot());
-            mJointParent->computeRotationJac(&mJwJoint, &mJwDotJoint, &qDotJoint);
-
-            // Local angular velocity and angular acceleration
-            omegaJoint.noalias() = mJwJoint * qDotJoint;
-            omegaDotJoint.noalias() = mJwDotJoint * qDotJoint;
-            if(_qdotdot){
-                VectorXd qDotDotJoint = _qdotdot->segment(mJointParent->getFirstRotDofIndex(), mJointParent->getNumDofsRot());
-                omegaDotJoint.noalias() += mJwJoint * qDotDotJoint;
-            }
-        }
+        // spatial velocity and velocity product terms from the motion subspace of the joint
+        computeSpatialVelocity(*_qdot);
 
         BodyNodeDynamics *nodeParent = static_cast<BodyNodeDynamics*>(mNodeParent);
-        Vector3d cl = mCOMLocal;
         if(nodeParent){
             assert(mJointParent->getNumDofsTrans()==0); // assuming no internal translation dofs
-            Vector3d clparent = nodeParent->getLocalCOM();
-            Vector3d rl = mT.topRightCorner<3,1>();    // translation from parent's origin to self origin
-
-            mOmegaBody.noalias() = RjointT * (nodeParent->mOmegaBody + omegaJoint);
-            mOmegaDotBody.noalias() = RjointT * (nodeParent->mOmegaDotBody + omegaDotJoint + nodeParent->mOmegaBody.cross(omegaJoint));
-            mVelBody = mOmegaBody.cross(cl);
-            mVelBody.noalias() += RjointT * (nodeParent->mVelBody + nodeParent->mOmegaBody.cross(rl-clparent));
-            mVelDotBody = mOmegaDotBody.cross(cl) + mOmegaBody.cross(mOmegaBody.cross(cl));
-            mVelDotBody.noalias() += RjointT * (nodeParent->mVelDotBody + nodeParent->mOmegaDotBody.cross(rl-clparent) + nodeParent->mOmegaBody.cross(nodeParent->mOmegaBody.cross(rl-clparent)));
+            mAccSpatial = mXParent.apply(nodeParent->mAccSpatial);
         }
         // base case: root
         else {
-            mOmegaBody.noalias() = RjointT * omegaJoint;
-            mOmegaDotBody.noalias() = RjointT * omegaDotJoint;
-            mVelBody = mOmegaBody.cross(cl);
-            mVelDotBody = mOmegaDotBody.cross(cl) + mOmegaBody.cross(mOmegaBody.cross(cl));
             // incorporate gravity as part of acceleration by changing frame to the one accelerating with g
             // Therefore real acceleration == W*mVelDotBody + g;
-            mVelDotBody.noalias() -= RjointT * _gravity;
-            // if root has translation DOFs
-            if(mJointParent->getNumDofsTrans()>0){
-                VectorXd qDotTransJoint = _qdot->segment(mJointParent->getFirstTransDofIndex(), mJointParent->getNumDofsTrans());
-                mVelBody.noalias() += RjointT * qDotTransJoint;
-                if(_qdotdot){
-                    VectorXd qDotDotTransJoint = _qdotdot->segment(mJointParent->getFirstTransDofIndex(), mJointParent->getNumDofsTrans());
-                    mVelDotBody.noalias() += RjointT * qDotDotTransJoint;
-                }
-            }
+            mAccSpatial.head<3>().setZero();
+            mAccSpatial.tail<3>().noalias() = -mXParent.E * _gravity;
         }
+        mAccSpatial += mAccBias;
+        if(_qdotdot){
+            for(int i=0; i<getNumLocalDofs(); i++)
+                mAccSpatial.noalias() += mS.col(i) * (*_qdotdot)[getDof(i)->getSkelIndex()];
+        }
+
+        // velocity and acceleration of the center of mass in the local frame; the
+        // classical acceleration of the origin is the spatial one plus w x v
+        Vector3d cl = mCOMLocal;
+        Vector3d velOrigin = mVelSpatial.tail<3>();
+        mOmegaBody = mVelSpatial.head<3>();
+        mOmegaDotBody = mAccSpatial.head<3>();
+        mVelBody = velOrigin + mOmegaBody.cross(cl);
+        mVelDotBody = mAccSpatial.tail<3>() + mOmegaBody.cross(velOrigin) + mOmegaDotBody.cross(cl) + mOmegaBody.cross(mOmegaBody.cross(cl));
 
         // compute Jacobians iteratively
         if(_computeJacobians){
@@ -236,6 +217,7 @@ namespace dynamics{
                     mJv.leftCols(mJointParent->getNumDofsTrans()) += MatrixXd::Identity(3,mJointParent->getNumDofsTrans());
                 }
             }
+            mJacDirty = false;
         }
     }
 
@@ -243,27 +225,22 @@ namespace dynamics{
                                                const VectorXd* /*_qdot*/,
                                                const VectorXd* /*_qdotdot*/,
                                                bool _withExternalForces) {
-        mForceJointBody.setZero();
-        mTorqueJointBody.setZero();
-        Vector3d cl = mCOMLocal;
+        math::Vector6d force = math::Vector6d::Zero();
 
         // base case: end effectors
         if(mVizShape != NULL) {
-            mForceJointBody = mMass*mVelDotBody;
-            mTorqueJointBody = cl.cross(mMass*mVelDotBody)
-                               + mOmegaBody.cross(mI*mOmegaBody)
-                               + mI*mOmegaDotBody;
+            math::SpatialInertia inertia = getSpatialInertia();
+            force = inertia * mAccSpatial;
+            force += math::crossForce(mVelSpatial, inertia * mVelSpatial);
         }
 
         // general case
         for(unsigned int j = 0; j < mJointsChild.size(); j++) {
             BodyNodeDynamics *bchild = static_cast<BodyNodeDynamics*>(
                                            mJointsChild[j]->getChildNode());
-            Matrix3d Rchild = bchild->mT.topLeftCorner(3,3);
-            Vector3d forceChildNode = Rchild*bchild->mForceJointBody;
-            mForceJointBody += forceChildNode;
-            Vector3d rlchild = bchild->mT.col(3).head(3);
-            mTorqueJointBody += (rlchild).cross(forceChildNode) + Rchild*bchild->mTorqueJointBody;
+            math::Vector6d forceChildNode;
+            forceChildNode << bchild->mTorqueJointBody, bchild->mForceJointBody;
+            force += bchild->mXParent.applyTranspose(forceChildNode);
         }
 
         if( _withExternalForces ) {
@@ -272,9 +249,379 @@ namespace dynamics{
                 mExtForceBody += mContacts.at(i).second;
                 mExtTorqueBody += mContacts.at(i).first.cross(mContacts.at(i).second);
             }
-            mForceJointBody -= mExtForceBody;
-            mTorqueJointBody -= mExtTorqueBody;
+            force.head<3>() -= mExtTorqueBody;
+            force.tail<3>() -= mExtForceBody;
         }// endif compute external forces
+
+        mTorqueJointBody = force.head<3>();
+        mForceJointBody = force.tail<3>();
+    }
+
+    void BodyNodeDynamics::evalMotionSubspace() {
+        const int numDofsTrans = mJointParent->getNumDofsTrans();
+        const int numDofsRot = mJointParent->getNumDofsRot();
+
+        mXParent = math::SpatialTransform(mT);
+
+        mS = MatrixXd::Zero(6, getNumLocalDofs());
+        // ASSUME: trans dofs before rotation dofs
+        if(numDofsRot>0)
+            mS.block(0, numDofsTrans, 3, numDofsRot).noalias() = mXParent.E * mJwJoint;
+        if(numDofsTrans>0){
+            assert(mNodeParent == NULL); // assuming no internal translation dofs
+            assert(numDofsTrans == 3); // ASSUME - 3 translational dofs expressed in the parent frame
+            mS.block<3,3>(3, 0) = mXParent.E;
+        }
+    }
+
+    void BodyNodeDynamics::computeSpatialVelocity( const VectorXd &_qdot ) {
+        // update the local transform mT and the world transform mW
+        BodyNode::updateTransform();
+
+        const int numLocalDofs = getNumLocalDofs();
+        const int numDofsRot = mJointParent->getNumDofsRot();
+
+        mJwJoint = MatrixXd::Zero(3, numDofsRot);
+        mJwDotJoint = MatrixXd::Zero(3, numDofsRot);
+
+        // relative angular velocity of the joint and its velocity product term, both in the local frame
+        Matrix3d RjointT = mT.topLeftCorner<3,3>().transpose();
+        Vector3d omegaJoint = Vector3d::Zero();
+        Vector3d omegaDotJoint = Vector3d::Zero();
+        if(mJointParent->getJointType() != Joint::J_UNKNOWN && mJointParent->getJointType() != Joint::J_TRANS){
+            mQdotJoint = _qdot.segment(mJointParent->getFirstRotDofIndex(), numDofsRot);
+            mJointParent->computeRotationJac(&mJwJoint, &mJwDotJoint, &mQdotJoint);
+            // through fixed-size vectors, so that no temporary is allocated
+            Vector3d omegaJointParent;
+            omegaJointParent.noalias() = mJwJoint * mQdotJoint;
+            omegaJoint.noalias() = RjointT * omegaJointParent;
+            omegaJointParent.noalias() = mJwDotJoint * mQdotJoint;
+            omegaDotJoint.noalias() = RjointT * omegaJointParent;
+        }
+        evalMotionSubspace();
+
+        BodyNodeDynamics *nodeParent = static_cast<BodyNodeDynamics*>(mNodeParent);
+        if(nodeParent)
+            mVelSpatial = mXParent.apply(nodeParent->mVelSpatial);
+        else
+            mVelSpatial.setZero();
+        for(int i=0; i<numLocalDofs; i++)
+            mVelSpatial.noalias() += mS.col(i) * _qdot[getDof(i)->getSkelIndex()];
+
+        // the translation dofs of the root are expressed in the parent frame, so only the
+        // rotational part of the joint velocity is fixed in the local frame
+        Vector3d omega = mVelSpatial.head<3>();
+        Vector3d vel = mVelSpatial.tail<3>();
+        mAccBias.head<3>() = omegaDotJoint + omega.cross(omegaJoint);
+        mAccBias.tail<3>() = vel.cross(omegaJoint);
+    }
+
+    math::SpatialInertia BodyNodeDynamics::getSpatialInertia() const {
+        return math::SpatialInertia(mMass, mCOMLocal, mI);
+    }
+
+    void BodyNodeDynamics::computeArtBodyVelocities( const VectorXd &_qdot, bool _withExternalForces ) {
+        computeSpatialVelocity(_qdot);
+
+        mArtInertia = getSpatialInertia().toMatrix();
+
+        // gyroscopic bias force: v x* (I*v)
+        mArtBias = math::crossForce(mVelSpatial, mArtInertia * mVelSpatial);
+
+        if( _withExternalForces ) {
+            for(unsigned int i = 0; i < mContacts.size(); i++){
+                mArtBias.head<3>() -= mContacts[i].first.cross(mContacts[i].second);
+                mArtBias.tail<3>() -= mContacts[i].second;
+            }
+            mArtBias.head<3>() -= mExtTorqueBody;
+        }
+    }
+
+    void BodyNodeDynamics::computeArtBodyInertias( const VectorXd &_tau, const std::vector<bool> *_prescribed, const VectorXd *_qdotdot ) {
+        // mArtInertia and mArtBias already contain the contributions of the children
+        const int numLocalDofs = getNumLocalDofs();
+
+        // the known accelerations of the prescribed dofs act like the velocity product term
+        mArtAccBias = mAccBias;
+        mArtFreeDofs.clear();
+        for(int i=0; i<numLocalDofs; i++){
+            int dof = getDof(i)->getSkelIndex();
+            if(_prescribed && (*_prescribed)[dof])
+                mArtAccBias.noalias() += mS.col(i) * (*_qdotdot)[dof];
+            else
+                mArtFreeDofs.push_back(i);
+        }
+        const int numFreeDofs = mArtFreeDofs.size();
+        mArtS.resize(6, numFreeDofs);
+        mArtTau.resize(numFreeDofs);
+        for(int i=0; i<numFreeDofs; i++){
+            mArtS.col(i) = mS.col(mArtFreeDofs[i]);
+            mArtTau[i] = _tau[getDof(mArtFreeDofs[i])->getSkelIndex()];
+        }
+
+        mArtU.noalias() = mArtInertia * mArtS;
+        mArtTau.noalias() -= mArtS.transpose() * mArtBias;
+        if(numFreeDofs > 0)
+            mArtDInv = (mArtS.transpose() * mArtU).inverse();
+        else
+            mArtDInv.resize(0, 0);
+
+        BodyNodeDynamics *nodeParent = static_cast<BodyNodeDynamics*>(mNodeParent);
+        if(nodeParent == NULL)
+            return;
+
+        math::Matrix6Xd UDInv = mArtU * mArtDInv;
+        math::Matrix6d Ia = mArtInertia;
+        Ia.noalias() -= UDInv * mArtU.transpose();
+        math::Vector6d pa = mArtBias;
+        pa.noalias() += Ia * mArtAccBias;
+        pa.noalias() += UDInv * mArtTau;
+
+        // transform to the parent frame: forces transform with the transpose of mXParent
+        nodeParent->mArtInertia += mXParent.applyCongruence(Ia);
+        nodeParent->mArtBias += mXParent.applyTranspose(pa);
+    }
+
+    void BodyNodeDynamics::computeArtBodyAccelerations( const Vector3d &_gravity, VectorXd &_qdotdot, VectorXd *_tau ) {
+        BodyNodeDynamics *nodeParent = static_cast<BodyNodeDynamics*>(mNodeParent);
+        math::Vector6d accParent;
+        if(nodeParent) {
+            accParent = mXParent.apply(nodeParent->mAccSpatial);
+        }
+        // base case: root
+        else {
+            // incorporate gravity as part of acceleration by changing frame to the one accelerating with g
+            accParent.head<3>().setZero();
+            accParent.tail<3>().noalias() = -mXParent.E * _gravity;
+        }
+        accParent += mArtAccBias;
+
+        math::VectorJointd qDotDotLocal = mArtDInv * (mArtTau - mArtU.transpose() * accParent);
+        for(unsigned int i=0; i<mArtFreeDofs.size(); i++)
+            _qdotdot[getDof(mArtFreeDofs[i])->getSkelIndex()] = qDotDotLocal[i];
+
+        mAccSpatial = accParent;
+        mAccSpatial.noalias() += mArtS * qDotDotLocal;
+
+        // the joint transmits the force that moves the articulated body with mAccSpatial; its
+        // projection on the prescribed dofs is what they take to follow their accelerations
+        if(_tau && (int)mArtFreeDofs.size() < getNumLocalDofs()) {
+            math::Vector6d force = mArtInertia * mAccSpatial + mArtBias;
+            for(int i=0, j=0; i<getNumLocalDofs(); i++) {
+                if(j < (int)mArtFreeDofs.size() && mArtFreeDofs[j] == i)
+                    j++;
+                else
+                    (*_tau)[getDof(i)->getSkelIndex()] = mS.col(i).dot(force);
+            }
+        }
+    }
+
+    void BodyNodeDynamics::initCompositeInertia() {
+        // mJwJoint is not computed by the non-recursive dynamics
+        if(mJointParent->getJointType() != Joint::J_UNKNOWN && mJointParent->getJointType() != Joint::J_TRANS)
+            mJointParent->computeRotationJac(&mJwJoint, NULL, NULL);
+        else
+            mJwJoint = MatrixXd::Zero(3, mJointParent->getNumDofsRot());
+        evalMotionSubspace();
+        mCompositeInertia = getSpatialInertia();
+    }
+
+    void BodyNodeDynamics::computeCompositeInertia() {
+        // mCompositeInertia already contains the contributions of the children
+        BodyNodeDynamics *nodeParent = static_cast<BodyNodeDynamics*>(mNodeParent);
+        if(nodeParent)
+            nodeParent->mCompositeInertia += mXParent.applyTranspose(mCompositeInertia);
+    }
+
+    void BodyNodeDynamics::aggregateMassCRBA(MatrixXd &_M) {
+        const int numLocalDofs = getNumLocalDofs();
+        if(numLocalDofs == 0)
+            return;
+
+        // spatial forces needed to accelerate the subtree by each local dof, in the frame of nodej
+        // at most 6 local dofs: fixed maximum sizes avoid heap allocations in the loop below
+        Matrix<double,6,Dynamic,0,6,6> S = mS;
+        Matrix<double,6,Dynamic,0,6,6> F = mCompositeInertia * S;
+        Matrix<double,Dynamic,Dynamic,0,6,6> Mii = S.transpose() * F;
+        for(int i=0; i<numLocalDofs; i++)
+            for(int j=0; j<numLocalDofs; j++)
+                _M(getDof(i)->getSkelIndex(), getDof(j)->getSkelIndex()) = Mii(i, j);
+
+        // off-diagonal blocks with all the ancestors
+        BodyNodeDynamics *nodej = this;
+        while(nodej->mNodeParent) {
+            F = nodej->mXParent.applyTranspose(F);
+            nodej = static_cast<BodyNodeDynamics*>(nodej->mNodeParent);
+            if(nodej->getNumLocalDofs() == 0)
+                continue;
+            Matrix<double,Dynamic,Dynamic,0,6,6> Mji = nodej->mS.transpose() * F;
+            for(int j=0; j<nodej->getNumLocalDofs(); j++){
+                int dofj = nodej->getDof(j)->getSkelIndex();
+                for(int i=0; i<numLocalDofs; i++){
+                    int dofi = getDof(i)->getSkelIndex();
+                    _M(dofj, dofi) = Mji(j, i);
+                    _M(dofi, dofj) = Mji(j, i);
+                }
+            }
+        }
+    }
+
+    void BodyNodeDynamics::computeVelocityProductAcceleration() {
+        BodyNodeDynamics *nodeParent = static_cast<BodyNodeDynamics*>(mNodeParent);
+        if(nodeParent)
+            mAccVelocityProduct = mXParent.apply(nodeParent->mAccVelocityProduct);
+        else
+            mAccVelocityProduct.setZero();
+        mAccVelocityProduct += mAccBias;
+    }
+
+    void BodyNodeDynamics::evalTaskJacobian(const Vector3d &_offset, bool _withOrientation, int _row, MatrixXd &_J) {
+        // the point moves with the center of mass plus w x (R*(offset - com))
+        Matrix3d offsetSkew = math::makeSkewSymmetric(mW.topLeftCorner<3,3>() * (_offset - mCOMLocal));
+        for(int i=0; i<getNumDependentDofs(); i++){
+            int dof = mDependentDofs[i];
+            _J.block<3,1>(_row, dof) = mJv.col(i) - offsetSkew * mJw.col(i);
+            if(_withOrientation)
+                _J.block<3,1>(_row + 3, dof) = mJw.col(i);
+        }
+    }
+
+    void BodyNodeDynamics::evalTaskBiasAcceleration(const Vector3d &_offset, bool _withOrientation, int _row, VectorXd &_acc) const {
+        // classical acceleration of the point from the spatial acceleration
+        // of the body, as for the center of mass in computeInvDynVelocities
+        Vector3d omega = mVelSpatial.head<3>();
+        Vector3d velOrigin = mVelSpatial.tail<3>();
+        Vector3d omegaDot = mAccVelocityProduct.head<3>();
+        Vector3d acc = mAccVelocityProduct.tail<3>() + omega.cross(velOrigin) + omegaDot.cross(_offset) + omega.cross(omega.cross(_offset));
+        _acc.segment<3>(_row).noalias() = mW.topLeftCorner<3,3>() * acc;
+        if(_withOrientation)
+            _acc.segment<3>(_row + 3).noalias() = mW.topLeftCorner<3,3>() * omegaDot;
+    }
+
+    void BodyNodeDynamics::aggregateCentroidalMomentum(const Vector3d &_com, MatrixXd &_AG, VectorXd &_bias) {
+        // spatial forces in the local frame are moved to the center of mass
+        // as n + r x f, with r from the center of mass to the local origin
+        Matrix3d R = mW.topLeftCorner<3,3>();
+        Vector3d r = mW.topRightCorner<3,1>() - _com;
+
+        const int numLocalDofs = getNumLocalDofs();
+        if(numLocalDofs > 0) {
+            // at most 6 local dofs, as in aggregateMassCRBA
+            Matrix<double,6,Dynamic,0,6,6> S = mS;
+            Matrix<double,6,Dynamic,0,6,6> F = mCompositeInertia * S;
+            for(int i=0; i<numLocalDofs; i++){
+                int dof = getDof(i)->getSkelIndex();
+                Vector3d force = R * F.block<3,1>(3, i);
+                _AG.block<3,1>(0, dof) = R * F.block<3,1>(0, i) + r.cross(force);
+                _AG.block<3,1>(3, dof) = force;
+            }
+        }
+
+        math::SpatialInertia inertia = getSpatialInertia();
+        math::Vector6d momentum = inertia * mVelSpatial;
+        math::Vector6d rate = inertia * mAccVelocityProduct + math::crossForce(mVelSpatial, momentum);
+        Vector3d force = R * rate.tail<3>();
+        _bias.head<3>() += R * rate.head<3>() + r.cross(force);
+        _bias.tail<3>() += force;
+    }
+
+    void BodyNodeDynamics::evalJointDerivatives( const VectorXd &_qdot ) {
+        const int numLocalDofs = getNumLocalDofs();
+        const int numDofsTrans = mJointParent->getNumDofsTrans();
+        const int numDofsRot = mJointParent->getNumDofsRot();
+
+        mSDeriv.assign(numLocalDofs, MatrixXd::Zero(6, numLocalDofs));
+        mAccBiasDerivPose = MatrixXd::Zero(6, numLocalDofs);
+        mAccBiasDerivVel = MatrixXd::Zero(6, numLocalDofs);
+        // the translation dofs of the root move neither the axes nor the local frame
+        if(numDofsRot == 0 || mJointParent->getJointType() == Joint::J_UNKNOWN || mJointParent->getJointType() == Joint::J_TRANS)
+            return;
+
+        VectorXd qDotJoint = _qdot.segment(mJointParent->getFirstRotDofIndex(), numDofsRot);
+        Vector3d omegaDotJoint = mXParent.E * (mJwDotJoint * qDotJoint);
+        MatrixXd dJ, dJdot;
+        for(int k=numDofsTrans; k<numLocalDofs; k++){
+            mJointParent->computeRotationJacDeriv(k - numDofsTrans, qDotJoint, &dJ, &dJdot);
+            // the local frame turns by the axis of the dof, i.e. dE/dq_k = -[S_k]x*E; on top of
+            // that the axes of the joint move in the parent frame
+            math::Vector6d sk = mS.col(k);
+            for(int i=0; i<numLocalDofs; i++)
+                mSDeriv[k].col(i) = -math::crossMotion(sk, mS.col(i));
+            mSDeriv[k].block(0, numDofsTrans, 3, numDofsRot).noalias() += mXParent.E * dJ;
+            mAccBiasDerivPose.block<3,1>(0, k) = mXParent.E * (dJdot * qDotJoint) - sk.head<3>().cross(omegaDotJoint);
+            mAccBiasDerivVel.block<3,1>(0, k) = mXParent.E * (dJ * qDotJoint + mJwDotJoint.col(k - numDofsTrans));
+        }
+    }
+
+    void BodyNodeDynamics::computeInvDynDerivVelocities( const VectorXd &_qdot, const VectorXd &_qdotdot, int _localDof, bool _wrtVel ) {
+        const int numLocalDofs = getNumLocalDofs();
+        VectorXd qDotLocal(numLocalDofs);
+        for(int i=0; i<numLocalDofs; i++)
+            qDotLocal[i] = _qdot[getDof(i)->getSkelIndex()];
+
+        // mAccBias = v x u + (joint part), with u the rotational part of the joint velocity
+        math::Vector6d jointVel = mS * qDotLocal;
+        math::Vector6d u;
+        u << jointVel.head<3>(), Vector3d::Zero();
+
+        if(_localDof < 0) {
+            BodyNodeDynamics *nodeParent = static_cast<BodyNodeDynamics*>(mNodeParent);
+            mVelDeriv = mXParent.apply(nodeParent->mVelDeriv);
+            mAccDeriv = mXParent.apply(nodeParent->mAccDeriv);
+            mAccDeriv += math::crossMotion(mVelDeriv, u);
+            return;
+        }
+
+        math::Vector6d sk = mS.col(_localDof);
+        math::Vector6d du = math::Vector6d::Zero();
+        if(_wrtVel) {
+            mVelDeriv = sk;
+            du.head<3>() = sk.head<3>();
+            mAccDeriv = mAccBiasDerivVel.col(_localDof);
+        }
+        else {
+            VectorXd qDotDotLocal(numLocalDofs);
+            for(int i=0; i<numLocalDofs; i++)
+                qDotDotLocal[i] = _qdotdot[getDof(i)->getSkelIndex()];
+            // the parent quantities seen through mXParent turn with the dof: d(X*m)/dq = -S_k x (X*m)
+            math::Vector6d velParent = mVelSpatial - jointVel;
+            math::Vector6d accParent = mAccSpatial - mAccBias;
+            accParent.noalias() -= mS * qDotDotLocal;
+            math::Vector6d dJointVel = mSDeriv[_localDof] * qDotLocal;
+            mVelDeriv = dJointVel - math::crossMotion(sk, velParent);
+            du.head<3>() = dJointVel.head<3>();
+            mAccDeriv = mAccBiasDerivPose.col(_localDof) - math::crossMotion(sk, accParent);
+            mAccDeriv.noalias() += mSDeriv[_localDof] * qDotDotLocal;
+        }
+        mAccDeriv += math::crossMotion(mVelDeriv, u);
+        mAccDeriv += math::crossMotion(mVelSpatial, du);
+    }
+
+    void BodyNodeDynamics::computeInvDynDerivForces( int _localDof, bool _wrtVel, VectorXd &_tauDeriv ) {
+        mForceDeriv.setZero();
+        // as in computeInvDynForces, only the nodes with a shape carry inertia
+        if(mVizShape != NULL) {
+            math::SpatialInertia inertia = getSpatialInertia();
+            mForceDeriv = inertia * mAccDeriv;
+            mForceDeriv += math::crossForce(mVelDeriv, inertia * mVelSpatial);
+            mForceDeriv += math::crossForce(mVelSpatial, inertia * mVelDeriv);
+        }
+        for(unsigned int j = 0; j < mJointsChild.size(); j++) {
+            BodyNodeDynamics *bchild = static_cast<BodyNodeDynamics*>(mJointsChild[j]->getChildNode());
+            mForceDeriv += bchild->mXParent.applyTranspose(bchild->mForceDeriv);
+        }
+
+        for(int i=0; i<getNumLocalDofs(); i++)
+            _tauDeriv[getDof(i)->getSkelIndex()] = mS.col(i).dot(mForceDeriv);
+
+        if(_localDof >= 0 && !_wrtVel) {
+            math::Vector6d force;
+            force << mTorqueJointBody, mForceJointBody;
+            for(int i=0; i<getNumLocalDofs(); i++)
+                _tauDeriv[getDof(i)->getSkelIndex()] += mSDeriv[_localDof].col(i).dot(force);
+            // the parent receives mXParent^T*force, and dX^T/dq = X^T*(S_k x*)
+            mForceDeriv += math::crossForce(mS.col(_localDof), force);
+        }
     }
 
     Matrix4d BodyNodeDynamics::getLocalSecondDeriv(const Dof *_q1,const Dof *_q2 ) const {
@@ -479,6 +826,7 @@ namespace dynamics{
     }
 
     void BodyNodeDynamics::evalExternalForces( VectorXd& _extForce ){
+        updateFirstDerivativesIfDirty();
         mFext = VectorXd::Zero(getNumDependentDofs());
 
         // contribution of linear force
@@ -532,10 +880,10 @@ namespace dynamics{
 
         Matrix3d Ri = getLocalTransform().topLeftCorner<3,3>();
         if( _isTorque ){
-            VectorXd torque = mJwJoint.transpose() * (Ri * _cForce);
+            Vector3d torque = Ri * _cForce;
             int firstRotDof = joint->getFirstRotDofIndex();
             for(int i=0; i<joint->getNumDofsRot(); i++)
-                _gForce(firstRotDof+i) += torque(i);
+                _gForce(firstRotDof+i) += mJwJoint.col(i).dot(torque);
         }else{
             if(joint->getNumDofsTrans()>0){
                 assert(joint->getNumDofsTrans()==3); // assume translational dofs are always for all three
@@ -597,6 +945,9 @@ namespace dynamics{
         if( !_isForceLocal )
             force.noalias() = mW.topLeftCorner<3,3>().transpose() * _force;
         mContacts.push_back( pair<Vector3d, Vector3d>(pos, force) );
+        // a push wakes a sleeping skeleton
+        if( !_force.isZero() && getSkel() != NULL )
+            static_cast<SkeletonDynamics*>(getSkel())->setAsleep(false);
     }
 
     void BodyNodeDynamics::addExtTorque( const Vector3d& _torque, bool _isLocal ){
@@ -604,6 +955,8 @@ namespace dynamics{
             mExtTorqueBody += _torque;
         else
             mExtTorqueBody += mW.topLeftCorner(3,3).transpose()*_torque; 
+        if( !_torque.isZero() && getSkel() != NULL )
+            static_cast<SkeletonDynamics*>(getSkel())->setAsleep(false);
     }
 
     void BodyNodeDynamics::clearExternalForces(){
@@ -43,6 +43,7 @@
 #include "kinematics/BodyNode.h"
 #include "math/EigenHelper.h"
 #include "math/UtilsMath.h"
+#include "math/UtilsSpatial.h"
 
 namespace dynamics {
     /**
@@ -90,6 +91,7 @@ namespace dynamics {
         // Inverse Dynamics
         Eigen::MatrixXd mJwJoint;    ///< Jacobian matrix for the parent joint
         Eigen::MatrixXd mJwDotJoint;    ///< Time derivative of the Jacobian matrix for the parent joint
+        Eigen::VectorXd mQdotJoint;    ///< Velocities of the rotational dofs of the parent joint, kept between the calls of computeSpatialVelocity
         Eigen::Vector3d mVelBody; ///< linear velocity expressed in the *local frame* of the body 
         Eigen::Vector3d mVelDotBody; ///< linear acceleration expressed in the *local frame* of the body 
         Eigen::Vector3d mOmegaBody;    ///< angular velocity expressed in the *local frame* of the body 
@@ -99,8 +101,62 @@ namespace dynamics {
         Eigen::Vector3d mExtForceBody; ///< the external Cartesian force applied to the body; usually computed from mContacts
         Eigen::Vector3d mExtTorqueBody; ///< the external Cartesian torque applied to the body; usually directly supplied from outside; contribution of the linear force will be considered later in the computation
         
-        void computeInvDynVelocities( const Eigen::Vector3d &_gravity, const Eigen::VectorXd *_qdot, const Eigen::VectorXd *_qdotdot, bool _computeJacobians=true );   ///< computes the velocities in the first pass of the algorithm; also computes Transform W etc using updateTransform; computes Jacobians Jv and Jw if the flag is true; replaces updateFirstDerivatives of non-recursive dynamics
-        void computeInvDynForces( const Eigen::Vector3d &_gravity, const Eigen::VectorXd *_qdot, const Eigen::VectorXd *_qdotdot, bool _withExternalForces );   ///< computes the forces in the second pass of the algorithm
+        void computeInvDynVelocities( const Eigen::Vector3d &_gravity, const Eigen::VectorXd *_qdot, const Eigen::VectorXd *_qdotdot, bool _computeJacobians=true );   ///< computes the spatial velocities and accelerations in the first pass of the recursive Newton-Euler algorithm, and the body quantities mVelBody etc. from them; also computes Transform W etc using updateTransform; computes Jacobians Jv and Jw if the flag is true; replaces updateFirstDerivatives of non-recursive dynamics
+        void computeInvDynForces( const Eigen::Vector3d &_gravity, const Eigen::VectorXd *_qdot, const Eigen::VectorXd *_qdotdot, bool _withExternalForces );   ///< computes the spatial joint force in the second pass of the algorithm and stores it in mTorqueJointBody and mForceJointBody
+
+        // Spatial quantities shared by the recursive algorithms; they are [angular; linear] and refer to the origin of the local frame
+        math::Vector6d mVelSpatial; ///< spatial velocity of the body expressed in the *local frame*
+        math::Vector6d mAccSpatial; ///< spatial acceleration of the body expressed in the *local frame*; includes the fictitious acceleration due to gravity
+        math::Vector6d mAccBias; ///< velocity product acceleration of the parent joint: the part of mAccSpatial that does not depend on the accelerations
+        math::SpatialTransform mXParent; ///< spatial transform of motion vectors from the parent frame to the local frame
+        Eigen::MatrixXd mS; ///< motion subspace of the parent joint expressed in the local frame; dimension 6 x numLocalDofs
+
+        void evalMotionSubspace(); ///< builds mS from mJwJoint and mXParent from mT; both must be up to date
+        void computeSpatialVelocity( const Eigen::VectorXd &_qdot ); ///< updates the transforms, mJwJoint and mJwDotJoint, the joint motion subspace, mVelSpatial and mAccBias; the parent must be up to date
+        math::SpatialInertia getSpatialInertia() const; ///< rigid body spatial inertia about the local origin, expressed in the local frame
+
+        // Articulated body forward dynamics
+        math::Matrix6d mArtInertia; ///< articulated body inertia expressed in the local frame
+        math::Vector6d mArtBias; ///< articulated body bias force expressed in the local frame
+        std::vector<int> mArtFreeDofs; ///< local indices of the dofs whose accelerations are solved for: all of them, except the prescribed ones in hybrid dynamics
+        math::Matrix6Xd mArtS; ///< the columns of mS of the free dofs
+        math::Vector6d mArtAccBias; ///< mAccBias plus the acceleration of the prescribed dofs
+        math::Matrix6Xd mArtU; ///< mArtInertia*mArtS
+        math::MatrixJointd mArtDInv; ///< inverse of mArtS^T*mArtInertia*mArtS
+        math::VectorJointd mArtTau; ///< generalized forces of the free dofs minus the part that balances mArtBias
+
+        void computeArtBodyVelocities( const Eigen::VectorXd &_qdot, bool _withExternalForces );   ///< first pass of the articulated body algorithm (root to leaves): computes the spatial velocity, and initializes mArtInertia and mArtBias with the rigid body quantities
+        void computeArtBodyInertias( const Eigen::VectorXd &_tau, const std::vector<bool> *_prescribed = NULL, const Eigen::VectorXd *_qdotdot = NULL );   ///< second pass (leaves to root): completes the articulated body inertia and bias force of this node and adds their contribution to the parent. The dofs flagged in _prescribed, if given, move with the accelerations in _qdotdot instead of being driven by _tau
+        void computeArtBodyAccelerations( const Eigen::Vector3d &_gravity, Eigen::VectorXd &_qdotdot, Eigen::VectorXd *_tau = NULL );   ///< third pass (root to leaves): solves the accelerations of the free local dofs into _qdotdot and computes mAccSpatial; if _tau is given, the generalized forces of the prescribed dofs that produce their accelerations are written into it
+
+        // Composite rigid body mass matrix
+        math::SpatialInertia mCompositeInertia; ///< spatial inertia of the subtree rooted at this node, expressed in the local frame
+
+        void initCompositeInertia(); ///< first pass of the composite rigid body algorithm: updates mJwJoint, mS and mXParent, and sets mCompositeInertia to the inertia of the body itself; assumes the transforms are up to date
+        void computeCompositeInertia(); ///< second pass (leaves to root): adds mCompositeInertia to the parent
+        void aggregateMassCRBA(Eigen::MatrixXd &_M); ///< writes the mass matrix entries between the local dofs and the dofs of this node and all its ancestors into the *full* matrix _M
+
+        // Task-space dynamics
+        math::Vector6d mAccVelocityProduct; ///< spatial acceleration of the body expressed in the local frame when the dof accelerations and gravity are zero
+
+        void computeVelocityProductAcceleration(); ///< pass from the root to the leaves: computes mAccVelocityProduct from the parent's and mAccBias; mXParent and mAccBias must be up to date, e.g. from computeInverseDynamicsLinear
+        void evalTaskJacobian(const Eigen::Vector3d &_offset, bool _withOrientation, int _row, Eigen::MatrixXd &_J); ///< writes the Jacobian of the world velocity of the point at local _offset, followed by that of the world angular velocity if _withOrientation, into the rows of _J starting at _row; only the columns of the dependent dofs are written. Uses mJv and mJw, which must be up to date
+        void evalTaskBiasAcceleration(const Eigen::Vector3d &_offset, bool _withOrientation, int _row, Eigen::VectorXd &_acc) const; ///< Jdot*qdot for the same rows, i.e. the world accelerations when the dof accelerations are zero; computeVelocityProductAcceleration must have been called
+
+        // Centroidal momentum
+        void aggregateCentroidalMomentum(const Eigen::Vector3d &_com, Eigen::MatrixXd &_AG, Eigen::VectorXd &_bias); ///< last pass of SkeletonDynamics::computeCentroidalMomentum: writes the columns of the local dofs of _AG, the momentum of the subtree moved by each dof, and adds the rate of change of the momentum of the body due to the velocity products to _bias; both are [angular; linear] about _com in world coordinates. mCompositeInertia and mAccVelocityProduct must be up to date
+
+        // Derivatives of the inverse dynamics
+        std::vector<Eigen::MatrixXd> mSDeriv; ///< derivatives of mS wrt each local dof
+        Eigen::MatrixXd mAccBiasDerivPose; ///< derivatives of the joint part of mAccBias, due to the axes of the joint turning relative to each other, wrt each local dof; dimension 6 x numLocalDofs
+        Eigen::MatrixXd mAccBiasDerivVel; ///< derivatives of the same wrt each local dof velocity
+        math::Vector6d mVelDeriv; ///< derivative of mVelSpatial wrt the dof of the current sweep of SkeletonDynamics::computeInverseDynamicsDerivatives
+        math::Vector6d mAccDeriv; ///< derivative of mAccSpatial wrt the same dof
+        math::Vector6d mForceDeriv; ///< derivative of the spatial joint force [mTorqueJointBody; mForceJointBody] wrt the same dof, as seen from the parent's side of the joint
+
+        void evalJointDerivatives( const Eigen::VectorXd &_qdot ); ///< computes mSDeriv, mAccBiasDerivPose and mAccBiasDerivVel; the quantities of computeInvDynVelocities must be up to date
+        void computeInvDynDerivVelocities( const Eigen::VectorXd &_qdot, const Eigen::VectorXd &_qdotdot, int _localDof, bool _wrtVel ); ///< first pass of the derivative of the recursive Newton-Euler algorithm wrt the position (or the velocity if _wrtVel) of a dof of this node's joint or of an ancestor: computes mVelDeriv and mAccDeriv from the parent's; _localDof is the local index of the dof if it belongs to this node's joint, -1 otherwise
+        void computeInvDynDerivForces( int _localDof, bool _wrtVel, Eigen::VectorXd &_tauDeriv ); ///< second pass: computes mForceDeriv from mVelDeriv, mAccDeriv and the children's, and writes the derivatives of the local generalized forces into _tauDeriv
 
         // non-recursive Dynamics formulation - M*qdd + C*qdot + g = 0
         void updateSecondDerivatives();  ///< Update the second derivatives of the transformations
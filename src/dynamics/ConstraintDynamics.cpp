@@ -13,21 +13,33 @@
 #include "math/UtilsMath.h"
 #include "utils/Timer.h"
 
+#include <algorithm>
+#include <ctime>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 using namespace Eigen;
 using namespace collision;
 using namespace math;
 
 #define EPSILON 0.000001
+#define CFM 0.001 // relative regularization of the contact rows of the LCP
 
     namespace dynamics {
         ConstraintDynamics::ConstraintDynamics(const std::vector<SkeletonDynamics*>& _skels, double _dt, double _mu, int _d)
-            : mSkels(_skels), mDt(_dt), mMu(_mu), mNumDir(_d), mCollisionChecker(NULL) {
+            : mSkels(_skels), mDt(_dt), mMu(_mu), mNumDir(_d), mCollisionChecker(NULL),
+              mLCPWarmStart(true), mNumLCPPivots(0), mNumPersistentContacts(0),
+              mIterativeLCP(false), mPGSMaxIterations(100), mPGSTolerance(1e-6), mPGSRelaxation(1.0), mNumLCPIterations(0),
+              mNumThreads(1), mSparseLCPMatrix(true), mLCPAssemblyTime(0.0) {
             initialize();
         }
 
         ConstraintDynamics::~ConstraintDynamics() {
             if (mCollisionChecker)
                 delete mCollisionChecker;
+            for (int i = 0; i < mLCPSolvers.size(); i++)
+                delete mLCPSolvers[i];
         }
 
         void ConstraintDynamics::reset()
@@ -42,13 +54,21 @@ using namespace math;
             if (getTotalNumDofs() == 0)
                 return;
             mCollisionChecker->clearAllContacts();
+            updateRestingNodes();
             mCollisionChecker->checkCollision(true, true);
+            // the contacts of a sleeping skeleton with resting bodies are not
+            // checked, so they are looked for again once it is woken
+            while (wakeTouchedSkeletons()) {
+                updateRestingNodes();
+                mCollisionChecker->clearAllContacts();
+                mCollisionChecker->checkCollision(true, true);
+            }
 
             //            t1.startTimer();
             mLimitingDofIndex.clear();
             
             for (int i = 0; i < mSkels.size(); i++) {
-                if (mSkels[i]->getImmobileState() || !mSkels[i]->getJointLimitState())
+                if (mSkels[i]->getImmobileState() || mSkels[i]->isAsleep() || !mSkels[i]->getJointLimitState())
                     continue;
                 for (int j = 0; j < mSkels[i]->getNumDofs(); j++) {
                     double val = mSkels[i]->getDof(j)->getValue();
@@ -67,6 +87,14 @@ using namespace math;
             
             
             if (mCollisionChecker->getNumContacts() == 0 && mLimitingDofIndex.size() == 0) {
+                mPrevContacts.clear();
+                mPrevLimitingDofIndex.clear();
+                mNumLCPPivots = 0;
+                mNumLCPIterations = 0;
+                mNumPersistentContacts = 0;
+                mLCPAssemblyTime = 0.0;
+                mIslands.clear();
+                mSkelIsland.assign(mSkels.size(), -1);
                 for (int i = 0; i < mSkels.size(); i++)
                     mContactForces[i].setZero();
                 if (mConstraints.size() == 0) {
@@ -76,14 +104,32 @@ using namespace math;
                     computeConstraintWithoutContact();
                 }
             } else {
-                fillMatrices();
-                solve();
+                // the islands are independent LCPs
+                buildIslands();
+                int numIslands = mIslands.size();
+                int numThreads = std::max(1, std::min(mNumThreads, numIslands));
+                while (mLCPSolvers.size() < numIslands)
+                    mLCPSolvers.push_back(new lcpsolver::LCPSolver());
+                if (numThreads == 1) {
+                    for (int i = 0; i < numIslands; i++)
+                        solveIsland(mIslands[i], *mLCPSolvers[i]);
+                } else {
+#pragma omp parallel for schedule(dynamic, 1) num_threads(numThreads)
+                    for (int i = 0; i < numIslands; i++)
+                        solveIsland(mIslands[i], *mLCPSolvers[i]);
+                }
                 applySolution();
+                storeSolution();
             }
             //            t1.stopTimer();
             //            t1.printScreen();
         }
 
+        void ConstraintDynamics::setCollisionPrototype(ConstraintDynamics* _prototype) {
+            static_cast<FCLMESHCollisionDetector*>(mCollisionChecker)->setPrototype(
+                        _prototype ? static_cast<FCLMESHCollisionDetector*>(_prototype->mCollisionChecker) : NULL);
+        }
+
         void ConstraintDynamics::addConstraint(Constraint *_constr) {
             mConstraints.push_back(_constr);
             mTotalRows += _constr->getNumRows();
@@ -135,8 +181,8 @@ using namespace math;
                 }
 
             // Add all body nodes into mCollisionChecker
-            int rows = mMInv.rows();
-            int cols = mMInv.cols();
+            int rows = mTauStar.rows();
+            int cols = mTauStar.rows();
 
             if (!_newSkel->getImmobileState())
                 {
@@ -151,7 +197,6 @@ using namespace math;
             mContactForces.push_back(newConstrForce);
             mTotalConstrForces.push_back(newConstrForce);
 
-            mMInv = MatrixXd::Zero(rows, cols);
             mTauStar = VectorXd::Zero(rows);
 
             mIndices.clear();
@@ -208,7 +253,6 @@ using namespace math;
                 mTotalConstrForces[i] = VectorXd::Zero(mSkels[i]->getNumDofs());
             }
 
-            mMInv = MatrixXd::Zero(rows, cols);
             mTauStar = VectorXd::Zero(rows);
 
             // Initialize the index vector:
@@ -242,6 +286,8 @@ using namespace math;
         {
             if (mCollisionChecker)
                 delete mCollisionChecker;
+            mPrevContacts.clear();
+            mPrevLimitingDofIndex.clear();
         }
 
         void ConstraintDynamics::computeConstraintWithoutContact() {
@@ -256,22 +302,288 @@ using namespace math;
             }
         }
 
-        void ConstraintDynamics::fillMatrices() {
+        void ConstraintDynamics::updateRestingNodes() {
+            for (int i = 0; i < mCollisionChecker->getNumCollisionNodes(); i++) {
+                SkeletonDynamics* skel = mSkels[mBodyIndexToSkelIndex[i]];
+                mCollisionChecker->getCollisionNode(i)->setResting(skel->getImmobileState() || skel->isAsleep());
+            }
+        }
+
+        bool ConstraintDynamics::wakeTouchedSkeletons() {
+            bool woken = false;
+            for (int i = 0; i < getNumContacts(); i++) {
+                Contact& c = mCollisionChecker->getContact(i);
+                SkeletonDynamics* skel1 = mSkels[mBodyIndexToSkelIndex[c.collisionNode1->getBodyNodeID()]];
+                SkeletonDynamics* skel2 = mSkels[mBodyIndexToSkelIndex[c.collisionNode2->getBodyNodeID()]];
+                bool awake1 = !skel1->getImmobileState() && !skel1->isAsleep();
+                bool awake2 = !skel2->getImmobileState() && !skel2->isAsleep();
+                if (awake1 && skel2->isAsleep()) {
+                    skel2->setAsleep(false);
+                    woken = true;
+                }
+                if (awake2 && skel1->isAsleep()) {
+                    skel1->setAsleep(false);
+                    woken = true;
+                }
+            }
+            return woken;
+        }
+
+        // union-find over the skeletons
+        static int findIslandRoot(std::vector<int>& _parent, int _i) {
+            while (_parent[_i] != _i) {
+                _parent[_i] = _parent[_parent[_i]];
+                _i = _parent[_i];
+            }
+            return _i;
+        }
+
+        void ConstraintDynamics::buildIslands() {
+            int nSkels = mSkels.size();
             int nContacts = getNumContacts();
-            int nJointLimits = mLimitingDofIndex.size();
-            int nConstrs = mConstraints.size();
+            std::vector<int> parent(nSkels);
+            std::vector<bool> active(nSkels, false);
+            for (int i = 0; i < nSkels; i++)
+                parent[i] = i;
+
+            // two movable skeletons in contact share an island; an immobile
+            // one is part of none, as it is not affected by the contact
+            for (int i = 0; i < nContacts; i++) {
+                Contact& c = mCollisionChecker->getContact(i);
+                int skelID1 = mBodyIndexToSkelIndex[c.collisionNode1->getBodyNodeID()];
+                int skelID2 = mBodyIndexToSkelIndex[c.collisionNode2->getBodyNodeID()];
+                bool mobile1 = !mSkels[skelID1]->getImmobileState();
+                bool mobile2 = !mSkels[skelID2]->getImmobileState();
+                if (mobile1 && mobile2)
+                    parent[findIslandRoot(parent, skelID1)] = findIslandRoot(parent, skelID2);
+                if (mobile1)
+                    active[skelID1] = true;
+                if (mobile2)
+                    active[skelID2] = true;
+            }
+            for (int i = 0; i < mLimitingDofIndex.size(); i++)
+                active[getSkelIndexOfDof(abs(mLimitingDofIndex[i]) - 1)] = true;
+            // the constraint projection mZ couples all the skeletons, so with
+            // constraints there is a single island in the global dof order
+            if (mConstraints.size() > 0) {
+                int first = -1;
+                for (int i = 0; i < nSkels; i++) {
+                    if (mSkels[i]->getImmobileState())
+                        continue;
+                    active[i] = true;
+                    if (first < 0)
+                        first = i;
+                    else
+                        parent[findIslandRoot(parent, i)] = findIslandRoot(parent, first);
+                }
+            }
+
+            // islands in the order of their first skeleton, skeletons and
+            // contacts in ascending order, so that the result does not depend
+            // on how the islands are scheduled
+            mIslands.clear();
+            mSkelIsland.assign(nSkels, -1);
+            mSkelOffset.assign(nSkels, 0);
+            std::vector<int> rootIsland(nSkels, -1);
+            for (int i = 0; i < nSkels; i++) {
+                if (!active[i])
+                    continue;
+                int root = findIslandRoot(parent, i);
+                if (rootIsland[root] < 0) {
+                    rootIsland[root] = mIslands.size();
+                    mIslands.push_back(Island());
+                    mIslands.back().indices.push_back(0);
+                }
+                Island& island = mIslands[rootIsland[root]];
+                mSkelIsland[i] = rootIsland[root];
+                mSkelOffset[i] = island.indices.back();
+                island.skels.push_back(i);
+                island.indices.push_back(island.indices.back() + mSkels[i]->getNumDofs());
+            }
+            for (int i = 0; i < nContacts; i++) {
+                Contact& c = mCollisionChecker->getContact(i);
+                int skelID = mBodyIndexToSkelIndex[c.collisionNode1->getBodyNodeID()];
+                if (mSkels[skelID]->getImmobileState())
+                    skelID = mBodyIndexToSkelIndex[c.collisionNode2->getBodyNodeID()];
+                if (mSkels[skelID]->getImmobileState())
+                    continue; // between two immobile skeletons
+                mIslands[mSkelIsland[skelID]].contacts.push_back(i);
+            }
+            for (int i = 0; i < mLimitingDofIndex.size(); i++) {
+                int dof = abs(mLimitingDofIndex[i]) - 1;
+                int skelID = getSkelIndexOfDof(dof);
+                int localDof = mSkelOffset[skelID] + dof - mIndices[skelID];
+                Island& island = mIslands[mSkelIsland[skelID]];
+                island.limits.push_back(i);
+                island.limitDofs.push_back(mLimitingDofIndex[i] > 0 ? localDof + 1 : -(localDof + 1));
+            }
+        }
+
+        int ConstraintDynamics::getSkelIndexOfDof(int _dof) const {
+            // immobile skeletons have no dofs in mIndices
+            int i = 0;
+            while (mIndices[i + 1] <= _dof)
+                i++;
+            return i;
+        }
+
+        void ConstraintDynamics::solveIsland(Island& _island, lcpsolver::LCPSolver& _solver) {
+            int nContacts = _island.contacts.size();
+            if (mIterativeLCP) {
+                fillJacobians(_island);
+                bool warmStart = fillInitialGuess(_island) && mLCPWarmStart;
+                _solver.setPGSParameters(mPGSMaxIterations, mPGSTolerance, mPGSRelaxation);
+                _solver.Solve(_island.Jc, _island.MInvJt, _island.qBar, _island.x, nContacts, mMu, mNumDir, CFM, warmStart);
+                _island.numPivots = 0;
+                _island.numIterations = _solver.getNumIterations();
+                _island.assemblyTime = 0.0;
+            } else {
+                // wall-clock time: the islands may be assembled by several
+                // threads at once, whose processor times clock() would add up
+#ifdef _OPENMP
+                double start = omp_get_wtime();
+                fillMatrices(_island);
+                _island.assemblyTime = omp_get_wtime() - start;
+#else
+                clock_t start = clock();
+                fillMatrices(_island);
+                _island.assemblyTime = double(clock() - start) / CLOCKS_PER_SEC;
+#endif
+                bool warmStart = fillInitialGuess(_island) && mLCPWarmStart;
+                _solver.Solve(_island.A, _island.qBar, _island.x, nContacts, mMu, mNumDir, true, warmStart);
+                _island.numPivots = _solver.getNumPivots();
+                _island.numIterations = 0;
+            }
+        }
+
+        void ConstraintDynamics::fillMatrices(Island& _island) {
+            int nContacts = _island.contacts.size();
+            int nJointLimits = _island.limitDofs.size();
             int cd = nContacts * mNumDir;
+            int nRows = nContacts + cd;
+            int jointStart = 2 * nContacts + cd;
             int dimA = nContacts * (2 + mNumDir) + nJointLimits;
-            mA = MatrixXd::Zero(dimA, dimA);
-            mQBar = VectorXd::Zero(dimA);
+            MatrixXd& A = _island.A;
+            A = MatrixXd::Zero(dimA, dimA);
+            _island.qBar = VectorXd::Zero(dimA);
+            VectorXd tauVec = computeFreeVelocity(_island);
+
+            if (nContacts > 0)
+                updateContactJacobians(_island);
+
+            // J * MInv * J^T over the normals, the tangents and the joint
+            // limits; the projection by mZ couples all the skeletons
+            MatrixXd D;
+            if (mSparseLCPMatrix && mConstraints.size() == 0) {
+                D = computeDelassusMatrix(_island);
+            } else {
+                MatrixXd Jt = getJacobianTranspose(_island);
+                D.noalias() = Jt.transpose() * solveMass(_island, Jt);
+            }
+            A.topLeftCorner(nRows, nRows) = D.topLeftCorner(nRows, nRows);
+            A.block(0, jointStart, nRows, nJointLimits) = D.topRightCorner(nRows, nJointLimits);
+            A.block(jointStart, 0, nJointLimits, nRows) = D.bottomLeftCorner(nJointLimits, nRows);
+            A.bottomRightCorner(nJointLimits, nJointLimits) = D.bottomRightCorner(nJointLimits, nJointLimits);
+
+            if (nContacts > 0) {
+                MatrixXd E = getContactMatrix(nContacts);
+                A.block(nContacts, nContacts + cd, cd, nContacts) = E;
+                A.block(nContacts + cd, 0, nContacts, nContacts) = getMuMatrix(nContacts);
+                A.block(nContacts + cd, nContacts, nContacts, cd) = -E.transpose();
+            }
+
+            for (int k = 0; k < _island.contactJacobians.size(); k++) {
+                const ContactJacobian& jac = _island.contactJacobians[k];
+                VectorXd v(jac.dofs.size());
+                for (int j = 0; j < jac.dofs.size(); j++)
+                    v[j] = tauVec[jac.dofs[j]];
+                VectorXd Jv = jac.Jt.transpose() * v;
+                _island.qBar[jac.contact] += Jv[0];
+                _island.qBar.segment(nContacts + jac.contact * mNumDir, mNumDir) += Jv.tail(mNumDir);
+            }
+
+            for (int i = 0; i < nJointLimits; i++) {
+                if (_island.limitDofs[i] > 0) // hitting upper bound
+                    _island.qBar[jointStart + i] = -tauVec[_island.limitDofs[i] - 1];
+                else // hitting lower bound
+                    _island.qBar[jointStart + i] = tauVec[abs(_island.limitDofs[i]) - 1];
+            }
+            _island.qBar /= mDt;
+            
+            int cfmSize = nContacts * (1 + mNumDir);
+            for (int i = 0; i < cfmSize; ++i) //add small values to diagnal to keep it away from singular, similar to cfm varaible in ODE
+                A(i, i) += CFM * A(i, i);
+        }
+
+        MatrixXd ConstraintDynamics::computeDelassusMatrix(const Island& _island) const {
+            // M is block diagonal over the skeletons and a contact or a joint
+            // limit acts on at most two of them, so J * MInv * J^T is summed
+            // over the skeletons from the few columns of J^T acting on each
+            int nContacts = _island.contacts.size();
+            int cd = nContacts * mNumDir;
+            int nRows = nContacts + cd + _island.limitDofs.size();
+            int nSlots = _island.skels.size();
+            std::vector<std::vector<int> > columns(nSlots);
+            std::vector<std::vector<int> > jacobians(nSlots);
+            std::vector<int> jacobianColumn(_island.contactJacobians.size());
+            for (int k = 0; k < _island.contactJacobians.size(); k++) {
+                const ContactJacobian& jac = _island.contactJacobians[k];
+                std::vector<int>& cols = columns[jac.slot];
+                jacobians[jac.slot].push_back(k);
+                // both sides of a self-collision share the columns
+                if (!cols.empty() && cols[cols.size() - 1 - mNumDir] == jac.contact) {
+                    jacobianColumn[k] = cols.size() - 1 - mNumDir;
+                    continue;
+                }
+                jacobianColumn[k] = cols.size();
+                cols.push_back(jac.contact);
+                for (int j = 0; j < mNumDir; j++)
+                    cols.push_back(nContacts + jac.contact * mNumDir + j);
+            }
+            for (int i = 0; i < _island.limitDofs.size(); i++) {
+                int dof = abs(_island.limitDofs[i]) - 1;
+                int slot = std::upper_bound(_island.indices.begin(), _island.indices.end(), dof) - _island.indices.begin() - 1;
+                columns[slot].push_back(nContacts + cd + i);
+            }
+
+            MatrixXd D = MatrixXd::Zero(nRows, nRows);
+            for (int k = 0; k < nSlots; k++) {
+                const std::vector<int>& cols = columns[k];
+                if (cols.empty())
+                    continue;
+                SkeletonDynamics* skel = mSkels[_island.skels[k]];
+                int start = _island.indices[k];
+                MatrixXd Jt = MatrixXd::Zero(skel->getNumDofs(), cols.size());
+                for (int l = 0; l < jacobians[k].size(); l++) {
+                    const ContactJacobian& jac = _island.contactJacobians[jacobians[k][l]];
+                    int col = jacobianColumn[jacobians[k][l]];
+                    for (int j = 0; j < jac.dofs.size(); j++)
+                        Jt.block(jac.dofs[j] - start, col, 1, 1 + mNumDir) += jac.Jt.row(j);
+                }
+                for (int j = 0; j < cols.size(); j++) {
+                    if (cols[j] < nContacts + cd)
+                        continue;
+                    int limit = _island.limitDofs[cols[j] - nContacts - cd];
+                    if (limit > 0) // hitting upper bound
+                        Jt(limit - 1 - start, j) = -1.0;
+                    else
+                        Jt(abs(limit) - 1 - start, j) = 1.0;
+                }
+                MatrixXd Dk = Jt.transpose() * skel->solveMassMatrixMultiple(Jt);
+                for (int a = 0; a < cols.size(); a++)
+                    for (int b = 0; b < cols.size(); b++)
+                        D(cols[a], cols[b]) += Dk(a, b);
+            }
+            return D;
+        }
+
+        VectorXd ConstraintDynamics::computeFreeVelocity() {
             updateMassMat();
             updateTauStar();
-            
-            MatrixXd augMInv = mMInv;
+
             VectorXd tauVec = VectorXd::Zero(getTotalNumDofs());
-            if (nConstrs > 0) {
+            if (mConstraints.size() > 0) {
                 updateConstraintTerms();
-                augMInv -= mZ.triangularView<Lower>();
 
                 VectorXd tempVec = mDt * mGInv * mTauHat;
                 for (int i = 0; i < mSkels.size(); i++) {
@@ -280,106 +592,182 @@ using namespace math;
                     tauVec.segment(mIndices[i], mSkels[i]->getNumDofs()) = mJ[i].transpose() * tempVec;
                 }
             }
-            tauVec = mMInv * (tauVec + mTauStar);
+            return solveMass(tauVec + mTauStar, false);
+        }
 
-            MatrixXd NTerm(getTotalNumDofs(), nContacts);
-            MatrixXd BTerm(getTotalNumDofs(), cd);
+        VectorXd ConstraintDynamics::computeFreeVelocity(const Island& _island) {
+            // with constraints the island holds all the skeletons in the
+            // global order
+            if (mConstraints.size() > 0)
+                return computeFreeVelocity();
+
+            VectorXd v(_island.indices.back());
+            for (int k = 0; k < _island.skels.size(); k++) {
+                SkeletonDynamics* skel = mSkels[_island.skels[k]];
+                // the mass matrix is assembled lazily when the forward dynamics do not need it
+                if (!skel->isMassMatrixUpdated())
+                    skel->computeMassMatrix(false);
+                VectorXd tau = skel->getExternalForces() + skel->getInternalForces() + skel->getPDForces();
+                VectorXd tauStar = (skel->getMassMatrix() * skel->getPoseVelocity()) - (mDt * (skel->getCombinedVector() - tau));
+                v.segment(_island.indices[k], skel->getNumDofs()) = skel->solveMassMatrix(tauStar);
+            }
+            return v;
+        }
 
-            if (nContacts > 0) {
-                updateNBMatrices();
-                MatrixXd E = getContactMatrix();
-                // Compute NTerm and BTerm
-                NTerm.noalias() = augMInv * mN;
-                BTerm.noalias() = augMInv * mB;
-                mA.block(0, 0, nContacts, nContacts).triangularView<Lower>() = mN.transpose() * NTerm;
-                mA.block(0, 0, nContacts, nContacts).triangularView<StrictlyUpper>() = mA.block(0, 0, nContacts, nContacts).transpose();
-                mA.block(0, nContacts, nContacts, cd).noalias() = mN.transpose() * BTerm;
-                mA.block(nContacts, 0, cd, nContacts) = mA.block(0, nContacts, nContacts, cd).transpose();
-                mA.block(nContacts, nContacts, cd, cd).triangularView<Lower>() = mB.transpose() * BTerm;
-                mA.block(nContacts, nContacts, cd, cd).triangularView<StrictlyUpper>() = mA.block(nContacts, nContacts, cd, cd).transpose();
-                mA.block(nContacts, nContacts + cd, cd, nContacts) = E;
-                mA.block(nContacts + cd, 0, nContacts, nContacts) = getMuMatrix();
-                mA.block(nContacts + cd, nContacts, nContacts, cd) = -E.transpose();
-
-                mQBar.segment(0, nContacts).noalias() = mN.transpose() * tauVec;
-                mQBar.segment(nContacts, cd).noalias() = mB.transpose() * tauVec;
-            }
-
-            if (nJointLimits > 0) {
-                int jointStart = 2 * nContacts + cd;
-                for (int i = 0; i < nJointLimits; i++)
-                    for (int j = 0; j < nJointLimits; j++) {
-                        if (mLimitingDofIndex[i] * mLimitingDofIndex[j] < 0)
-                            mA(jointStart + i, jointStart + j) = -augMInv(abs(mLimitingDofIndex[i]) - 1, abs(mLimitingDofIndex[j]) - 1);
-                        else
-                            mA(jointStart + i, jointStart + j) = augMInv(abs(mLimitingDofIndex[i]) - 1, abs(mLimitingDofIndex[j]) - 1);
-                    }
+        void ConstraintDynamics::fillJacobians(Island& _island) {
+            // the rows of A without the friction cone rows, as the
+            // constraint Jacobian and its mass-weighted transpose; A itself
+            // is never formed
+            VectorXd tauVec = computeFreeVelocity(_island);
+            if (_island.contacts.size() > 0)
+                updateContactJacobians(_island);
+            MatrixXd Jt = getJacobianTranspose(_island);
+            _island.MInvJt = solveMass(_island, Jt);
+            _island.Jc = Jt.transpose();
+            _island.qBar.noalias() = _island.Jc * tauVec;
+            _island.qBar /= mDt;
+        }
 
-                for (int i = 0; i < nJointLimits; i++) {
-                    if (mLimitingDofIndex[i] > 0) // hitting upper bound
-                        mQBar[jointStart + i] = -tauVec[abs(mLimitingDofIndex[i]) - 1];
-                    else // hitting lower bound
-                        mQBar[jointStart + i] = tauVec[abs(mLimitingDofIndex[i]) - 1];
+        MatrixXd ConstraintDynamics::getJacobianTranspose(const Island& _island) const {
+            int nContacts = _island.contacts.size();
+            int nJointLimits = _island.limitDofs.size();
+            int cd = nContacts * mNumDir;
+            MatrixXd Jt = MatrixXd::Zero(_island.indices.back(), nContacts + cd + nJointLimits);
+            for (int k = 0; k < _island.contactJacobians.size(); k++) {
+                const ContactJacobian& jac = _island.contactJacobians[k];
+                for (int j = 0; j < jac.dofs.size(); j++) {
+                    Jt(jac.dofs[j], jac.contact) += jac.Jt(j, 0);
+                    Jt.block(jac.dofs[j], nContacts + jac.contact * mNumDir, 1, mNumDir) += jac.Jt.block(j, 1, 1, mNumDir);
                 }
+            }
+            for (int i = 0; i < nJointLimits; i++) {
+                if (_island.limitDofs[i] > 0) // hitting upper bound
+                    Jt(_island.limitDofs[i] - 1, nContacts + cd + i) = -1.0;
+                else
+                    Jt(abs(_island.limitDofs[i]) - 1, nContacts + cd + i) = 1.0;
+            }
+            return Jt;
+        }
 
-                if (nContacts > 0) {
-
-                    MatrixXd STerm(mMInv.rows(), nJointLimits);
-                    for (int i = 0; i < nJointLimits; i++) {
-                        if (mLimitingDofIndex[i] > 0) // hitting upper bound
-                            STerm.col(i) = -augMInv.col(mLimitingDofIndex[i] - 1);
-                        else                            
-                            STerm.col(i) = augMInv.col(abs(mLimitingDofIndex[i]) - 1);
-                    }
-                    mA.block(0, jointStart, nContacts, nJointLimits) = mN.transpose() * STerm;
-
-                    mA.block(nContacts, jointStart, cd, nJointLimits) = mB.transpose() * STerm;
-
-                    for (int i = 0; i < nJointLimits; i++) {
-                        if (mLimitingDofIndex[i] > 0) { //hitting uppder bound
-                            mA.block(jointStart + i, 0, 1, nContacts) = -NTerm.row(mLimitingDofIndex[i] - 1);
-                            mA.block(jointStart + i, nContacts, 1, cd) = -BTerm.row(mLimitingDofIndex[i] - 1);
-                        } else {
-                            mA.block(jointStart + i, 0, 1, nContacts) = NTerm.row(abs(mLimitingDofIndex[i]) - 1);
-                            mA.block(jointStart + i, nContacts, 1, cd) = BTerm.row(abs(mLimitingDofIndex[i]) - 1);
-                        }
+        bool ConstraintDynamics::fillInitialGuess(Island& _island) {
+            // a contact persists if the previous step had a contact between
+            // the same pair of bodies at nearly the same point, measured in
+            // the frame of the first body
+            const double tol = 1e-2;
+            int nContacts = _island.contacts.size();
+            int cd = nContacts * mNumDir;
+            _island.x = VectorXd::Zero(nContacts * (2 + mNumDir) + _island.limits.size());
+            _island.numPersistentContacts = 0;
+
+            std::vector<bool> used(mPrevContacts.size(), false);
+            for (int i = 0; i < nContacts; i++) {
+                Contact& c = mCollisionChecker->getContact(_island.contacts[i]);
+                kinematics::BodyNode* node1 = c.collisionNode1->getBodyNode();
+                kinematics::BodyNode* node2 = c.collisionNode2->getBodyNode();
+                Vector3d localPoint = xformHom(node1->getWorldInvTransform(), c.point);
+                int best = -1;
+                double bestDist = tol;
+                for (int j = 0; j < mPrevContacts.size(); j++) {
+                    if (used[j] || mPrevContacts[j].bodyNode1 != node1 || mPrevContacts[j].bodyNode2 != node2)
+                        continue;
+                    double dist = (mPrevContacts[j].localPoint - localPoint).norm();
+                    if (dist < bestDist) {
+                        best = j;
+                        bestDist = dist;
                     }
+                }
+                if (best < 0)
+                    continue;
+                used[best] = true;
+                _island.x[i] = mPrevContacts[best].normalForce;
+                _island.x.segment(nContacts + i * mNumDir, mNumDir) = mPrevContacts[best].tangentForces;
+                _island.numPersistentContacts++;
+            }
 
+            int jointStart = 2 * nContacts + cd;
+            int nPersistentLimits = 0;
+            for (int i = 0; i < _island.limits.size(); i++) {
+                for (int j = 0; j < mPrevLimitingDofIndex.size(); j++) {
+                    if (mPrevLimitingDofIndex[j] == mLimitingDofIndex[_island.limits[i]]) {
+                        _island.x[jointStart + i] = mPrevLimitForces[j];
+                        nPersistentLimits++;
+                        break;
+                    }
                 }
             }
-            mQBar /= mDt;
-            
-            int cfmSize = getNumContacts() * (1 + mNumDir);
-            for (int i = 0; i < cfmSize; ++i) //add small values to diagnal to keep it away from singular, similar to cfm varaible in ODE
-                mA(i, i) += 0.001 * mA(i, i);
+            return _island.numPersistentContacts > 0 || nPersistentLimits > 0;
         }
 
-        bool ConstraintDynamics::solve() {
-            lcpsolver::LCPSolver solver = lcpsolver::LCPSolver();
-            bool b = solver.Solve(mA, mQBar, mX, getNumContacts(), mMu, mNumDir, true);
-            return b;
+        void ConstraintDynamics::storeSolution() {
+            mPrevContacts.clear();
+            mPrevLimitingDofIndex = mLimitingDofIndex;
+            mPrevLimitForces = VectorXd::Zero(mLimitingDofIndex.size());
+            mNumLCPPivots = 0;
+            mNumLCPIterations = 0;
+            mNumPersistentContacts = 0;
+            mLCPAssemblyTime = 0.0;
+            for (int k = 0; k < mIslands.size(); k++) {
+                const Island& island = mIslands[k];
+                int nContacts = island.contacts.size();
+                for (int i = 0; i < nContacts; i++) {
+                    Contact& c = mCollisionChecker->getContact(island.contacts[i]);
+                    PersistentContact prev;
+                    prev.bodyNode1 = c.collisionNode1->getBodyNode();
+                    prev.bodyNode2 = c.collisionNode2->getBodyNode();
+                    prev.localPoint = xformHom(prev.bodyNode1->getWorldInvTransform(), c.point);
+                    prev.normalForce = island.x[i];
+                    prev.tangentForces = island.x.segment(nContacts + i * mNumDir, mNumDir);
+                    mPrevContacts.push_back(prev);
+                }
+                for (int i = 0; i < island.limits.size(); i++)
+                    mPrevLimitForces[island.limits[i]] = island.x[nContacts * (2 + mNumDir) + i];
+                mNumLCPPivots += island.numPivots;
+                mNumLCPIterations += island.numIterations;
+                mNumPersistentContacts += island.numPersistentContacts;
+                mLCPAssemblyTime += island.assemblyTime;
+            }
         }
 
         void ConstraintDynamics::applySolution() {
             VectorXd contactForces(VectorXd::Zero(getTotalNumDofs()));
             VectorXd jointLimitForces(VectorXd::Zero(getTotalNumDofs()));
 
-            if (getNumContacts() > 0) {
-                VectorXd f_n = mX.head(getNumContacts());
-                VectorXd f_d = mX.segment(getNumContacts(), getNumContacts() * mNumDir);
-                contactForces.noalias() = mN * f_n;
-                contactForces.noalias() += mB * f_d;
-                for (int i = 0; i < getNumContacts(); i++) {
-                    Contact& contact = mCollisionChecker->getContact(i);
-                    contact.force.noalias() = getTangentBasisMatrix(contact.point, contact.normal) * f_d.segment(i * mNumDir, mNumDir);
-                    contact.force.noalias() += contact.normal * f_n[i];
+            // contacts between immobile skeletons belong to no island
+            for (int i = 0; i < getNumContacts(); i++)
+                mCollisionChecker->getContact(i).force.setZero();
+
+            for (int k = 0; k < mIslands.size(); k++) {
+                const Island& island = mIslands[k];
+                int nContacts = island.contacts.size();
+                if (nContacts > 0) {
+                    VectorXd f_n = island.x.head(nContacts);
+                    VectorXd f_d = island.x.segment(nContacts, nContacts * mNumDir);
+                    VectorXd islandForces = VectorXd::Zero(island.indices.back());
+                    for (int c = 0; c < island.contactJacobians.size(); c++) {
+                        const ContactJacobian& jac = island.contactJacobians[c];
+                        VectorXd f(1 + mNumDir);
+                        f[0] = f_n[jac.contact];
+                        f.tail(mNumDir) = f_d.segment(jac.contact * mNumDir, mNumDir);
+                        VectorXd tau = jac.Jt * f;
+                        for (int j = 0; j < jac.dofs.size(); j++)
+                            islandForces[jac.dofs[j]] += tau[j];
+                    }
+                    for (int j = 0; j < island.skels.size(); j++) {
+                        int skelID = island.skels[j];
+                        contactForces.segment(mIndices[skelID], mSkels[skelID]->getNumDofs()) = islandForces.segment(island.indices[j], mSkels[skelID]->getNumDofs());
+                    }
+                    for (int i = 0; i < nContacts; i++) {
+                        Contact& contact = mCollisionChecker->getContact(island.contacts[i]);
+                        contact.force.noalias() = getTangentBasisMatrix(contact.point, contact.normal) * f_d.segment(i * mNumDir, mNumDir);
+                        contact.force.noalias() += contact.normal * f_n[i];
+                    }
                 }
-            }
-            for (int i = 0; i < mLimitingDofIndex.size(); i++) {
-                if (mLimitingDofIndex[i] > 0) { // hitting upper bound
-                    jointLimitForces[mLimitingDofIndex[i] - 1] = -mX[getNumContacts() * (2 + mNumDir) + i];
-                }else{
-                    jointLimitForces[abs(mLimitingDofIndex[i]) - 1] = mX[getNumContacts() * (2 + mNumDir) + i];
+                for (int i = 0; i < island.limits.size(); i++) {
+                    int limit = mLimitingDofIndex[island.limits[i]];
+                    if (limit > 0) // hitting upper bound
+                        jointLimitForces[limit - 1] = -island.x[nContacts * (2 + mNumDir) + i];
+                    else
+                        jointLimitForces[abs(limit) - 1] = island.x[nContacts * (2 + mNumDir) + i];
                 }
             }
             
@@ -407,13 +795,41 @@ using namespace math;
         }
 
         void ConstraintDynamics::updateMassMat() {
-            int start = 0;
             for (int i = 0; i < mSkels.size(); i++) {
                 if (mSkels[i]->getImmobileState())
                     continue;
-                mMInv.block(start, start, mSkels[i]->getNumDofs(), mSkels[i]->getNumDofs()) = mSkels[i]->getInvMassMatrix();
-                start += mSkels[i]->getNumDofs();
+                // the mass matrix is assembled lazily when the forward dynamics do not need it
+                if (!mSkels[i]->isMassMatrixUpdated())
+                    mSkels[i]->computeMassMatrix(false);
+            }
+        }
+
+        MatrixXd ConstraintDynamics::solveMass(const MatrixXd& _B, bool _projected) const {
+            // M is block diagonal over the skeletons; each block is solved
+            // with the tree factorization of its skeleton
+            MatrixXd X(_B.rows(), _B.cols());
+            for (int i = 0; i < mSkels.size(); i++) {
+                if (mSkels[i]->getImmobileState())
+                    continue;
+                int nDofs = mSkels[i]->getNumDofs();
+                X.middleRows(mIndices[i], nDofs) = mSkels[i]->solveMassMatrixMultiple(_B.middleRows(mIndices[i], nDofs));
             }
+            if (_projected)
+                X.noalias() -= mZ.triangularView<Lower>() * _B;
+            return X;
+        }
+
+        MatrixXd ConstraintDynamics::solveMass(const Island& _island, const MatrixXd& _B) const {
+            // projected by mZ if there are constraints, in which case the
+            // island dofs are the global ones
+            MatrixXd X(_B.rows(), _B.cols());
+            for (int k = 0; k < _island.skels.size(); k++) {
+                SkeletonDynamics* skel = mSkels[_island.skels[k]];
+                X.middleRows(_island.indices[k], skel->getNumDofs()) = skel->solveMassMatrixMultiple(_B.middleRows(_island.indices[k], skel->getNumDofs()));
+            }
+            if (mConstraints.size() > 0)
+                X.noalias() -= mZ.triangularView<Lower>() * _B;
+            return X;
         }
 
         void ConstraintDynamics::updateTauStar() {
@@ -422,63 +838,53 @@ using namespace math;
                 if (mSkels[i]->getImmobileState())
                     continue;
 
-                VectorXd tau = mSkels[i]->getExternalForces() + mSkels[i]->getInternalForces();
+                VectorXd tau = mSkels[i]->getExternalForces() + mSkels[i]->getInternalForces() + mSkels[i]->getPDForces();
                 VectorXd tauStar = (mSkels[i]->getMassMatrix() * mSkels[i]->getPoseVelocity()) - (mDt * (mSkels[i]->getCombinedVector() - tau));
                 mTauStar.block(startRow, 0, tauStar.rows(), 1) = tauStar;
                 startRow += tauStar.rows();
             }
         }
 
-        void ConstraintDynamics::updateNBMatrices() {
-            mN = MatrixXd::Zero(getTotalNumDofs(), getNumContacts());
-            mB = MatrixXd::Zero(getTotalNumDofs(), getNumContacts() * mNumDir);
-            for (int i = 0; i < getNumContacts(); i++) {
-                Contact& c = mCollisionChecker->getContact(i);
-                Vector3d p = c.point;
-                int skelID1 = mBodyIndexToSkelIndex[c.collisionNode1->getBodyNodeID()];
-                int skelID2 = mBodyIndexToSkelIndex[c.collisionNode2->getBodyNodeID()];
-
-                Vector3d N21 = c.normal;
-                Vector3d N12 = -c.normal;
-                MatrixXd B21 = getTangentBasisMatrix(p, N21);
-                MatrixXd B12 = -B21;
-
-                if (!mSkels[skelID1]->getImmobileState()) {
-                    int index1 = mIndices[skelID1];
-                    int NDOF1 = c.collisionNode1->getBodyNode()->getSkel()->getNumDofs();
-                    //    Vector3d N21 = c.normal;
-                    MatrixXd J21t = getJacobian(c.collisionNode1->getBodyNode(), p);
-                    mN.block(index1, i, NDOF1, 1).noalias() = J21t * N21;
-                    //B21 = getTangentBasisMatrix(p, N21);
-                    mB.block(index1, i * mNumDir, NDOF1, mNumDir).noalias() = J21t * B21;
-                }
-
-                if (!mSkels[skelID2]->getImmobileState()) {
-                    int index2 = mIndices[skelID2];
-                    int NDOF2 = c.collisionNode2->getBodyNode()->getSkel()->getNumDofs();
-                    //Vector3d N12 = -c.normal;
-                    //if (B21.rows() == 0)
-                    //  B12 = getTangentBasisMatrix(p, N12);
-                    //else
-                    //   B12 = -B21;
-                    MatrixXd J12t = getJacobian(c.collisionNode2->getBodyNode(), p);
-                    mN.block(index2, i, NDOF2, 1).noalias() = J12t * N12;
-                    mB.block(index2, i * mNumDir, NDOF2, mNumDir).noalias() = J12t * B12;
-
+        void ConstraintDynamics::updateContactJacobians(Island& _island) {
+            // a contact moves only the dofs its two bodies depend on; the
+            // normal pushes the first body and the second body back
+            int nContacts = _island.contacts.size();
+            _island.contactJacobians.clear();
+            _island.contactJacobians.reserve(2 * nContacts);
+            MatrixXd T(3, 1 + mNumDir);
+            for (int i = 0; i < nContacts; i++) {
+                Contact& c = mCollisionChecker->getContact(_island.contacts[i]);
+                T.col(0) = c.normal;
+                T.rightCols(mNumDir) = getTangentBasisMatrix(c.point, c.normal);
+                for (int k = 0; k < 2; k++) {
+                    CollisionNode* collisionNode = k == 0 ? c.collisionNode1 : c.collisionNode2;
+                    int skelID = mBodyIndexToSkelIndex[collisionNode->getBodyNodeID()];
+                    if (mSkels[skelID]->getImmobileState())
+                        continue;
+                    kinematics::BodyNode* node = collisionNode->getBodyNode();
+                    _island.contactJacobians.push_back(ContactJacobian());
+                    ContactJacobian& jac = _island.contactJacobians.back();
+                    jac.contact = i;
+                    jac.slot = std::lower_bound(_island.skels.begin(), _island.skels.end(), skelID) - _island.skels.begin();
+                    jac.dofs.resize(node->getNumDependentDofs());
+                    for (int j = 0; j < node->getNumDependentDofs(); j++)
+                        jac.dofs[j] = mSkelOffset[skelID] + node->getDependentDof(j);
+                    jac.Jt.noalias() = getJacobian(node, c.point) * T;
+                    if (k == 1)
+                        jac.Jt = -jac.Jt;
                 }
             }
         }
 
-        MatrixXd ConstraintDynamics::getJacobian(kinematics::BodyNode* node, const Vector3d& p) {
-            int nDofs = node->getSkel()->getNumDofs();
-            MatrixXd Jt = MatrixXd::Zero(nDofs, 3);
-            Vector3d invP = xformHom(node->getWorldInvTransform(), p);
-
-            for(int dofIndex = 0; dofIndex < node->getNumDependentDofs(); dofIndex++) {
-                int i = node->getDependentDof(dofIndex);
-                Jt.row(i) = xformHom(node->getDerivWorldTransform(dofIndex), invP);
-            }
-
+        MatrixXd ConstraintDynamics::getJacobian(kinematics::BodyNode* node, const Vector3d& p) const {
+            // the velocity of the body point at p is that of the COM plus
+            // w x (p - COM)
+            Vector3d r = p - node->getWorldCOM();
+            MatrixXd Jv = node->getJacobianLinear();
+            MatrixXd Jw = node->getJacobianAngular();
+            MatrixXd Jt(node->getNumDependentDofs(), 3);
+            for (int i = 0; i < node->getNumDependentDofs(); i++)
+                Jt.row(i) = Jv.col(i) + Vector3d(Jw.col(i)).cross(r);
             return Jt;
         }
 
@@ -508,18 +914,17 @@ using namespace math;
             }
             return T;
         }
-        MatrixXd ConstraintDynamics::getContactMatrix() const {
-            MatrixXd E = MatrixXd::Zero(getNumContacts() * mNumDir, getNumContacts());
+        MatrixXd ConstraintDynamics::getContactMatrix(int _nContacts) const {
+            MatrixXd E = MatrixXd::Zero(_nContacts * mNumDir, _nContacts);
             VectorXd column = VectorXd::Ones(mNumDir);
-            for (int i = 0; i < getNumContacts(); i++) {
+            for (int i = 0; i < _nContacts; i++) {
                 E.block(i * mNumDir, i, mNumDir, 1) = column;
             }
             return E;
         }
 
-        MatrixXd ConstraintDynamics::getMuMatrix() const {
-            int c = getNumContacts();
-            return MatrixXd::Identity(c, c) * mMu;
+        MatrixXd ConstraintDynamics::getMuMatrix(int _nContacts) const {
+            return MatrixXd::Identity(_nContacts, _nContacts) * mMu;
 
         }
 
@@ -537,7 +942,7 @@ using namespace math;
             for (int i = 0; i < mSkels.size(); i++) {
                 if (mSkels[i]->getImmobileState())
                     continue;
-                mJMInv[i] = mJ[i] * mSkels[i]->getInvMassMatrix();
+                mJMInv[i] = mSkels[i]->solveMassMatrixMultiple(mJ[i].transpose()).transpose();
                 mGInv.triangularView<Lower>() += (mJMInv[i] * mJ[i].transpose());
             }
             mGInv = mGInv.ldlt().solve(MatrixXd::Identity(mTotalRows, mTotalRows));
@@ -561,7 +966,7 @@ using namespace math;
                     continue;
                 VectorXd qDot = mSkels[i]->getPoseVelocity();
                 mTauHat.noalias() += -(mJ[i] - mPreJ[i]) / mDt * qDot;
-                mTauHat.noalias() -= mJMInv[i] * (mSkels[i]->getInternalForces() + mSkels[i]->getExternalForces() - mSkels[i]->getCombinedVector());
+                mTauHat.noalias() -= mJMInv[i] * (mSkels[i]->getInternalForces() + mSkels[i]->getPDForces() + mSkels[i]->getExternalForces() - mSkels[i]->getCombinedVector());
             }
             mTauHat -= ks * mC + kd * mCDot;
         }
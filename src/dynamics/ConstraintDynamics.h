@@ -51,6 +51,10 @@ namespace kinematics {
     class BodyNode;
 } // namespace kinematics
 
+namespace lcpsolver {
+    class LCPSolver;
+} // namespace lcpsolver
+
 namespace dynamics {
     class SkeletonDynamics;
     class BodyNodeDynamics;
@@ -68,42 +72,133 @@ namespace dynamics {
         void setTimeStep(double _timeStep) { mDt = _timeStep; }
         double getTimeStep() const { return mDt; }
 
-        inline Eigen::VectorXd getTotalConstraintForce(int _skelIndex) const { 
+        inline const Eigen::VectorXd& getTotalConstraintForce(int _skelIndex) const { 
             return mTotalConstrForces[_skelIndex]; 
         }
 
-        inline Eigen::VectorXd getContactForce(int _skelIndex) const { 
+        inline const Eigen::VectorXd& getContactForce(int _skelIndex) const { 
             return mContactForces[_skelIndex]; 
         }
 
+        /// Transpose of the Jacobian of the point p (in world coordinates)
+        /// fixed to the body node, with a row for each dependent dof of the
+        /// node: Jv + Jw x (p - COM) from the Jacobians of the node.
+        Eigen::MatrixXd getJacobian(kinematics::BodyNode* node, const Eigen::Vector3d& p) const;
+
         inline collision::CollisionDetector* getCollisionChecker() const {
             return mCollisionChecker; 
         }
 
+        /// Let the collision nodes of the skeletons added from now on share
+        /// the collision meshes of _prototype instead of building their own.
+        /// Its skeletons have to be clones of the same models, added in the
+        /// same order; NULL builds the meshes again.
+        void setCollisionPrototype(ConstraintDynamics* _prototype);
+
         inline int getNumContacts() const { 
             return mCollisionChecker->getNumContacts();
         }
 
         inline Constraint* getConstraint(int _index) const { return mConstraints[_index]; }
 
+        /// Seed the LCP with the forces of the contacts that persist from the
+        /// previous step (on by default)
+        void setLCPWarmStart(bool _warmStart) { mLCPWarmStart = _warmStart; }
+        bool getLCPWarmStart() const { return mLCPWarmStart; }
+        inline int getNumLCPPivots() const { return mNumLCPPivots; } ///< Pivoting steps of the last LCP solve, summed over the islands
+        inline int getNumPersistentContacts() const { return mNumPersistentContacts; } ///< Contacts of the last step matched to a contact of the step before
+
+        /// Solve the LCP by matrix-free projected Gauss-Seidel instead of the
+        /// pivoting solver (off by default). It scales to many contacts as
+        /// it works on the constraint Jacobians without forming the LCP matrix.
+        void setIterativeLCP(bool _iterative) { mIterativeLCP = _iterative; }
+        bool getIterativeLCP() const { return mIterativeLCP; }
+        void setPGSParameters(int _maxIterations, double _tolerance, double _relaxation) {
+            mPGSMaxIterations = _maxIterations;
+            mPGSTolerance = _tolerance;
+            mPGSRelaxation = _relaxation;
+        }
+        inline int getNumLCPIterations() const { return mNumLCPIterations; } ///< Sweeps of the last iterative LCP solve, summed over the islands
+
+        /// The skeletons are split into islands connected by contacts, joint
+        /// limits and constraints, and each island is solved as an LCP of
+        /// its own; skeletons in no island are left out of the solve. With
+        /// more than one thread (1 by default) the islands are solved in
+        /// parallel, with the same result.
+        void setNumThreads(int _num) { mNumThreads = _num > 0 ? _num : 1; }
+        int getNumThreads() const { return mNumThreads; }
+        inline int getNumIslands() const { return mIslands.size(); } ///< Islands of the last step
+        inline int getSkeletonIsland(int _skelIndex) const { ///< Island of the skeleton in the last step; -1 if none
+            return _skelIndex < (int)mSkelIsland.size() ? mSkelIsland[_skelIndex] : -1;
+        }
+
+        /// Assemble J * MInv * J^T of the pivoting solver skeleton by
+        /// skeleton from the contacts and joint limits acting on each (on by
+        /// default) rather than from products over all the dofs of the
+        /// island. Constraints always take the dense products.
+        void setSparseLCPMatrix(bool _sparse) { mSparseLCPMatrix = _sparse; }
+        bool getSparseLCPMatrix() const { return mSparseLCPMatrix; }
+        inline double getLCPAssemblyTime() const { return mLCPAssemblyTime; } ///< Wall-clock time in seconds spent assembling the matrices of the pivoting solver in the last step, summed over the islands
+
 
     private:
+        // one side of a contact on a movable skeleton, over the dofs its
+        // body depends on
+        struct ContactJacobian {
+            int contact; // index into the contacts of the island
+            int slot; // position of the skeleton in the skeletons of the island
+            std::vector<int> dofs; // island dofs
+            Eigen::MatrixXd Jt; // dofs x (1 + mNumDir): the normal, then the tangents
+        };
+
+        // skeletons coupled by the contacts, joint limits or constraints of
+        // this step, with the LCP over their dofs
+        struct Island {
+            std::vector<int> skels; // ascending
+            std::vector<int> indices; // first dof of each skeleton in the island dofs, followed by their number
+            std::vector<int> contacts; // indices of the contacts of mCollisionChecker, ascending
+            std::vector<int> limits; // indices into mLimitingDofIndex
+            std::vector<int> limitDofs; // the entries of mLimitingDofIndex over the island dofs
+            std::vector<ContactJacobian> contactJacobians; // in the order of the contacts
+            Eigen::MatrixXd A;
+            Eigen::VectorXd qBar;
+            Eigen::VectorXd x;
+            Eigen::MatrixXd Jc; // rows of the constraint Jacobian: normals, tangents, joint limits
+            Eigen::MatrixXd MInvJt; // MInv * Jc^T
+            int numPivots;
+            int numIterations;
+            int numPersistentContacts;
+            double assemblyTime; // seconds spent in fillMatrices
+        };
+
         void initialize();
         void destroy();
 
         void computeConstraintWithoutContact();
-        void fillMatrices();
-        bool solve();
+        void updateRestingNodes(); // nodes of sleeping and immobile skeletons are not checked against each other
+        bool wakeTouchedSkeletons(); // wake the sleeping skeletons in contact with an awake one; false if there are none
+        Eigen::VectorXd computeFreeVelocity(); // MInv * (tauStar + constraint terms)
+        Eigen::VectorXd computeFreeVelocity(const Island& _island); // the same over the island dofs
+        void buildIslands();
+        int getSkelIndexOfDof(int _dof) const;
+        void solveIsland(Island& _island, lcpsolver::LCPSolver& _solver);
+        void fillMatrices(Island& _island);
+        void fillJacobians(Island& _island); // Jc, MInvJt and qBar for the iterative solver
+        Eigen::MatrixXd getJacobianTranspose(const Island& _island) const; // the normal, tangent and signed joint limit columns, over the island dofs
+        Eigen::MatrixXd computeDelassusMatrix(const Island& _island) const; // J * MInv * J^T from the blocks of the skeletons of the island
         void applySolution();
 
         void updateMassMat();
+        Eigen::MatrixXd solveMass(const Eigen::MatrixXd& _B, bool _projected) const; // MInv * _B, or (MInv - Z) * _B if _projected, without forming MInv
+        Eigen::MatrixXd solveMass(const Island& _island, const Eigen::MatrixXd& _B) const; // the same over the island dofs, projected if there are constraints
         void updateTauStar();
-        void updateNBMatrices();
-        Eigen::MatrixXd getJacobian(kinematics::BodyNode* node, const Eigen::Vector3d& p);
+        void updateContactJacobians(Island& _island);
         Eigen::MatrixXd getTangentBasisMatrix(const Eigen::Vector3d& p, const Eigen::Vector3d& n) ; // gets a matrix of tangent dirs.
-        Eigen::MatrixXd getContactMatrix() const; // E matrix
-        Eigen::MatrixXd getMuMatrix() const; // mu matrix
+        Eigen::MatrixXd getContactMatrix(int _nContacts) const; // E matrix
+        Eigen::MatrixXd getMuMatrix(int _nContacts) const; // mu matrix
         void updateConstraintTerms();
+        bool fillInitialGuess(Island& _island); // x from the solution of the previous step; false if nothing persists
+        void storeSolution();
 
         inline int getTotalNumDofs() const { return mIndices[mIndices.size() - 1]; }
 
@@ -117,15 +212,13 @@ namespace dynamics {
         int mNumDir; // number of basis directions            
 
         // Cached (aggregated) mass/tau matrices
-        Eigen::MatrixXd mMInv;
         Eigen::VectorXd mTauStar;
-        Eigen::MatrixXd mN;
-        Eigen::MatrixXd mB;
-            
-        // Matrices to pass to solver
-        Eigen::MatrixXd mA;
-        Eigen::VectorXd mQBar;
-        Eigen::VectorXd mX;
+
+        // islands of the last step
+        std::vector<Island> mIslands;
+        std::vector<int> mSkelIsland; // island of each skeleton; -1 if none
+        std::vector<int> mSkelOffset; // first dof of each skeleton in its island
+        std::vector<lcpsolver::LCPSolver*> mLCPSolvers; // one per island, kept across steps for their work arrays
 
         std::vector<Eigen::VectorXd> mContactForces; 
         std::vector<Eigen::VectorXd> mTotalConstrForces; // solved constraint force in generalized coordinates; mTotalConstrForces[i] is the constraint force for the ith skeleton
@@ -142,6 +235,30 @@ namespace dynamics {
         Eigen::VectorXd mC; // M * 1
         Eigen::VectorXd mCDot; // M * 1
         std::vector<int> mLimitingDofIndex; // if dof i hits upper limit, we store this information as mLimitingDofIndex.push_back(i+1), if dof i hits lower limite, mLimitingDofIndex.push_back(-(i+1));
+
+        // contact persistence
+        struct PersistentContact {
+            EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+            kinematics::BodyNode* bodyNode1;
+            kinematics::BodyNode* bodyNode2;
+            Eigen::Vector3d localPoint; // contact point in the frame of bodyNode1
+            double normalForce;
+            Eigen::VectorXd tangentForces;
+        };
+        std::vector<PersistentContact, Eigen::aligned_allocator<PersistentContact> > mPrevContacts;
+        std::vector<int> mPrevLimitingDofIndex;
+        Eigen::VectorXd mPrevLimitForces;
+        bool mLCPWarmStart;
+        int mNumLCPPivots;
+        int mNumPersistentContacts;
+        bool mIterativeLCP;
+        int mPGSMaxIterations;
+        double mPGSTolerance;
+        double mPGSRelaxation;
+        int mNumLCPIterations;
+        int mNumThreads;
+        bool mSparseLCPMatrix;
+        double mLCPAssemblyTime;
     };
 } // namespace dynamics
 
@@ -164,7 +164,7 @@ void ContactDynamics::updateTauStar() {
         if (mSkels[i]->getImmobileState())
             continue;
 
-        VectorXd tau = mSkels[i]->getExternalForces() + mSkels[i]->getInternalForces();
+        VectorXd tau = mSkels[i]->getExternalForces() + mSkels[i]->getInternalForces() + mSkels[i]->getPDForces();
         VectorXd tauStar = mSkels[i]->getMassMatrix() * mSkels[i]->getPoseVelocity();
         tauStar.noalias() -= (mDt * (mSkels[i]->getCombinedVector() - tau));
         mTauStar.segment(startRow, tauStar.rows()) = tauStar;
@@ -46,7 +46,7 @@ using namespace Eigen;
 using namespace kinematics;
 
 namespace dynamics{
-    SkeletonDynamics::SkeletonDynamics(): kinematics::Skeleton(), mImmobile(false), mJointLimit(true){
+    SkeletonDynamics::SkeletonDynamics(): kinematics::Skeleton(), mMassFactorValid(false), mImmobile(false), mAsleep(false), mJointLimit(true), mUseCRBA(true), mMassMatrixUpdated(false){
     }
 
     SkeletonDynamics::~SkeletonDynamics(){
@@ -63,6 +63,17 @@ namespace dynamics{
         mFintMin = VectorXd::Zero(getNumDofs());
         mFintMax = VectorXd::Zero(getNumDofs());
         mFext = VectorXd::Zero(getNumDofs());
+        mMassFactor = MatrixXd::Zero(getNumDofs(), getNumDofs());
+        mFpd = VectorXd::Zero(getNumDofs());
+
+        // the dependent dofs of a node are those of its parent followed by
+        // its own, so each dof hangs off its predecessor in the list
+        mDofParents.assign(getNumDofs(), -1);
+        for (int i = 0; i < getNumNodes(); i++) {
+            BodyNode *nodei = getNode(i);
+            for (int j = 1; j < nodei->getNumDependentDofs(); j++)
+                mDofParents[nodei->getDependentDof(j)] = nodei->getDependentDof(j - 1);
+        }
 
         for (unsigned int i = 0; i < mFint.size(); ++i)
         {
@@ -77,6 +88,27 @@ namespace dynamics{
         return new BodyNodeDynamics(_name);
     }
 
+    SkeletonDynamics* SkeletonDynamics::clone() const {
+        SkeletonDynamics* skel = new SkeletonDynamics();
+        cloneStructure(skel);
+        skel->mImmobile = mImmobile;
+        skel->mAsleep = mAsleep;
+        skel->mJointLimit = mJointLimit;
+        skel->mUseCRBA = mUseCRBA;
+        // the state vectors exist only if initDynamics has been called on this skeleton
+        skel->initDynamics();
+        if (mQdot.size() == getNumDofs()) {
+            skel->mQdot = mQdot;
+            skel->mFint = mFint;
+            skel->mFintMin = mFintMin;
+            skel->mFintMax = mFintMax;
+        }
+        skel->mKp = mKp;
+        skel->mKd = mKd;
+        skel->mPDTarget = mPDTarget;
+        return skel;
+    }
+
     // computes the C term and gravity, excluding external forces
     VectorXd SkeletonDynamics::computeInverseDynamicsLinear(
             const Vector3d &_gravity,
@@ -84,6 +116,19 @@ namespace dynamics{
             const VectorXd *_qdotdot,
             bool _computeJacobians,
             bool _withExternalForces)
+    {
+        VectorXd torqueGen;
+        computeInverseDynamicsLinear(_gravity, _qdot, _qdotdot, torqueGen, _computeJacobians, _withExternalForces);
+        return torqueGen;
+    }
+
+    void SkeletonDynamics::computeInverseDynamicsLinear(
+            const Vector3d &_gravity,
+            const VectorXd *_qdot,
+            const VectorXd *_qdotdot,
+            VectorXd &_torques,
+            bool _computeJacobians,
+            bool _withExternalForces)
     {
         // FORWARD PASS: compute the velocities recursively - from root to end
         // effectors
@@ -102,7 +147,7 @@ namespace dynamics{
                                            _computeJacobians);
         }
 
-        VectorXd torqueGen = VectorXd::Zero(getNumDofs());
+        _torques.setZero(getNumDofs());
         // BACKWARD PASS: compute the forces recursively -  from end effectors
         // to root
         for (int i = getNumNodes() - 1; i >= 0; i--)
@@ -117,31 +162,108 @@ namespace dynamics{
                                        _qdot,
                                        _qdotdot,
                                        _withExternalForces);
-            nodei->getGeneralized(torqueGen); // convert joint forces to generalized coordinates
+            nodei->getGeneralized(_torques); // convert joint forces to generalized coordinates
         }
 
         if ( _withExternalForces )
             clearExternalForces();
+    }
 
-        return torqueGen;
+    VectorXd SkeletonDynamics::computeForwardDynamics(
+            const Vector3d &_gravity,
+            const VectorXd &_qdot,
+            const VectorXd &_tau,
+            bool _withExternalForces)
+    {
+        VectorXd qdotdot;
+        computeForwardDynamics(_gravity, _qdot, _tau, qdotdot, _withExternalForces);
+        return qdotdot;
+    }
+
+    void SkeletonDynamics::computeForwardDynamics(
+            const Vector3d &_gravity,
+            const VectorXd &_qdot,
+            const VectorXd &_tau,
+            VectorXd &_qdotdot,
+            bool _withExternalForces)
+    {
+        // FIRST PASS: velocities and rigid body inertias - from root to end
+        // effectors
+        for (int i = 0; i < getNumNodes(); i++)
+        {
+            BodyNodeDynamics *nodei
+                    = static_cast<BodyNodeDynamics*>(getNode(i));
+            nodei->initInverseDynamics();
+            nodei->computeArtBodyVelocities(_qdot, _withExternalForces);
+        }
+
+        // SECOND PASS: articulated body inertias and bias forces - from end
+        // effectors to root
+        for (int i = getNumNodes() - 1; i >= 0; i--)
+        {
+            BodyNodeDynamics *nodei
+                    = static_cast<BodyNodeDynamics*>(getNode(i));
+            nodei->computeArtBodyInertias(_tau);
+        }
+
+        // THIRD PASS: accelerations - from root to end effectors
+        _qdotdot.setZero(getNumDofs());
+        for (int i = 0; i < getNumNodes(); i++)
+        {
+            BodyNodeDynamics *nodei
+                    = static_cast<BodyNodeDynamics*>(getNode(i));
+            nodei->computeArtBodyAccelerations(_gravity, _qdotdot);
+        }
+
+        if ( _withExternalForces )
+            clearExternalForces();
+    }
+
+    void SkeletonDynamics::computeHybridDynamics(
+            const Vector3d &_gravity,
+            const VectorXd &_qdot,
+            const std::vector<bool> &_prescribed,
+            VectorXd &_qdotdot,
+            VectorXd &_tau,
+            bool _withExternalForces)
+    {
+        assert((int)_prescribed.size() == getNumDofs());
+        for (int i = 0; i < getNumNodes(); i++)
+        {
+            BodyNodeDynamics *nodei
+                    = static_cast<BodyNodeDynamics*>(getNode(i));
+            nodei->initInverseDynamics();
+            nodei->computeArtBodyVelocities(_qdot, _withExternalForces);
+        }
+
+        // the prescribed dofs pass their articulated inertia on to the parent
+        // unreduced
+        for (int i = getNumNodes() - 1; i >= 0; i--)
+        {
+            BodyNodeDynamics *nodei
+                    = static_cast<BodyNodeDynamics*>(getNode(i));
+            nodei->computeArtBodyInertias(_tau, &_prescribed, &_qdotdot);
+        }
+
+        for (int i = 0; i < getNumNodes(); i++)
+        {
+            BodyNodeDynamics *nodei
+                    = static_cast<BodyNodeDynamics*>(getNode(i));
+            nodei->computeArtBodyAccelerations(_gravity, _qdotdot, &_tau);
+        }
+
+        if ( _withExternalForces )
+            clearExternalForces();
     }
 
     // after the computation, mM, mCg, and mFext are ready for use
-    void SkeletonDynamics::computeDynamics(const Vector3d &_gravity, const VectorXd &_qdot, bool _useInvDynamics, bool _calcMInv){
-        mM.setZero();
+    void SkeletonDynamics::computeDynamics(const Vector3d &_gravity, const VectorXd &_qdot, bool _useInvDynamics, bool _calcMInv, bool _calcM){
         //mC = MatrixXd::Zero(getNumDofs(), getNumDofs());
         mCvec.setZero();
         mG.setZero();
         if (_useInvDynamics)
         {
-            mCg = computeInverseDynamicsLinear(_gravity, &_qdot, NULL, true, false);
-            for (int i = 0; i < getNumNodes(); i++) {
-                BodyNodeDynamics *nodei = static_cast<BodyNodeDynamics*>(getNode(i));
-                // mass matrix M
-                nodei->evalMassMatrix(); // assumes Jacobians mJv and mJw have been computed above: use flag as true in computeInverseDynamicsLinear
-                nodei->aggregateMass(mM);
-            }
-
+            computeInverseDynamicsLinear(_gravity, &_qdot, NULL, mCg, true, false);
             evalExternalForces( true );
             //mCg -= mFext;
         }
@@ -158,9 +280,6 @@ namespace dynamics{
                 nodei->updateFirstDerivatives();
                 nodei->updateSecondDerivatives();
                 // compute the required data structures and add to the skel's data structures
-                // mass matrix M
-                nodei->evalMassMatrix();
-                nodei->aggregateMass(mM);
                 //// Coriolis C
                 //nodei->evalCoriolisMatrix(_qdot);
                 //nodei->addCoriolis(mC);
@@ -178,12 +297,309 @@ namespace dynamics{
         } 
         mQdot = _qdot;
 
+        mMassMatrixUpdated = false;
+        if(_calcM)
+            computeMassMatrix(_calcMInv);
+        
+        clearExternalForces();
+    }
+
+    void SkeletonDynamics::computeMassMatrix(bool _calcMInv){
+        mM.setZero();
+        if (mUseCRBA)
+        {
+            // composite rigid body algorithm: one backward sweep for the
+            // subtree inertias, then one pass up the ancestors per node
+            for (int i = 0; i < getNumNodes(); i++)
+                static_cast<BodyNodeDynamics*>(getNode(i))->initCompositeInertia();
+            for (int i = getNumNodes() - 1; i >= 0; i--)
+                static_cast<BodyNodeDynamics*>(getNode(i))->computeCompositeInertia();
+            for (int i = 0; i < getNumNodes(); i++)
+                static_cast<BodyNodeDynamics*>(getNode(i))->aggregateMassCRBA(mM);
+        }
+        else
+        {
+            for (int i = 0; i < getNumNodes(); i++) {
+                BodyNodeDynamics *nodei = static_cast<BodyNodeDynamics*>(getNode(i));
+                // assumes Jacobians mJv and mJw have been computed by the last dynamics computation
+                nodei->evalMassMatrix();
+                nodei->aggregateMass(mM);
+            }
+        }
+
+        factorizeMassMatrix();
         if(_calcMInv)
         {
-            mMInv = mM.ldlt().solve(MatrixXd::Identity(getNumDofs(), getNumDofs()));
+            mMInv = solveMassMatrixMultiple(MatrixXd::Identity(getNumDofs(), getNumDofs()));
         }
-        
-        clearExternalForces();
+        mMassMatrixUpdated = true;
+    }
+
+    // Featherstone's LTL factorization: eliminating from the leaves to the
+    // root only ever touches the ancestors of a dof, so the fill-in stays
+    // inside the sparsity pattern of M and the cost is O(n*d^2) for a tree of
+    // depth d. Factorizes _L in place
+    static bool factorizeLTL(MatrixXd& _L, const std::vector<int>& _parents){
+        for (int k = _L.rows() - 1; k >= 0; k--) {
+            if (_L(k, k) <= 0.0)
+                return false;
+            _L(k, k) = sqrt(_L(k, k));
+            for (int i = _parents[k]; i >= 0; i = _parents[i])
+                _L(k, i) /= _L(k, k);
+            for (int i = _parents[k]; i >= 0; i = _parents[i])
+                for (int j = i; j >= 0; j = _parents[j])
+                    _L(i, j) -= _L(k, i) * _L(k, j);
+        }
+        return true;
+    }
+
+    bool SkeletonDynamics::factorizeMassMatrix(){
+        mMassFactor = mM;
+        mMassFactorValid = factorizeLTL(mMassFactor, mDofParents);
+        return mMassFactorValid;
+    }
+
+    // solves L^T*y = b in place for every column of _y, from the leaves to
+    // the root
+    template <typename MatrixType>
+    static void solveLT(const MatrixXd& _L, const std::vector<int>& _parents, MatrixType& _y){
+        for (int i = _y.rows() - 1; i >= 0; i--) {
+            _y.row(i) /= _L(i, i);
+            for (int j = _parents[i]; j >= 0; j = _parents[j])
+                _y.row(j) -= _L(i, j) * _y.row(i);
+        }
+    }
+
+    // solves L^T*L*x = b in place for every column of _x
+    template <typename MatrixType>
+    static void solveLTL(const MatrixXd& _L, const std::vector<int>& _parents, MatrixType& _x){
+        int n = _x.rows();
+        // L^T*y = b
+        solveLT(_L, _parents, _x);
+        // L*x = y, from the root to the leaves
+        for (int i = 0; i < n; i++) {
+            for (int j = _parents[i]; j >= 0; j = _parents[j])
+                _x.row(i) -= _L(i, j) * _x.row(j);
+            _x.row(i) /= _L(i, i);
+        }
+    }
+
+    VectorXd SkeletonDynamics::solveMassMatrix(const VectorXd& _v) const{
+        VectorXd x;
+        solveMassMatrix(_v, x);
+        return x;
+    }
+
+    void SkeletonDynamics::solveMassMatrix(const VectorXd& _v, VectorXd& _x) const{
+        if (!mMassFactorValid) {
+            _x = mM.ldlt().solve(_v);
+            return;
+        }
+        _x = _v;
+        solveLTL(mMassFactor, mDofParents, _x);
+    }
+
+    MatrixXd SkeletonDynamics::solveMassMatrixMultiple(const MatrixXd& _B) const{
+        if (!mMassFactorValid)
+            return mM.ldlt().solve(_B);
+        MatrixXd X = _B;
+        solveLTL(mMassFactor, mDofParents, X);
+        return X;
+    }
+
+    // Operational space inertia from M = L^T*L: J*M^{-1}*J^T = Y^T*Y with
+    // Y = L^{-T}*J^T. The rows of an end effector are nonzero only on the
+    // dofs it depends on, which are closed under taking ancestors, so its
+    // columns of Y are solved along that chain alone in O(d^2) for a chain of
+    // d dofs, and neither M^{-1} nor any n x n solve is needed
+    void SkeletonDynamics::computeTaskDynamics(const std::vector<BodyNode*>& _nodes, const std::vector<Vector3d>& _offsets, bool _withOrientation){
+        assert(_nodes.size() == _offsets.size());
+        int nDofs = getNumDofs();
+        int taskDim = _withOrientation ? 6 : 3;
+        int nRows = taskDim * _nodes.size();
+        if (!mMassMatrixUpdated)
+            computeMassMatrix(false);
+
+        for (int i = 0; i < getNumNodes(); i++)
+            static_cast<BodyNodeDynamics*>(getNode(i))->computeVelocityProductAcceleration();
+        mTaskJ.setZero(nRows, nDofs);
+        mTaskBiasAcc.resize(nRows);
+        for (unsigned int k = 0; k < _nodes.size(); k++) {
+            BodyNodeDynamics *node = static_cast<BodyNodeDynamics*>(_nodes[k]);
+            node->evalTaskJacobian(_offsets[k], _withOrientation, k * taskDim, mTaskJ);
+            node->evalTaskBiasAcceleration(_offsets[k], _withOrientation, k * taskDim, mTaskBiasAcc);
+        }
+
+        VectorXd JMInvCg;
+        if (mMassFactorValid) {
+            mTaskY.setZero(nDofs, nRows);
+            for (unsigned int k = 0; k < _nodes.size(); k++) {
+                int numDeps = _nodes[k]->getNumDependentDofs();
+                if (numDeps == 0)
+                    continue;
+                int last = _nodes[k]->getDependentDof(numDeps - 1);
+                for (int i = last; i >= 0; i = mDofParents[i])
+                    mTaskY.block(i, k * taskDim, 1, taskDim) = mTaskJ.block(k * taskDim, i, taskDim, 1).transpose();
+                for (int i = last; i >= 0; i = mDofParents[i]) {
+                    mTaskY.block(i, k * taskDim, 1, taskDim) /= mMassFactor(i, i);
+                    for (int j = mDofParents[i]; j >= 0; j = mDofParents[j])
+                        mTaskY.block(j, k * taskDim, 1, taskDim) -= mMassFactor(i, j) * mTaskY.block(i, k * taskDim, 1, taskDim);
+                }
+            }
+            mTaskInvInertia.noalias() = mTaskY.transpose() * mTaskY;
+            // J*M^{-1}*Cg = Y^T*(L^{-T}*Cg)
+            VectorXd z = mCg;
+            solveLT(mMassFactor, mDofParents, z);
+            JMInvCg.noalias() = mTaskY.transpose() * z;
+        } else {
+            LDLT<MatrixXd> ldlt(mM);
+            mTaskInvInertia.noalias() = mTaskJ * ldlt.solve(mTaskJ.transpose());
+            JMInvCg.noalias() = mTaskJ * ldlt.solve(mCg);
+        }
+        mTaskInertia = mTaskInvInertia.ldlt().solve(MatrixXd::Identity(nRows, nRows));
+        mTaskBiasForce.noalias() = mTaskInertia * (JMInvCg - mTaskBiasAcc);
+    }
+
+    // Centroidal momentum in the manner of the composite rigid body
+    // algorithm: column i of A_G is the momentum of the subtree moved by dof i
+    // at unit velocity, i.e. its composite inertia times the motion subspace,
+    // moved to the center of mass. The bias is the sum of the velocity
+    // product momentum rates I*a + v x* I*v of the bodies
+    void SkeletonDynamics::computeCentroidalMomentum(const VectorXd& _qdot){
+        int nNodes = getNumNodes();
+        for (int i = 0; i < nNodes; i++) {
+            BodyNodeDynamics *nodei = static_cast<BodyNodeDynamics*>(getNode(i));
+            nodei->computeSpatialVelocity(_qdot);
+            nodei->computeVelocityProductAcceleration();
+            nodei->mCompositeInertia = nodei->getSpatialInertia();
+        }
+        for (int i = nNodes - 1; i >= 0; i--)
+            static_cast<BodyNodeDynamics*>(getNode(i))->computeCompositeInertia();
+
+        Vector3d com = getWorldCOM();
+        mCentroidalMomentumMatrix.setZero(6, getNumDofs());
+        mCentroidalMomentumBias.setZero(6);
+        for (int i = 0; i < nNodes; i++)
+            static_cast<BodyNodeDynamics*>(getNode(i))->aggregateCentroidalMomentum(com, mCentroidalMomentumMatrix, mCentroidalMomentumBias);
+        mCentroidalMomentum.noalias() = mCentroidalMomentumMatrix * _qdot;
+    }
+
+    // Forward mode differentiation of the recursive Newton-Euler algorithm. A
+    // dof changes the velocities and accelerations of the subtree below its
+    // joint only, and the forces of that subtree and of the ancestors, so
+    // each sweep touches those nodes alone
+    void SkeletonDynamics::computeInverseDynamicsDerivatives(const Vector3d& _gravity, const VectorXd& _qdot, const VectorXd& _qdotdot){
+        int nDofs = getNumDofs();
+        int nNodes = getNumNodes();
+
+        VectorXd torques;
+        computeInverseDynamicsLinear(_gravity, &_qdot, &_qdotdot, torques, true, false);
+        for (int i = 0; i < nNodes; i++)
+            static_cast<BodyNodeDynamics*>(getNode(i))->evalJointDerivatives(_qdot);
+
+        mTorqueDerivPose.setZero(nDofs, nDofs);
+        mTorqueDerivVel.setZero(nDofs, nDofs);
+        VectorXd tauDeriv(nDofs);
+        std::vector<char> moved(nNodes), loaded(nNodes);
+        for (int b = 0; b < nNodes; b++) {
+            BodyNodeDynamics *nodeb = static_cast<BodyNodeDynamics*>(getNode(b));
+            if (nodeb->getNumLocalDofs() == 0)
+                continue;
+
+            // the subtree of nodeb, and the nodes whose joint forces it changes;
+            // the motion of the others does not depend on the dofs of nodeb
+            for (int i = 0; i < nNodes; i++) {
+                BodyNodeDynamics *nodei = static_cast<BodyNodeDynamics*>(getNode(i));
+                BodyNode *parent = nodei->getParentNode();
+                moved[i] = i == b || (i > b && parent && moved[parent->getSkelIndex()]);
+                loaded[i] = moved[i];
+                if (!moved[i]) {
+                    nodei->mVelDeriv.setZero();
+                    nodei->mAccDeriv.setZero();
+                }
+            }
+            for (BodyNode *node = nodeb->getParentNode(); node; node = node->getParentNode())
+                loaded[node->getSkelIndex()] = true;
+
+            for (int k = 0; k < nodeb->getNumLocalDofs(); k++) {
+                int dof = nodeb->getDof(k)->getSkelIndex();
+                for (int wrtVel = 0; wrtVel < 2; wrtVel++) {
+                    for (int i = b; i < nNodes; i++) {
+                        if (moved[i])
+                            static_cast<BodyNodeDynamics*>(getNode(i))->computeInvDynDerivVelocities(_qdot, _qdotdot, i == b ? k : -1, wrtVel);
+                    }
+                    tauDeriv.setZero();
+                    for (int i = nNodes - 1; i >= 0; i--) {
+                        BodyNodeDynamics *nodei = static_cast<BodyNodeDynamics*>(getNode(i));
+                        if (loaded[i])
+                            nodei->computeInvDynDerivForces(i == b ? k : -1, wrtVel, tauDeriv);
+                        else
+                            nodei->mForceDeriv.setZero();
+                    }
+                    if (wrtVel)
+                        mTorqueDerivVel.col(dof) = tauDeriv;
+                    else
+                        mTorqueDerivPose.col(dof) = tauDeriv;
+                }
+            }
+        }
+    }
+
+    void SkeletonDynamics::computeForwardDynamicsDerivatives(const Vector3d& _gravity, const VectorXd& _qdot, const VectorXd& _tau){
+        // differentiating M*qdd + Cg = tau at the forward dynamics solution
+        VectorXd qdotdot = computeForwardDynamics(_gravity, _qdot, _tau);
+        computeInverseDynamicsDerivatives(_gravity, _qdot, qdotdot);
+        computeMassMatrix(false);
+        mAccDerivPose = -solveMassMatrixMultiple(mTorqueDerivPose);
+        mAccDerivVel = -solveMassMatrixMultiple(mTorqueDerivVel);
+        mAccDerivForce = solveMassMatrixMultiple(MatrixXd::Identity(getNumDofs(), getNumDofs()));
+    }
+
+    void SkeletonDynamics::setPDGains(const VectorXd& _kp, const VectorXd& _kd){
+        assert(_kp.size() == getNumDofs() && _kd.size() == getNumDofs());
+        mKp = _kp;
+        mKd = _kd;
+        if (mPDTarget.size() != getNumDofs())
+            mPDTarget = getPose();
+    }
+
+    void SkeletonDynamics::clearPDGains(){
+        mKp.resize(0);
+        mKd.resize(0);
+        mPDTarget.resize(0);
+        mFpd.setZero();
+    }
+
+    // stable PD: the servo forces are evaluated at the state at the end of
+    // the step, q + _dt*qdot' and qdot' = qdot + _dt*qdd, and linearized so
+    // that qdd solves (M + _dt*Kd + _dt^2*Kp)*qdd = -Cg + Fext + Fint + Fpd(q + _dt*qdot, qdot).
+    // Contact and constraint impulses are left out of the linearization: they
+    // are solved afterwards against M alone, so the servos do not anticipate
+    // them and only see their effect through the state at the next step
+    void SkeletonDynamics::computePDForces(double _dt){
+        if (!hasPDGains()) {
+            mFpd.setZero();
+            return;
+        }
+        mFpd = -mKp.cwiseProduct(getPose() + _dt * mQdot - mPDTarget) - mKd.cwiseProduct(mQdot);
+        if (_dt <= 0.0)
+            return;
+
+        if (!mMassMatrixUpdated)
+            computeMassMatrix(false);
+        // the diagonal terms leave the sparsity pattern of M unchanged, so
+        // the augmented matrix is factorized along the tree like M itself
+        mPDFactor = mM;
+        mPDFactor.diagonal() += _dt * mKd + (_dt * _dt) * mKp;
+        VectorXd qddot = -mCg + mFext + mFint + mFpd;
+        if (factorizeLTL(mPDFactor, mDofParents)) {
+            solveLTL(mPDFactor, mDofParents, qddot);
+        } else {
+            MatrixXd A = mM;
+            A.diagonal() += _dt * mKd + (_dt * _dt) * mKp;
+            qddot = A.ldlt().solve(qddot);
+        }
+        mFpd -= _dt * (mKd + _dt * mKp).cwiseProduct(qddot);
     }
 
     void SkeletonDynamics::evalExternalForces(bool _useRecursive){
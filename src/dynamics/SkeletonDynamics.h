@@ -53,12 +53,51 @@ namespace dynamics{
         virtual ~SkeletonDynamics();
 
         virtual kinematics::BodyNode* createBodyNode(const char* const _name = NULL); ///< Creates a derived class of BodyNode that calculates the dynamics quantities
+        virtual SkeletonDynamics* clone() const; ///< Deep copy with the current pose, velocity, internal forces and dynamics settings, ready for evaluation in another thread; see kinematics::Skeleton::clone
 
         void initDynamics();
         // inverse dynamics computation
         Eigen::VectorXd computeInverseDynamicsLinear(const Eigen::Vector3d &_gravity, const Eigen::VectorXd *_qdot, const Eigen::VectorXd *_qdotdot=NULL, bool _computeJacobians=true, bool _withExternalForces=false); ///< runs recursive inverse dynamics algorithm and returns the generalized forces; if qdd is NULL, it is treated as zero; also computes Jacobian Jv and Jw in iterative manner if the flag is true i.e. replaces updateFirstDerivatives of non-recursive dynamics; when _withExternalForces is true, external forces will be accounted for in the returned generalized forces; when _withExternalForces is false, only the sum of Corolis force and gravity is returned
+        void computeInverseDynamicsLinear(const Eigen::Vector3d &_gravity, const Eigen::VectorXd *_qdot, const Eigen::VectorXd *_qdotdot, Eigen::VectorXd &_torques, bool _computeJacobians=true, bool _withExternalForces=false); ///< same as above, but writes the generalized forces into _torques, which is not reallocated if it already has the right size
         
-        void computeDynamics(const Eigen::Vector3d &_gravity, const Eigen::VectorXd &_qdot, bool _useInvDynamics = true, bool _calcMInv = true);  ///< compute equations of motion matrices/vectors: M, C/Cvec, g in M*qdd + C*qd + g; if _useInvDynamics==true, uses computeInverseDynamicsLinear to compute C*qd+g term directly; else uses expensive generic computation of non-recursive dynamics. Note that different quantities are computed using different algorithms. At the end, mass matrix M, Coriolis force plus gravity Cg, and the external force Fext will be ready to use. The generalized force of gravity g is also updated if nonrecursive formula is used.
+        Eigen::VectorXd computeForwardDynamics(const Eigen::Vector3d &_gravity, const Eigen::VectorXd &_qdot, const Eigen::VectorXd &_tau, bool _withExternalForces=false); ///< runs the O(n) articulated body algorithm and returns the accelerations qdd caused by the generalized forces _tau, gravity, and the external forces if _withExternalForces is true; the mass matrix is neither formed nor inverted. Assumes the pose has already been set; transforms are updated along the way as in computeInverseDynamicsLinear, but the Jacobians are not
+        void computeForwardDynamics(const Eigen::Vector3d &_gravity, const Eigen::VectorXd &_qdot, const Eigen::VectorXd &_tau, Eigen::VectorXd &_qdotdot, bool _withExternalForces=false); ///< same as above, but writes the accelerations into _qdotdot, which is not reallocated if it already has the right size
+        void computeHybridDynamics(const Eigen::Vector3d &_gravity, const Eigen::VectorXd &_qdot, const std::vector<bool> &_prescribed, Eigen::VectorXd &_qdotdot, Eigen::VectorXd &_tau, bool _withExternalForces=false); ///< O(n) hybrid dynamics: the dofs flagged in _prescribed move with the accelerations given in _qdotdot, and the others are driven by the generalized forces given in _tau. On return, _qdotdot holds the accelerations of the free dofs as well, and _tau the generalized forces the prescribed dofs take to follow theirs. Runs the articulated body algorithm with the prescribed dofs folded into the velocity product terms, so neither M nor Cg is formed; with no dof prescribed, it is computeForwardDynamics. Assumes the pose has already been set
+
+        
+        void computeDynamics(const Eigen::Vector3d &_gravity, const Eigen::VectorXd &_qdot, bool _useInvDynamics = true, bool _calcMInv = true, bool _calcM = true);  ///< compute equations of motion matrices/vectors: M, C/Cvec, g in M*qdd + C*qd + g; if _useInvDynamics==true, uses computeInverseDynamicsLinear to compute C*qd+g term directly; else uses expensive generic computation of non-recursive dynamics. Note that different quantities are computed using different algorithms. At the end, mass matrix M, Coriolis force plus gravity Cg, and the external force Fext will be ready to use. The generalized force of gravity g is also updated if nonrecursive formula is used. If _calcM is false, M and MInv are not computed here; call computeMassMatrix later if they turn out to be needed. M is assembled by the method selected with setUseCRBA
+        void computeMassMatrix(bool _calcMInv = true); ///< assemble and factorize M, and compute the dense MInv if _calcMInv is true, from the transforms and Jacobians of the last computeDynamics call; the pose must not have changed in between
+        bool factorizeMassMatrix(); ///< factorize M = L^T*L, where L inherits the branch-induced sparsity of the tree (L(i,j) is nonzero only if dof j is an ancestor of dof i); called by computeMassMatrix. Returns false if M is not positive definite, in which case the solves fall back to a dense LDLT
+        Eigen::VectorXd solveMassMatrix(const Eigen::VectorXd &_v) const; ///< returns M^{-1}*_v from the factorization of the last computeMassMatrix call without forming M^{-1}
+        void solveMassMatrix(const Eigen::VectorXd &_v, Eigen::VectorXd &_x) const; ///< same as above, but writes M^{-1}*_v into _x, which may be _v itself and is not reallocated if it already has the right size
+        Eigen::MatrixXd solveMassMatrixMultiple(const Eigen::MatrixXd &_B) const; ///< returns M^{-1}*_B column by column from the factorization, e.g. M^{-1}*J^T for a constraint Jacobian J
+
+        void computeTaskDynamics(const std::vector<kinematics::BodyNode*> &_nodes, const std::vector<Eigen::Vector3d> &_offsets, bool _withOrientation = false); ///< compute the task-space dynamics of the end effectors at the local _offsets of _nodes from the state of the last computeDynamics call, which must have used the recursive inverse dynamics: the task Jacobian J, the operational space inertia Lambda = (J*M^{-1}*J^T)^{-1} and the bias force. J*M^{-1}*J^T is computed from the tree factorization of M, one ancestor chain per end effector, without forming M^{-1}. The mass matrix is computed if it is not up to date
+        const Eigen::MatrixXd& getTaskJacobian() const { return mTaskJ; } ///< J of the last computeTaskDynamics call: for each end effector, 3 rows for the world velocity of the point, followed by 3 for the world angular velocity of its body if orientations were asked for
+        const Eigen::MatrixXd& getTaskInertia() const { return mTaskInertia; } ///< operational space inertia Lambda = (J*M^{-1}*J^T)^{-1}
+        const Eigen::MatrixXd& getTaskInvInertia() const { return mTaskInvInertia; } ///< J*M^{-1}*J^T
+        const Eigen::VectorXd& getTaskBiasAcceleration() const { return mTaskBiasAcc; } ///< Jdot*qdot
+        const Eigen::VectorXd& getTaskBiasForce() const { return mTaskBiasForce; } ///< Lambda*(J*M^{-1}*Cg - Jdot*qdot): the generalized forces J^T*(Lambda*xdd + bias) give the end effectors the accelerations xdd, without other forces
+
+        void computeCentroidalMomentum(const Eigen::VectorXd &_qdot); ///< compute the centroidal momentum matrix A_G and the bias dA_G*qdot, with h_G = A_G*qdot the [angular; linear] momentum about the center of mass in world coordinates and dh_G/dt = A_G*qdd + dA_G*qdot. One pass from the root to the leaves for the velocities and one back for the subtree inertias, without Jacobians or dense products; assumes the pose has already been set
+        const Eigen::MatrixXd& getCentroidalMomentumMatrix() const { return mCentroidalMomentumMatrix; } ///< A_G of the last computeCentroidalMomentum call
+        const Eigen::VectorXd& getCentroidalMomentumBias() const { return mCentroidalMomentumBias; } ///< dA_G*qdot
+        const Eigen::VectorXd& getCentroidalMomentum() const { return mCentroidalMomentum; } ///< h_G = A_G*qdot
+
+        void computeInverseDynamicsDerivatives(const Eigen::Vector3d &_gravity, const Eigen::VectorXd &_qdot, const Eigen::VectorXd &_qdotdot); ///< compute the partial derivatives dtau/dq and dtau/dqdot of the generalized forces tau = M*qdd + C*qdot + g of computeInverseDynamicsLinear, without external forces. The recursive algorithm is differentiated analytically: for each dof, one pass over the subtree it moves and one back over the subtree and the ancestors, instead of two full inverse dynamics evaluations per dof. Assumes the pose has already been set
+        void computeForwardDynamicsDerivatives(const Eigen::Vector3d &_gravity, const Eigen::VectorXd &_qdot, const Eigen::VectorXd &_tau); ///< compute the partial derivatives of the accelerations qdd of computeForwardDynamics without external forces: dqdd/dq = -M^{-1}*dtau/dq and dqdd/dqdot = -M^{-1}*dtau/dqdot at qdd, and dqdd/dtau = M^{-1}. M is recomputed and factorized at the current pose, which must already have been set
+        const Eigen::MatrixXd& getTorqueDerivPose() const { return mTorqueDerivPose; } ///< dtau/dq of the last computeInverseDynamicsDerivatives call
+        const Eigen::MatrixXd& getTorqueDerivVelocity() const { return mTorqueDerivVel; } ///< dtau/dqdot
+        const Eigen::MatrixXd& getAccelerationDerivPose() const { return mAccDerivPose; } ///< dqdd/dq of the last computeForwardDynamicsDerivatives call
+        const Eigen::MatrixXd& getAccelerationDerivVelocity() const { return mAccDerivVel; } ///< dqdd/dqdot
+        const Eigen::MatrixXd& getAccelerationDerivForce() const { return mAccDerivForce; } ///< dqdd/dtau = M^{-1}
+
+        void setPDGains(const Eigen::VectorXd &_kp, const Eigen::VectorXd &_kd); ///< set the diagonal stiffness and damping of joint-space PD servos that drive the dofs toward the PD target; the target defaults to the current pose
+        void setPDTarget(const Eigen::VectorXd &_q) { mPDTarget = _q; }
+        void clearPDGains(); ///< remove the PD servos
+        bool hasPDGains() const { return mKp.size() > 0; }
+        void computePDForces(double _dt); ///< evaluate the PD servo forces from the state of the last computeDynamics call. If _dt is zero, they are the explicit -Kp*(q-qd)-Kd*qdot; otherwise they are linearized backward Euler forces evaluated at the end of a step of _dt, found by solving (M + _dt*Kd + _dt^2*Kp)*qdd = tau with the stiffness and damping folded into the mass matrix. The implicit form keeps high gains stable at large time steps. Contact and constraint forces are not part of the linearization. The mass matrix is computed if it is not up to date
+        const Eigen::VectorXd& getPDForces() const { return mFpd; } ///< generalized forces of the PD servos from the last computePDForces call; they act in addition to the internal forces
 
         void evalExternalForces( bool _useRecursive ); ///< evaluate external forces to generalized torques; similarly to the inverse dynamics computation, when _useRecursive is true, a recursive algorithm is used; else the jacobian is used to do the conversion: tau = J^{T}F. Highly recommand to use this function after the respective (recursive or nonrecursive) dynamics computation because the necessary Jacobians will be ready. Extra care is needed to make sure the required quantities are up-to-date when using this function alone. 
         void clearExternalForces(); ///< clear all the contacts of external forces; automatically called after each (forward/inverse) dynamics computation, which marks the end of a cycle.
@@ -67,16 +106,21 @@ namespace dynamics{
         ///< It's particularly useful for exponential map because the system will become unstable if the exponential map rotaion is outside this range. For euler angles, the dof values can directly add or subtract 2*pi; for exponential map, once the rotation magnitude is changed, the velocity needs to change accordingly to represent the same angular velocity. This function requires the updated transformations. 
 
         Eigen::MatrixXd getMassMatrix() const { return mM; }
-        Eigen::MatrixXd getInvMassMatrix() const { return mMInv; }
+        Eigen::MatrixXd getInvMassMatrix() const { return mMInv; } ///< only up to date if computeDynamics/computeMassMatrix were asked for it; prefer solveMassMatrix
         Eigen::MatrixXd getCoriolisMatrix() const { return mC; }
         Eigen::VectorXd getCoriolisVector() const { return mCvec; }
         Eigen::VectorXd getGravityVector() const { return mG; }
-        Eigen::VectorXd getCombinedVector() const { return mCg; }
-        Eigen::VectorXd getExternalForces() const { return mFext; }
-        Eigen::VectorXd getInternalForces() const { return mFint; }
-        Eigen::VectorXd getPoseVelocity() const { return mQdot; }
+        const Eigen::VectorXd& getCombinedVector() const { return mCg; }
+        const Eigen::VectorXd& getExternalForces() const { return mFext; }
+        const Eigen::VectorXd& getInternalForces() const { return mFint; }
+        const Eigen::VectorXd& getPoseVelocity() const { return mQdot; }
+        bool getUseCRBA() const { return mUseCRBA; }
+        void setUseCRBA(bool _s) { mUseCRBA = _s; } ///< select how computeDynamics/computeMassMatrix assemble M: the composite rigid body algorithm (default) or the per-node J^T*M*J products
+        bool isMassMatrixUpdated() const { return mMassMatrixUpdated; } ///< true if M and its factorization correspond to the last computeDynamics call
         bool getImmobileState() const { return mImmobile; }
         void setImmobileState(bool _s) { mImmobile = _s; }
+        bool isAsleep() const { return mAsleep; }
+        void setAsleep(bool _s) { mAsleep = _s; } ///< a sleeping skeleton is held at rest: its dynamics are not updated and its bodies are not tested for collision against other resting bodies; set by World when the skeleton comes to rest and cleared when it is touched by an awake body or pushed by an external force
         bool getJointLimitState() const { return mJointLimit; }
         void setJointLimitState(bool _s) { mJointLimit = _s; }
         void setInternalForces(const Eigen::VectorXd& _forces);
@@ -84,10 +128,16 @@ namespace dynamics{
         Eigen::VectorXd getMinInternalForces() const { return mFintMin; }
         void setMaxInternalForces(Eigen::VectorXd _maxForces) { mFintMax = _maxForces; }
         Eigen::VectorXd getMaxInternalForces() const { return mFintMax; }
+        Eigen::VectorXd getPDStiffness() const { return mKp; }
+        Eigen::VectorXd getPDDamping() const { return mKd; }
+        Eigen::VectorXd getPDTarget() const { return mPDTarget; }
 
     protected:
         Eigen::MatrixXd mM;    ///< Mass matrix for the skeleton
         Eigen::MatrixXd mMInv;    ///< Inverse of mass matrix for the skeleton
+        Eigen::MatrixXd mMassFactor; ///< L in M = L^T*L; only the entries (i,j) with dof j an ancestor of dof i (or j == i) are meaningful
+        std::vector<int> mDofParents; ///< parent of each dof in the tree of dofs: the previous dof of the same joint, or the last dof of the closest ancestor joint; -1 for the first dof of the root
+        bool mMassFactorValid; ///< false if the last factorization hit a nonpositive pivot
         Eigen::MatrixXd mC;    ///< Coriolis matrix for the skeleton; not being used currently
         Eigen::VectorXd mCvec;    ///< Coriolis vector for the skeleton == mC*qdot
         Eigen::VectorXd mG;    ///< Gravity vector for the skeleton; computed in nonrecursive dynamics only
@@ -97,9 +147,31 @@ namespace dynamics{
         Eigen::VectorXd mFintMin; ///< minimum internal forces
         Eigen::VectorXd mFintMax; ///< maximum internal forces
         Eigen::VectorXd mQdot; ///< the current qdot
+        Eigen::VectorXd mKp; ///< diagonal stiffness of the PD servos; empty if there are none
+        Eigen::VectorXd mKd; ///< diagonal damping of the PD servos
+        Eigen::VectorXd mPDTarget; ///< pose the PD servos drive toward
+        Eigen::VectorXd mFpd; ///< PD servo forces computed by computePDForces
+        Eigen::MatrixXd mPDFactor; ///< L in M + dt*Kd + dt^2*Kp = L^T*L, with the sparsity of mMassFactor
+        Eigen::MatrixXd mTaskJ; ///< task Jacobian of the last computeTaskDynamics call
+        Eigen::MatrixXd mTaskY; ///< L^{-T}*J^T
+        Eigen::MatrixXd mTaskInvInertia; ///< J*M^{-1}*J^T
+        Eigen::MatrixXd mTaskInertia; ///< operational space inertia
+        Eigen::VectorXd mTaskBiasAcc; ///< Jdot*qdot
+        Eigen::VectorXd mTaskBiasForce; ///< task-space Coriolis and gravity force
+        Eigen::MatrixXd mCentroidalMomentumMatrix; ///< A_G of the last computeCentroidalMomentum call
+        Eigen::VectorXd mCentroidalMomentumBias; ///< dA_G*qdot
+        Eigen::VectorXd mCentroidalMomentum; ///< A_G*qdot
+        Eigen::MatrixXd mTorqueDerivPose; ///< dtau/dq of the last computeInverseDynamicsDerivatives call
+        Eigen::MatrixXd mTorqueDerivVel; ///< dtau/dqdot
+        Eigen::MatrixXd mAccDerivPose; ///< dqdd/dq of the last computeForwardDynamicsDerivatives call
+        Eigen::MatrixXd mAccDerivVel; ///< dqdd/dqdot
+        Eigen::MatrixXd mAccDerivForce; ///< dqdd/dtau
 
         bool mImmobile; ///< If the skeleton is immobile, its dynamic effect is equivalent to having infinite mass; if the DOFs of an immobile skeleton are manually changed, the collision results might not be correct
+        bool mAsleep; ///< True if the skeleton is held at rest; see setAsleep
         bool mJointLimit; ///<True if the joint limits are enforced in dynamic simulation
+        bool mUseCRBA; ///< True if the mass matrix is assembled by the composite rigid body algorithm instead of the per-node Jacobians
+        bool mMassMatrixUpdated; ///< true if mM and mMassFactor are consistent with the last computeDynamics call
 
     };
 
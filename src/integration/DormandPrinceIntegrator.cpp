@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2011, Georgia Tech Research Corporation
+ * All rights reserved.
+ *
+ * Author(s):
+ * Date:
+ *
+ * Geoorgia Tech Graphics Lab and Humanoid Robotics Lab
+ *
+ * Directed by Prof. C. Karen Liu and Prof. Mike Stilman
+ * <karenliu@cc.gatech.edu> <mstilman@cc.gatech.edu>
+ *
+ * This file is provided under the following "BSD-style" License:
+ *   Redistribution and use in source and binary forms, with or
+ *   without modification, are permitted provided that the following
+ *   conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *   CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *   INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *   MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ *   USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ *   AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *   LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ */
+
+#include "DormandPrinceIntegrator.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace Eigen;
+
+namespace integration {
+    void DormandPrinceIntegrator::integrate(IntegrableSystem* system, double dt) const {
+        step(system, dt);
+    }
+
+    double DormandPrinceIntegrator::step(IntegrableSystem* system, double dt) const {
+        // stages, with the derivatives k1..k7 unscaled by dt
+        system->getState(x0);
+        system->evalDeriv(k1);
+
+        x = x0 + dt * (1.0/5.0) * k1;
+        system->setState(x);
+        system->evalDeriv(k2);
+
+        x = x0 + dt * ((3.0/40.0) * k1 + (9.0/40.0) * k2);
+        system->setState(x);
+        system->evalDeriv(k3);
+
+        x = x0 + dt * ((44.0/45.0) * k1 - (56.0/15.0) * k2 + (32.0/9.0) * k3);
+        system->setState(x);
+        system->evalDeriv(k4);
+
+        x = x0 + dt * ((19372.0/6561.0) * k1 - (25360.0/2187.0) * k2
+                       + (64448.0/6561.0) * k3 - (212.0/729.0) * k4);
+        system->setState(x);
+        system->evalDeriv(k5);
+
+        x = x0 + dt * ((9017.0/3168.0) * k1 - (355.0/33.0) * k2 + (46732.0/5247.0) * k3
+                       + (49.0/176.0) * k4 - (5103.0/18656.0) * k5);
+        system->setState(x);
+        system->evalDeriv(k6);
+
+        // fifth order solution
+        x = x0 + dt * ((35.0/384.0) * k1 + (500.0/1113.0) * k3 + (125.0/192.0) * k4
+                       - (2187.0/6784.0) * k5 + (11.0/84.0) * k6);
+        system->setState(x);
+        system->evalDeriv(k7);
+
+        // difference to the fourth order solution
+        err = dt * ((71.0/57600.0) * k1 - (71.0/16695.0) * k3 + (71.0/1920.0) * k4
+                    - (17253.0/339200.0) * k5 + (22.0/525.0) * k6 - (1.0/40.0) * k7);
+
+        double sum = 0.0;
+        for (int i = 0; i < err.size(); i++) {
+            double scale = mAbsTolerance + mRelTolerance * std::max(std::abs(x0[i]), std::abs(x[i]));
+            sum += (err[i] / scale) * (err[i] / scale);
+        }
+        return err.size() > 0 ? std::sqrt(sum / err.size()) : 0.0;
+    }
+} // namespace integration
@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2011, Georgia Tech Research Corporation
+ * All rights reserved.
+ *
+ * Author(s):
+ * Date:
+ *
+ * Geoorgia Tech Graphics Lab and Humanoid Robotics Lab
+ *
+ * Directed by Prof. C. Karen Liu and Prof. Mike Stilman
+ * <karenliu@cc.gatech.edu> <mstilman@cc.gatech.edu>
+ *
+ * This file is provided under the following "BSD-style" License:
+ *   Redistribution and use in source and binary forms, with or
+ *   without modification, are permitted provided that the following
+ *   conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *   CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *   INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *   MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ *   USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ *   AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *   LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ */
+
+#ifndef DORMAND_PRINCE_INTEGRATOR_H
+#define DORMAND_PRINCE_INTEGRATOR_H
+
+#include <Eigen/Dense>
+#include "Integrator.h"
+
+namespace integration {
+    // Dormand-Prince 5(4) pair: a fifth order step with an embedded fourth
+    // order solution, whose difference estimates the local error so that the
+    // caller can adapt the step size. Takes seven derivative evaluations per
+    // step; the last one, at the new state, is not reused by the next step
+    // because the system may be changed in between (e.g. new control forces)
+    class DormandPrinceIntegrator : public Integrator {
+    public:
+        DormandPrinceIntegrator() : mAbsTolerance(1e-6), mRelTolerance(1e-6) {}
+        ~DormandPrinceIntegrator(){}
+        void integrate(IntegrableSystem* system, double dt) const;
+
+        // Advances the system by dt and returns the RMS norm of the local
+        // error scaled by the tolerances: the step is accurate enough if it
+        // is not larger than one. Otherwise call reject to go back
+        double step(IntegrableSystem* system, double dt) const;
+        // Restores the state from before the last step
+        void reject(IntegrableSystem* system) const { system->setState(x0); }
+
+        void setTolerance(double _abs, double _rel) { mAbsTolerance = _abs; mRelTolerance = _rel; }
+        double getAbsTolerance() const { return mAbsTolerance; }
+        double getRelTolerance() const { return mRelTolerance; }
+    private:
+        double mAbsTolerance;
+        double mRelTolerance;
+        mutable Eigen::VectorXd k1, k2, k3, k4, k5, k6, k7;
+        mutable Eigen::VectorXd x0, x, err; // workspace kept between steps
+    };
+} // namespace integration
+
+#endif // DORMAND_PRINCE_INTEGRATOR_H
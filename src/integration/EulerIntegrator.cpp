@@ -41,8 +41,10 @@ using namespace Eigen;
 
 namespace integration {
     void EulerIntegrator::integrate(IntegrableSystem* system, double dt) const {
-        VectorXd deriv = system->evalDeriv();
-        system->setState(system->getState() + (dt * deriv));
+        system->evalDeriv(mDeriv);
+        system->getState(mState);
+        mState += dt * mDeriv;
+        system->setState(mState);
 //        system->setState(x + (dt * system->evalDeriv()));
     }
 } // namespace integration
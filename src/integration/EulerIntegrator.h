@@ -47,6 +47,8 @@ namespace integration {
         EulerIntegrator(){}
         ~EulerIntegrator(){}
         void integrate(IntegrableSystem* system, double dt) const;
+    private:
+        mutable Eigen::VectorXd mState, mDeriv; // workspace kept between steps
     };
 } // namespace integration
 
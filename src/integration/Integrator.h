@@ -48,6 +48,14 @@ namespace integration {
         virtual Eigen::VectorXd getState() = 0;
         virtual void setState(const Eigen::VectorXd& _state) = 0;
         virtual Eigen::VectorXd evalDeriv() = 0;
+
+        // Variants that write into a vector owned by the caller, which the
+        // integrators keep between steps; an implementation that does not
+        // resize _state or _deriv when they already have the right size
+        // makes steady-state integration free of heap allocations. The
+        // defaults forward to the versions above
+        virtual void getState(Eigen::VectorXd& _state) { _state = getState(); }
+        virtual void evalDeriv(Eigen::VectorXd& _deriv) { _deriv = evalDeriv(); }
     };
 
     // TODO (kasiu) Consider templating the class (which currently only works on arbitrarily-sized vectors of doubles)
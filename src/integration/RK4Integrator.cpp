@@ -40,25 +40,28 @@
 using namespace Eigen;
 
 namespace integration {
-    // TODO (kasiu): Slow. Needs to be optimized.
     void RK4Integrator::integrate(IntegrableSystem* system, double dt) const {
-        // calculates the four weighted deltas
-        VectorXd deriv = system->evalDeriv();
-        VectorXd x = system->getState();
-        k1 = deriv * dt;
+        // calculates the four weighted deltas in place
+        system->evalDeriv(k1);
+        system->getState(x);
+        k1 *= dt;
 
-        system->setState(x + (k1 * 0.5));
-        deriv = system->evalDeriv();
-        k2 = deriv * dt;
+        xStage = x + (k1 * 0.5);
+        system->setState(xStage);
+        system->evalDeriv(k2);
+        k2 *= dt;
 
-        system->setState(x + (k2 * 0.5));
-        deriv = system->evalDeriv();
-        k3 = deriv * dt;
+        xStage = x + (k2 * 0.5);
+        system->setState(xStage);
+        system->evalDeriv(k3);
+        k3 *= dt;
 
-        system->setState(x + k3);
-        deriv = system->evalDeriv();
-        k4 = deriv * dt;
+        xStage = x + k3;
+        system->setState(xStage);
+        system->evalDeriv(k4);
+        k4 *= dt;
 
-        system->setState(x + ((1.0/6.0) * (k1 + (2.0 * k2) + (2.0 * k3) + k4)));
+        xStage = x + ((1.0/6.0) * (k1 + (2.0 * k2) + (2.0 * k3) + k4));
+        system->setState(xStage);
     }
 } // namespace integration
@@ -49,6 +49,7 @@ namespace integration {
         void integrate(IntegrableSystem* system, double dt) const;
     private:
         mutable Eigen::VectorXd k1, k2, k3, k4;
+        mutable Eigen::VectorXd x, xStage; // workspace kept between steps
     };
 } // namespace integration
 
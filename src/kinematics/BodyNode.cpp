@@ -66,7 +66,12 @@ namespace kinematics {
           mMass(0),
           mCOMLocal(0,0,0),
           mSkel(NULL),
-          mI(Matrix3d::Zero())
+          mI(Matrix3d::Zero()),
+          mTransformDirty(true),
+          mDerivDirty(true),
+          mJacDirty(true),
+          mNumTransformUpdates(0),
+          mNumDerivUpdates(0)
     {
         mJointsChild.clear();
         mMarkers.clear();
@@ -122,6 +127,7 @@ namespace kinematics {
         
         mJv = MatrixXd::Zero(3, numDepDofs);
         mJw = MatrixXd::Zero(3, numDepDofs);
+        setDirty();
 
         mNumRootTrans = 0;
         for(int i=0; i<mSkel->getNumDofs(); i++){
@@ -143,6 +149,14 @@ namespace kinematics {
         // update the inertia matrix 
         Matrix3d R = mW.topLeftCorner<3,3>();
         mIc.noalias() = R*mI*R.transpose();
+
+        // the world transforms of the subtree depend on this one
+        mTransformDirty = false;
+        mDerivDirty = true;
+        mJacDirty = true;
+        for (unsigned int i = 0; i < mJointsChild.size(); i++)
+            mJointsChild[i]->getChildNode()->mTransformDirty = true;
+        mNumTransformUpdates++;
     }
 
     void BodyNode::updateFirstDerivatives() {
@@ -173,6 +187,26 @@ namespace kinematics {
 
         evalJacLin();
         evalJacAng();
+
+        mDerivDirty = false;
+        mJacDirty = false;
+        mNumDerivUpdates++;
+    }
+
+    void BodyNode::updateFirstDerivativesIfDirty() {
+        if (mNodeParent)
+            mNodeParent->updateFirstDerivativesIfDirty();
+        if (mTransformDirty)
+            updateTransform();
+        if (mDerivDirty)
+            updateFirstDerivatives();
+    }
+
+    bool BodyNode::isChainTransformDirty() const {
+        for (const BodyNode* node = this; node; node = node->mNodeParent)
+            if (node->mTransformDirty)
+                return true;
+        return false;
     }
 
     void BodyNode::evalJacLin() {
@@ -303,19 +337,29 @@ namespace kinematics {
         return mJointParent->isPresent(_q);
     }
 
-    Matrix4d BodyNode::getDerivLocalTransform(int index) const {
+    Matrix4d BodyNode::getDerivLocalTransform(int index) {
+        updateFirstDerivativesIfDirty();
         return mTq[index];
     }
     
-    Matrix4d BodyNode::getDerivWorldTransform(int index) const {
+    Matrix4d BodyNode::getDerivWorldTransform(int index) {
+        updateFirstDerivativesIfDirty();
         return mWq[index];
     }
     
-    MatrixXd BodyNode::getJacobianLinear() const {
+    MatrixXd BodyNode::getJacobianLinear() {
+        // a dof that changed above this node without a transform update
+        // leaves mJacDirty of this node untouched
+        if (mJacDirty || isChainTransformDirty())
+            updateFirstDerivativesIfDirty();
         return mJv;
     }
     
-    MatrixXd BodyNode::getJacobianAngular() const {
+    MatrixXd BodyNode::getJacobianAngular() {
+        // a dof that changed above this node without a transform update
+        // leaves mJacDirty of this node untouched
+        if (mJacDirty || isChainTransformDirty())
+            updateFirstDerivativesIfDirty();
         return mJw;
     }
     
@@ -104,8 +104,17 @@ namespace kinematics {
         virtual ~BodyNode(); ///< Default destructor
 
         void init(); ///< Initialize the vector memebers with proper sizes
-        void updateTransform(); ///< Update transformations w.r.t. the current dof values in Dof*
+        void updateTransform(); ///< Update transformations w.r.t. the current dof values in Dof*; marks the derivatives of this node and the transformations of the child nodes out of date
         void updateFirstDerivatives();  ///< Update the first derivatives of the transformations 
+        void updateFirstDerivativesIfDirty(); ///< Update the first derivatives, and the transformations they depend on, only if they are out of date; the ancestors are brought up to date first
+
+        inline void setDirty() { mTransformDirty = true; mDerivDirty = true; mJacDirty = true; } ///< Mark the transformation and its derivatives out of date; called when a local dof changes
+        inline bool isTransformDirty() const { return mTransformDirty; }
+        inline bool isDerivDirty() const { return mDerivDirty; }
+        bool isChainTransformDirty() const; ///< True if the transformation of this node or of one of its ancestors is out of date, as after Skeleton::setPose without bCalcTrans
+        inline int getNumTransformUpdates() const { return mNumTransformUpdates; } ///< Number of updateTransform calls since the last resetUpdateCounters
+        inline int getNumDerivUpdates() const { return mNumDerivUpdates; } ///< Number of updateFirstDerivatives calls since the last resetUpdateCounters
+        inline void resetUpdateCounters() { mNumTransformUpdates = 0; mNumDerivUpdates = 0; }
         void evalJacLin(); ///< Evaluate linear Jacobian of this body node (num cols == num dependent dofs)
         void evalJacAng(); ///< Evaluate angular Jacobian of this body node (num cols == num dependent dofs)
 
@@ -189,10 +198,11 @@ namespace kinematics {
         Dof* getDof(int _idx) const;
         bool isPresent(Dof *_q);
 
-        Eigen::Matrix4d getDerivLocalTransform(int _index) const;
-        Eigen::Matrix4d getDerivWorldTransform(int _index) const;
-        Eigen::MatrixXd getJacobianLinear() const;
-        Eigen::MatrixXd getJacobianAngular() const;
+        // the derivatives are evaluated on demand if the pose has changed
+        Eigen::Matrix4d getDerivLocalTransform(int _index);
+        Eigen::Matrix4d getDerivWorldTransform(int _index);
+        Eigen::MatrixXd getJacobianLinear();
+        Eigen::MatrixXd getJacobianAngular();
         
         inline bool getCollideState() const { return mCollidable; }
         inline void setCollideState(bool _c) { mCollidable = _c; }
@@ -229,6 +239,13 @@ namespace kinematics {
         Eigen::MatrixXd mJv; ///< Linear Jacobian; Cartesian_linear_velocity of the COM = mJv * generalized_velocity
         Eigen::MatrixXd mJw; ///< Angular Jacobian; Cartesian_angular_velocity = mJw * generalized_velocity
 
+        // lazy evaluation
+        bool mTransformDirty; ///< True if mT and mW do not reflect the current dof values
+        bool mDerivDirty; ///< True if mTq and mWq are out of date
+        bool mJacDirty; ///< True if mJv and mJw are out of date; cleared separately when the Jacobians are computed recursively
+        int mNumTransformUpdates; ///< Counts updateTransform calls
+        int mNumDerivUpdates; ///< Counts updateFirstDerivatives calls
+
 
     private:
         int mID; ///< A unique ID of this node globally 
@@ -37,6 +37,8 @@
 
 #include "Dof.h"
 #include "Transformation.h"
+#include "Joint.h"
+#include "BodyNode.h"
 
 double inf = 1e9;
 
@@ -64,6 +66,7 @@ namespace kinematics {
     void Dof::setValue(double _v){
         mVal = _v; 
         if (mTrans != NULL) mTrans->setDirty();
+        if (mJoint != NULL && mJoint->getChildNode() != NULL) mJoint->getChildNode()->setDirty();
     }
 
     void Dof::init(double _v, const char * _name, double _min, double _max){
@@ -42,7 +42,6 @@
 #include "TrfmRotateAxis.h"
 #include "BodyNode.h"
 #include <iostream>
-#include <map>
 using namespace Eigen;
 using namespace std;
 
@@ -116,6 +115,16 @@ namespace kinematics {
         }
     }
 
+    // index of the axis of an euler rotation: x=0, y=1, z=2; called for every joint in each dynamics pass, hence no lookup table
+    static inline int getRotAxisIndex(Transformation::TransFormType _type){
+        switch(_type){
+        case Transformation::T_ROTATEX: return 0;
+        case Transformation::T_ROTATEY: return 1;
+        case Transformation::T_ROTATEZ: return 2;
+        default: return 0;
+        }
+    }
+
     void Joint::computeRotationJac(MatrixXd *_J, MatrixXd *_Jdot, const VectorXd *_qdot){
         assert(_J);
         assert(mType!=J_UNKNOWN);
@@ -126,10 +135,6 @@ namespace kinematics {
             _Jdot->setZero();
         }
 
-        map<Transformation::TransFormType, int> rotEulerMap;
-        rotEulerMap[Transformation::T_ROTATEX]=0;
-        rotEulerMap[Transformation::T_ROTATEY]=1;
-        rotEulerMap[Transformation::T_ROTATEZ]=2;
 
         if(mType==J_HINGE){
             assert(mNumDofsRot==1);
@@ -137,7 +142,7 @@ namespace kinematics {
             if(TrfmRotateAxis* rotateAxisTransform = dynamic_cast<TrfmRotateAxis*>(mTransforms[mRotTransformIndex[0]]))
                 _J->topLeftCorner<3, 1>() = rotateAxisTransform->getAxis();
             else 
-                (*_J)(rotEulerMap[mTransforms[mRotTransformIndex[0]]->getType()], 0) = 1.0;
+                (*_J)(getRotAxisIndex(mTransforms[mRotTransformIndex[0]]->getType()), 0) = 1.0;
             // _Jdot is zero
         }
         else if(mType==J_UNIVERSAL){
@@ -146,9 +151,9 @@ namespace kinematics {
 
             Matrix4d R0 = mTransforms[mRotTransformIndex[0]]->getTransform();
             // first col
-            (*_J)(rotEulerMap[mTransforms[mRotTransformIndex[0]]->getType()], 0) = 1.0;
+            (*_J)(getRotAxisIndex(mTransforms[mRotTransformIndex[0]]->getType()), 0) = 1.0;
             // second col
-            for(int r=0; r<3; r++) (*_J)(r, 1) = R0(r, rotEulerMap[mTransforms[mRotTransformIndex[1]]->getType()]);
+            for(int r=0; r<3; r++) (*_J)(r, 1) = R0(r, getRotAxisIndex(mTransforms[mRotTransformIndex[1]]->getType()));
             if(_Jdot){
                 // first col is zero
                 // second col w_0 x(R_0*e_1), (w_0 = e_0*qd_0) == qd_0 * J_0 x J_1
@@ -166,12 +171,12 @@ namespace kinematics {
             Matrix4d R0 = mTransforms[mRotTransformIndex[0]]->getTransform();
             Matrix4d R1 = mTransforms[mRotTransformIndex[1]]->getTransform();
             // first col
-            (*_J)(rotEulerMap[mTransforms[mRotTransformIndex[0]]->getType()], 0) = 1.0;
+            (*_J)(getRotAxisIndex(mTransforms[mRotTransformIndex[0]]->getType()), 0) = 1.0;
             // second col
-            for(int r=0; r<3; r++) (*_J)(r, 1) = R0(r, rotEulerMap[mTransforms[mRotTransformIndex[1]]->getType()]);
+            for(int r=0; r<3; r++) (*_J)(r, 1) = R0(r, getRotAxisIndex(mTransforms[mRotTransformIndex[1]]->getType()));
             // third col
-            VectorXd R1e2 = R1.col(rotEulerMap[mTransforms[mRotTransformIndex[2]]->getType()]);
-            VectorXd J_2 = R0*R1e2;
+            Vector4d R1e2 = R1.col(getRotAxisIndex(mTransforms[mRotTransformIndex[2]]->getType()));
+            Vector4d J_2 = R0*R1e2;
             for(int r=0; r<3; r++) (*_J)(r, 2) = J_2[r];
             if(_Jdot){
                 // first col is zero
@@ -203,8 +208,60 @@ namespace kinematics {
         }
 
         // adjust for the static rotation transformations: ASSUME that they are only positioned before variable transforms
-        (*_J) = mStaticTransform.topLeftCorner<3,3>() * (*_J);
-        if(_Jdot) (*_Jdot) = mStaticTransform.topLeftCorner<3,3>() * (*_Jdot);
+        // the products go through a temporary with at most three columns, which lives on the stack
+        Matrix<double, 3, Dynamic, 0, 3, 3> rotated(3, mNumDofsRot);
+        rotated.noalias() = mStaticTransform.topLeftCorner<3,3>() * (*_J);
+        (*_J) = rotated;
+        if(_Jdot) {
+            rotated.noalias() = mStaticTransform.topLeftCorner<3,3>() * (*_Jdot);
+            (*_Jdot) = rotated;
+        }
+    }
+
+    void Joint::computeRotationJacDeriv(int _i, const VectorXd &_qdot, MatrixXd *_dJ, MatrixXd *_dJdot){
+        assert(_dJ && _dJdot);
+        assert(mType!=J_UNKNOWN);
+        assert(_i>=0 && _i<mNumDofsRot);
+        _dJ->setZero(3, mNumDofsRot);
+        _dJdot->setZero(3, mNumDofsRot);
+
+        if(mType==J_HINGE || mType==J_UNIVERSAL || mType==J_BALLEULER || mType==J_FREEEULER){
+            // the columns are the rotated axes J_j = R_0*...*R_{j-1}*e_j, so dJ_j/dq_i = J_i x J_j for i<j
+            // and zero otherwise; Jdot_j = w_j x J_j with w_j = sum_{k<j} J_k*qd_k
+            MatrixXd J;
+            computeRotationJac(&J, NULL, NULL);
+            Vector3d J_i = J.col(_i);
+            for(int j=_i+1; j<mNumDofsRot; j++){
+                Vector3d J_j = J.col(j);
+                Vector3d dJ_j = J_i.cross(J_j);
+                Vector3d w_j = Vector3d::Zero();
+                Vector3d dw_j = Vector3d::Zero();
+                for(int k=0; k<j; k++){
+                    w_j += J.col(k)*_qdot[k];
+                    if(k>_i) dw_j += J_i.cross(Vector3d(J.col(k)))*_qdot[k];
+                }
+                _dJ->col(j) = dJ_j;
+                _dJdot->col(j) = dw_j.cross(J_j) + w_j.cross(dJ_j);
+            }
+            // J already includes the static rotation
+            return;
+        }
+        else if(mType==J_BALLEXPMAP || mType==J_FREEEXPMAP){
+            assert(mNumDofsRot==3);
+            assert(mRotTransformIndex.size()==1);
+            Transformation *em = mTransforms[mRotTransformIndex[0]];
+            Vector3d q(em->getDof(0)->getValue(), em->getDof(1)->getValue(), em->getDof(2)->getValue());
+            Vector3d qdot(_qdot[0], _qdot[1], _qdot[2]);
+            *_dJ = math::expMapJacDeriv(q, _i);
+            *_dJdot = math::expMapJacDotDeriv(q, qdot, _i);
+        }
+        else {
+            cout<<"computeRotationJacDeriv not implemented yet for this joint type\n";
+        }
+
+        // adjust for the static rotation transformations
+        (*_dJ) = mStaticTransform.topLeftCorner<3,3>() * (*_dJ);
+        (*_dJdot) = mStaticTransform.topLeftCorner<3,3>() * (*_dJdot);
     }
 
     math::RotationOrder Joint::getEulerOrder(){
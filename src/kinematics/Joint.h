@@ -77,6 +77,7 @@ namespace kinematics {
         void applyTransform(Eigen::Matrix4d& _m); ///< apply the local transformation to a matrix _m
 
         void computeRotationJac(Eigen::MatrixXd *_J, Eigen::MatrixXd *_Jdot, const Eigen::VectorXd *_qdot);   ///< compute the relative angular velocity jacobian i.e. w_rel = J*\dot{q_local}
+        void computeRotationJacDeriv(int _i, const Eigen::VectorXd &_qdot, Eigen::MatrixXd *_dJ, Eigen::MatrixXd *_dJdot);   ///< compute the derivatives of the rotation jacobian J and of its time derivative Jdot for the local rotation velocities _qdot wrt the _i th rotation dof
         math::RotationOrder getEulerOrder(); ///< Rotation order for the euler rotation if hinge, universal or ball euler joint
         Eigen::Vector3d getAxis(unsigned int _i);    ///< returns the i th axis of rotation accordingly when R = R2*R1*R0 (i \in {0,1,2})
 	
@@ -108,6 +108,10 @@ public:
     /// @brief
     inline ShapeType getShapeType() const { return mType; }
 
+    /// @brief Copy of this shape, e.g. for a cloned skeleton. Large
+    /// geometric data such as meshes are shared, not copied.
+    virtual Shape* clone() const { return new Shape(*this); }
+
     /// @brief
     virtual void draw(renderer::RenderInterface* _ri = NULL,
                       const Eigen::Vector4d& _color = Eigen::Vector4d::Ones(),
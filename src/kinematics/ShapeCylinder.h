@@ -61,6 +61,9 @@ public:
     /// @brief
     inline void setHeight(double _height) { mHeight = _height; }
 
+    // Documentation inherited.
+    virtual Shape* clone() const { return new ShapeCylinder(*this); }
+
     // Documentation inherited.
     void draw(renderer::RenderInterface* _ri = NULL,
               const Eigen::Vector4d& _color = Eigen::Vector4d::Ones(),
@@ -47,6 +47,9 @@ public:
     /// @brief Constructor.
     ShapeEllipsoid(Eigen::Vector3d _dim);
 
+    // Documentation inherited.
+    virtual Shape* clone() const { return new ShapeEllipsoid(*this); }
+
     // Documentation inherited.
     void draw(renderer::RenderInterface* _ri = NULL,
               const Eigen::Vector4d& _col = Eigen::Vector4d::Ones(),
@@ -59,6 +59,9 @@ namespace kinematics {
         /// @brief
         inline void setDisplayList(int _index) { mDisplayList = _index; }
 
+        // Documentation inherited.
+        virtual Shape* clone() const { return new ShapeMesh(*this); }
+
         // Documentation inherited.
         void draw(renderer::RenderInterface* _ri = NULL,
                   const Eigen::Vector4d& _col = Eigen::Vector4d::Ones(),
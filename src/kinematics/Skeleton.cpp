@@ -46,6 +46,7 @@ using namespace Eigen;
 #include "BodyNode.h"
 #include "Marker.h"
 #include "Transformation.h"
+#include "Shape.h"
 #include "math/UtilsMath.h"
 
 #include "renderer/RenderInterface.h"
@@ -68,6 +69,65 @@ namespace kinematics {
         mMarkers.clear();
     }
 
+    Skeleton* Skeleton::clone() const {
+        Skeleton* skel = new Skeleton();
+        cloneStructure(skel);
+        return skel;
+    }
+
+    void Skeleton::cloneStructure(Skeleton* _skel) const {
+        _skel->setName(mName);
+        _skel->setSelfCollidable(mSelfCollidable);
+
+        // nodes in the same order, created by _skel so that they have its
+        // body node type
+        for(unsigned int i = 0; i < mNodes.size(); i++) {
+            BodyNode* node = mNodes[i];
+            BodyNode* copy = _skel->createBodyNode(node->getName());
+            copy->setMass(node->getMass());
+            copy->setLocalCOM(node->getLocalCOM());
+            copy->setLocalInertia(node->getLocalInertia());
+            copy->setCollideState(node->getCollideState());
+            Shape* vizShape = node->getVisualizationShape();
+            Shape* colShape = node->getCollisionShape();
+            if(vizShape) copy->setVisualizationShape(vizShape->clone());
+            if(colShape) copy->setCollisionShape(colShape == vizShape ? copy->getVisualizationShape() : colShape->clone());
+            _skel->addNode(copy, false);
+        }
+
+        // joints link the copies of the same nodes; the dofs of the variable
+        // transformations are added to the joints in the same order
+        for(unsigned int i = 0; i < mJoints.size(); i++) {
+            Joint* joint = mJoints[i];
+            BodyNode* parent = joint->getParentNode() ? _skel->getNode(joint->getParentNode()->getSkelIndex()) : NULL;
+            BodyNode* child = joint->getChildNode() ? _skel->getNode(joint->getChildNode()->getSkelIndex()) : NULL;
+            Joint* copy = new Joint(parent, child, joint->getName());
+            for(int j = 0; j < joint->getNumTransforms(); j++) {
+                Transformation* t = joint->getTransform(j);
+                copy->addTransform(t->clone(), t->getVariable());
+            }
+            _skel->addJoint(copy);
+        }
+
+        // the model transformations, and hence the dofs, in the same order
+        for(unsigned int i = 0; i < mTransforms.size(); i++) {
+            Joint* joint = mTransforms[i]->getJoint();
+            int j = 0;
+            while(joint->getTransform(j) != mTransforms[i]) j++;
+            _skel->addTransform(_skel->getJoint(joint->getSkelIndex())->getTransform(j));
+        }
+
+        for(unsigned int i = 0; i < mMarkers.size(); i++) {
+            Marker* marker = mMarkers[i];
+            Vector3d offset = marker->getLocalCoords();
+            _skel->addMarker(new Marker(marker->getName(), offset,
+                                        _skel->getNode(marker->getNode()->getSkelIndex()),
+                                        marker->getConstraintType()));
+        }
+
+        _skel->initSkel();
+    }
+
     BodyNode* Skeleton::createBodyNode(const char* const _name) {
         return new BodyNode(_name);
     }
@@ -188,20 +248,13 @@ namespace kinematics {
     void Skeleton::setPose(const VectorXd& state, bool bCalcTrans, bool bCalcDeriv) {
         mCurrPose = state;
         for (int i = 0; i < getNumDofs(); i++) {
-            mDofs.at(i)->setValue(state[i]);
-        }
-
-        if (bCalcTrans) {
-            for (int i = 0; i < getNumNodes(); i++) {
-                mNodes.at(i)->updateTransform();
-            }
+            // unchanged dofs leave their nodes clean
+            if (mDofs[i]->getValue() != state[i])
+                mDofs[i]->setValue(state[i]);
         }
 
-        if (bCalcDeriv) {
-            for (int i = 0; i < getNumNodes(); i++) {
-                mNodes.at(i)->updateFirstDerivatives();
-            }
-        }
+        if (bCalcTrans)
+            updateTransforms();
     }
 
     Eigen::VectorXd Skeleton::getPose() {
@@ -225,22 +278,42 @@ namespace kinematics {
     void Skeleton::setConfig(std::vector<int> _id, Eigen::VectorXd _vals, bool _calcTrans, bool _calcDeriv) {
         for( unsigned int i = 0; i < _id.size(); i++ ) {
             mCurrPose[_id[i]] = _vals(i);
-            mDofs[_id[i]]->setValue(_vals(i));
-        }
-        
-        // TODO: Only do the necessary updates
-        if (_calcTrans) {
-            for (int i = 0; i < getNumNodes(); i++) {
-                mNodes.at(i)->updateTransform();
-            }
+            if (mDofs[_id[i]]->getValue() != _vals(i))
+                mDofs[_id[i]]->setValue(_vals(i));
         }
 
-        if (_calcDeriv) {
-            for (int i = 0; i < getNumNodes(); i++) {
-                mNodes.at(i)->updateFirstDerivatives();
-            }
+        if (_calcTrans)
+            updateTransforms();
+    }
+
+    void Skeleton::updateTransforms() {
+        // parents come before their children, and updating a node marks the
+        // transforms of its children out of date, so one sweep covers the
+        // subtrees below the changed dofs
+        for (int i = 0; i < getNumNodes(); i++) {
+            if (mNodes[i]->isTransformDirty())
+                mNodes[i]->updateTransform();
         }
-  }
+    }
+
+    int Skeleton::getNumTransformUpdates() const {
+        int count = 0;
+        for (int i = 0; i < getNumNodes(); i++)
+            count += mNodes[i]->getNumTransformUpdates();
+        return count;
+    }
+
+    int Skeleton::getNumDerivUpdates() const {
+        int count = 0;
+        for (int i = 0; i < getNumNodes(); i++)
+            count += mNodes[i]->getNumDerivUpdates();
+        return count;
+    }
+
+    void Skeleton::resetUpdateCounters() {
+        for (int i = 0; i < getNumNodes(); i++)
+            mNodes[i]->resetUpdateCounters();
+    }
   
     MatrixXd Skeleton::getJacobian(BodyNode* _bd, Vector3d& _localOffset) {
         MatrixXd J(3, mDofs.size());
@@ -60,6 +60,12 @@ namespace kinematics {
         Skeleton();
         virtual ~Skeleton();
 
+        // Deep copy for evaluation in another thread: the nodes, joints,
+        // transformations, dofs and markers are duplicated with the current
+        // pose, while the shapes are copied sharing their mesh data. The
+        // clone does not depend on this skeleton afterwards
+        virtual Skeleton* clone() const;
+
         virtual BodyNode* createBodyNode(const char* const name = NULL);
         void addMarker(Marker *_h);
         void addNode(BodyNode *_b, bool _addParentJoint = true);
@@ -90,9 +96,20 @@ namespace kinematics {
         inline std::string getName() { return mName; }
         inline void setName( std::string _name ) { mName = _name; }
         Eigen::VectorXd getPose();
+        // Forward kinematics is incremental: only the nodes below the dofs
+        // that changed are updated, and the first derivatives are evaluated
+        // on demand by BodyNode::getJacobianLinear etc. bCalcDeriv is
+        // ignored and only kept for source compatibility. Without
+        // bCalcTrans, the world transforms stay out of date until
+        // updateTransforms, but the derivative and Jacobian getters of
+        // BodyNode still bring them up to date first
         virtual void setPose(const Eigen::VectorXd&, bool bCalcTrans = true, bool bCalcDeriv = true);
         Eigen::VectorXd getConfig(std::vector<int> _id);
-        void setConfig(std::vector<int> _id, Eigen::VectorXd _vals, bool _calcTrans = true, bool _calcDeriv = true);
+        void setConfig(std::vector<int> _id, Eigen::VectorXd _vals, bool _calcTrans = true, bool _calcDeriv = true); ///< same as setPose for the dofs _id; _calcDeriv is ignored
+        void updateTransforms(); ///< Update the transformations of the nodes that are out of date
+        int getNumTransformUpdates() const; ///< Number of node transformation updates since the last resetUpdateCounters
+        int getNumDerivUpdates() const; ///< Number of node first derivative updates since the last resetUpdateCounters
+        void resetUpdateCounters();
         Eigen::MatrixXd getJacobian(BodyNode* _bd, Eigen::Vector3d& _localOffset);
 
         void draw(renderer::RenderInterface* _ri = NULL, const Eigen::Vector4d& _color=Eigen::Vector4d::Ones(), bool _useDefaultColor = true) const;
@@ -102,6 +119,8 @@ namespace kinematics {
         bool getSelfCollidable() const { return mSelfCollidable; }
 
     protected:
+        void cloneStructure(Skeleton* _skel) const; ///< Build a copy of the model in the empty skeleton _skel and initialize it with initSkel
+
         std::string mName;
         std::vector<Marker*> mMarkers;
         std::vector<Dof*> mDofs;
@@ -65,6 +65,11 @@ namespace kinematics {
         mDofs.clear();
     }
 
+    Dof* Transformation::cloneDof(int _i) const {
+        Dof *q = mDofs[_i];
+        return new Dof(q->getValue(), q->getName(), q->getMin(), q->getMax());
+    }
+
     Matrix4d Transformation::getTransform() {
         if ( mDirty ) {
             computeTransform();
@@ -113,8 +113,11 @@ namespace kinematics {
         virtual void computeTransform() = 0;	// computes and stores in above
         virtual Eigen::Matrix4d getDeriv(const Dof *_q) = 0;	// get derivative wrt to a dof
         virtual Eigen::Matrix4d getSecondDeriv(const Dof *_q1, const Dof *_q2) = 0;	// get derivative wrt to 2 dofs present in a transformation
+        virtual Transformation* clone() const = 0;	// copy with new dofs of the same names, values and limits; not attached to a joint or a model
 
     protected:
+        Dof* cloneDof(int _i) const;	// new dof with the name, value and limits of dof _i
+
         std::vector<Dof *> mDofs;	// collection of Dofs
         TransFormType mType;
         int mSkelIndex;	// position in the model transform vector
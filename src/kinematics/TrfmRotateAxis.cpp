@@ -110,4 +110,8 @@ namespace kinematics {
         return ((Affine3d)AngleAxis<double>(-mDofs[0]->getValue(), mAxis)).matrix();
     }
 
+    Transformation* TrfmRotateAxis::clone() const {
+        return new TrfmRotateAxis(mAxis, cloneDof(0), mName);
+    }
+
 } // namespace kinematics
@@ -242,4 +242,16 @@ namespace kinematics {
     }
 //
 
+    Transformation* TrfmRotateEulerX::clone() const {
+        return new TrfmRotateEulerX(cloneDof(0), mName);
+    }
+
+    Transformation* TrfmRotateEulerY::clone() const {
+        return new TrfmRotateEulerY(cloneDof(0), mName);
+    }
+
+    Transformation* TrfmRotateEulerZ::clone() const {
+        return new TrfmRotateEulerZ(cloneDof(0), mName);
+    }
+
 } // namespace kinematics
@@ -53,6 +53,7 @@ namespace kinematics {
         void computeTransform();
         Eigen::Matrix4d getDeriv(const Dof *q);
         Eigen::Matrix4d getSecondDeriv(const Dof *q1, const Dof *q2);
+        Transformation* clone() const;
     };
 
     // rotate about y axis
@@ -66,6 +67,7 @@ namespace kinematics {
         void computeTransform();
         Eigen::Matrix4d getDeriv(const Dof *q);
         Eigen::Matrix4d getSecondDeriv(const Dof *q1, const Dof *q2);
+        Transformation* clone() const;
     };
 
 
@@ -80,6 +82,7 @@ namespace kinematics {
         void computeTransform();
         Eigen::Matrix4d getDeriv(const Dof *q);
         Eigen::Matrix4d getSecondDeriv(const Dof *q1, const Dof *q2);
+        Transformation* clone() const;
     };
 } // namespace kinematics
 
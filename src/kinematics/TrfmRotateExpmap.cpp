@@ -137,4 +137,9 @@ namespace kinematics {
         }
 
     }
+
+    Transformation* TrfmRotateExpMap::clone() const {
+        return new TrfmRotateExpMap(cloneDof(0), cloneDof(1), cloneDof(2), mName);
+    }
+
 } // namespace kinematics
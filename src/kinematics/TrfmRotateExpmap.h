@@ -55,6 +55,7 @@ namespace kinematics {
         void computeTransform();
         Eigen::Matrix4d getDeriv(const Dof *);
         Eigen::Matrix4d getSecondDeriv(const Dof *q1, const Dof *q2);
+        Transformation* clone() const;
 
     protected:
 
@@ -130,4 +130,9 @@ namespace kinematics {
             if (_ri) _ri->rotate(a, theta*180/M_PI);
         }
     }
+
+    Transformation* TrfmRotateQuat::clone() const {
+        return new TrfmRotateQuat(cloneDof(0), cloneDof(1), cloneDof(2), cloneDof(3), mName);
+    }
+
 } // namespace kinematics
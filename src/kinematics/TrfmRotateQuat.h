@@ -50,6 +50,7 @@ namespace kinematics {
         void computeTransform();
         Eigen::Matrix4d getDeriv(const Dof *);
         Eigen::Matrix4d getSecondDeriv(const Dof *, const Dof *);
+        Transformation* clone() const;
     };
 
 } // namespace kinematics
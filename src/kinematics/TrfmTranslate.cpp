@@ -386,4 +386,20 @@ namespace kinematics {
         m.row(A_Z) -= mDofs[0]->getValue() * m.row(3);
     }
 
+    Transformation* TrfmTranslate::clone() const {
+        return new TrfmTranslate(cloneDof(0), cloneDof(1), cloneDof(2), mName);
+    }
+
+    Transformation* TrfmTranslateX::clone() const {
+        return new TrfmTranslateX(cloneDof(0), mName);
+    }
+
+    Transformation* TrfmTranslateY::clone() const {
+        return new TrfmTranslateY(cloneDof(0), mName);
+    }
+
+    Transformation* TrfmTranslateZ::clone() const {
+        return new TrfmTranslateZ(cloneDof(0), mName);
+    }
+
 } // namespace kinematics
@@ -60,6 +60,7 @@ namespace kinematics {
         void applyDeriv(const Dof* q, Eigen::Matrix4d& m);
 
         Eigen::Matrix4d getSecondDeriv(const Dof *q1, const Dof *q2);
+        Transformation* clone() const;
         void applySecondDeriv(const Dof* q1, const Dof* q2, Eigen::Vector3d& v);
         void applySecondDeriv(const Dof* q1, const Dof* q2, Eigen::Matrix4d& m);
     };
@@ -82,6 +83,7 @@ namespace kinematics {
         void applyDeriv(const Dof* q, Eigen::Matrix4d& m);
 
         Eigen::Matrix4d getSecondDeriv(const Dof *q1, const Dof *q2);
+        Transformation* clone() const;
         void applySecondDeriv(const Dof* q1, const Dof* q2, Eigen::Vector3d& v);
         void applySecondDeriv(const Dof* q1, const Dof* q2, Eigen::Matrix4d& m);
     };
@@ -104,6 +106,7 @@ namespace kinematics {
         void applyDeriv(const Dof* q, Eigen::Matrix4d& m);
 
         Eigen::Matrix4d getSecondDeriv(const Dof *q1, const Dof *q2);
+        Transformation* clone() const;
         void applySecondDeriv(const Dof* q1, const Dof* q2, Eigen::Vector3d& v);
         void applySecondDeriv(const Dof* q1, const Dof* q2, Eigen::Matrix4d& m);
     };
@@ -126,6 +129,7 @@ namespace kinematics {
         void applyDeriv(const Dof* q, Eigen::Matrix4d& m);
 
         Eigen::Matrix4d getSecondDeriv(const Dof *q1, const Dof *q2);
+        Transformation* clone() const;
         void applySecondDeriv(const Dof* q1, const Dof* q2, Eigen::Vector3d& v);
         void applySecondDeriv(const Dof* q1, const Dof* q2, Eigen::Matrix4d& m);
     };
@@ -1,5 +1,6 @@
 #include "LCPSolver.h"
 #include "Lemke.h"
+#include "PGS.h"
 #include <cstdio>
 #include "lcp.h"
 #include "misc.h"
@@ -7,6 +8,7 @@
 namespace lcpsolver {
 
     LCPSolver::LCPSolver()
+        : mNumPivots(0), mNumIterations(0), mMaxIterations(100), mTolerance(1e-6), mRelaxation(1.0)
     {
 
     }
@@ -15,8 +17,9 @@ namespace lcpsolver {
 
     }
 
-    bool LCPSolver::Solve(const MatrixXd& _A, const VectorXd& _b, VectorXd& _x, int _numContacts, double _mu, int _numDir, bool _bUseODESolver)
+    bool LCPSolver::Solve(const MatrixXd& _A, const VectorXd& _b, VectorXd& _x, int _numContacts, double _mu, int _numDir, bool _bUseODESolver, bool _bWarmStart)
     {
+        mNumPivots = 0;
         if (!_bUseODESolver)
             {
                 int err = Lemke(_A, _b, _x);
@@ -68,8 +71,30 @@ namespace lcpsolver {
                         hi[_numContacts + i * 2 + 1] = _mu;
 
                     }
+                bool bWarmStart = _bWarmStart && _x.size() == _A.rows();
+                if (bWarmStart)
+                    {
+                        int offset = _numDir / 4;
+                        int numOtherConstrs = n - _numContacts * 3;
+                        for (int i = 0; i < _numContacts; ++i)
+                            {
+                                x[i] = _x[i];
+                                x[_numContacts + i * 2 + 0] = _x[_numContacts + i * _numDir + 0];
+                                x[_numContacts + i * 2 + 1] = _x[_numContacts + i * _numDir + offset];
+                            }
+                        for (int i = 0; i < numOtherConstrs; i++)
+                            x[_numContacts * 3 + i] = _x[_numContacts * (2 + _numDir) + i];
+                    }
                 //		dClearUpperTriangle (A,n);
-                dSolveLCP (n, A, x, b, w, 0, lo, hi, findex);
+                void* work = NULL;
+                if (bWarmStart)
+                    {
+                        size_t workSize = (dEstimateWarmStartMemoryReq(n) + sizeof(double) - 1) / sizeof(double);
+                        if (mWarmStartWork.size() < workSize)
+                            mWarmStartWork.resize(workSize);
+                        work = &mWarmStartWork[0];
+                    }
+                dSolveLCP (n, A, x, b, w, 0, lo, hi, findex, bWarmStart, &mNumPivots, work);
                 /*
                   for (int i = 0; i < n; i++) {
                   if (w[i] < 0.0 && abs(x[i] - hi[i]) > 0.000001)
@@ -101,6 +126,85 @@ namespace lcpsolver {
 
     }
 
+    bool LCPSolver::Solve(const MatrixXd& _J, const MatrixXd& _MInvJt, const VectorXd& _b, VectorXd& _x, int _numContacts, double _mu, int _numDir, double _cfm, bool _bWarmStart)
+    {
+        assert(_numDir >= 4);
+        int numOtherConstrs = _J.rows() - _numContacts * (1 + _numDir);
+        int n = _numContacts * 3 + numOtherConstrs;
+        int offset = _numDir / 4;
+
+        // rows in the ODE order, with each contact's normal ahead of its
+        // two friction directions so that a sweep sees the updated normal
+        // force when it clamps the friction
+        vector<int> rows(n);
+        vector<int> findex(n, -1);
+        VectorXd lo = VectorXd::Zero(n);
+        VectorXd hi = VectorXd::Constant(n, dInfinity);
+        VectorXd cfm = VectorXd::Zero(n);
+        for (int i = 0; i < _numContacts; ++i)
+            {
+                rows[i * 3 + 0] = i;
+                rows[i * 3 + 1] = _numContacts + i * _numDir + 0;
+                rows[i * 3 + 2] = _numContacts + i * _numDir + offset;
+                for (int k = 1; k < 3; ++k)
+                    {
+                        findex[i * 3 + k] = i * 3;
+                        lo[i * 3 + k] = -_mu;
+                        hi[i * 3 + k] = _mu;
+                    }
+            }
+        for (int i = 0; i < numOtherConstrs; i++)
+            rows[_numContacts * 3 + i] = _numContacts * (1 + _numDir) + i;
+
+        MatrixXd J(n, _J.cols());
+        MatrixXd MInvJt(_MInvJt.rows(), n);
+        VectorXd b(n);
+        for (int i = 0; i < n; ++i)
+            {
+                J.row(i) = _J.row(rows[i]);
+                MInvJt.col(i) = _MInvJt.col(rows[i]);
+                b[i] = _b[rows[i]];
+                if (i < _numContacts * 3)
+                    cfm[i] = _cfm * J.row(i).dot(MInvJt.col(i));
+            }
+
+        // the layout of _x has the friction cone rows after the tangent
+        // directions
+        VectorXd x = VectorXd::Zero(n);
+        int dimX = _numContacts * (2 + _numDir) + numOtherConstrs;
+        if (_bWarmStart && _x.size() == dimX)
+            {
+                for (int i = 0; i < _numContacts; ++i)
+                    {
+                        x[i * 3 + 0] = _x[i];
+                        x[i * 3 + 1] = _x[_numContacts + i * _numDir + 0];
+                        x[i * 3 + 2] = _x[_numContacts + i * _numDir + offset];
+                    }
+                for (int i = 0; i < numOtherConstrs; i++)
+                    x[_numContacts * 3 + i] = _x[_numContacts * (2 + _numDir) + i];
+            }
+
+        bool converged = PGS(J, MInvJt, cfm, b, lo, hi, findex, x, mMaxIterations, mTolerance, mRelaxation, &mNumIterations);
+
+        _x = VectorXd::Zero(dimX);
+        for (int i = 0; i < _numContacts; ++i)
+            {
+                _x[i] = x[i * 3 + 0];
+                _x[_numContacts + i * _numDir + 0] = x[i * 3 + 1];
+                _x[_numContacts + i * _numDir + offset] = x[i * 3 + 2];
+            }
+        for (int i = 0; i < numOtherConstrs; i++)
+            _x[_numContacts * (2 + _numDir) + i] = x[_numContacts * 3 + i];
+        return converged;
+    }
+
+    void LCPSolver::setPGSParameters(int _maxIterations, double _tolerance, double _relaxation)
+    {
+        mMaxIterations = _maxIterations;
+        mTolerance = _tolerance;
+        mRelaxation = _relaxation;
+    }
+
     void LCPSolver::transferToODEFormulation(const MatrixXd& _A, const VectorXd& _b, MatrixXd& _AOut, VectorXd& _bOut, int _numDir, int _numContacts)
     {
         int numOtherConstrs = _A.rows() - _numContacts * (2 + _numDir);
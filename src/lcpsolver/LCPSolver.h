@@ -52,11 +52,40 @@ namespace lcpsolver {
         LCPSolver();
         ~LCPSolver();
 
-        bool Solve(const MatrixXd& _A, const VectorXd& _b, VectorXd& _x, int numContacts, double mu = 0, int numDir = 0, bool bUseODESolver = false);
+        /// If _bWarmStart is set and the ODE solver is used, _x holds an
+        /// initial guess on input, e.g. the solution of the previous step.
+        bool Solve(const MatrixXd& _A, const VectorXd& _b, VectorXd& _x, int numContacts, double mu = 0, int numDir = 0, bool bUseODESolver = false, bool _bWarmStart = false);
+
+        /// Iterative, matrix-free alternative for the same contact problem.
+        /// The rows of _J are those of _A without the friction cone rows:
+        /// the normals, the numDir tangent directions of each contact and the
+        /// other constraints, and _A = _J * _MInvJt with the diagonal of the
+        /// contact rows scaled by (1 + _cfm). Friction is boxed as in the ODE
+        /// solver. The problem is solved by projected Gauss-Seidel (see
+        /// setPGSParameters) without forming _A; _x is in the layout of the
+        /// dense solve and holds an initial guess if _bWarmStart is set.
+        bool Solve(const MatrixXd& _J, const MatrixXd& _MInvJt, const VectorXd& _b, VectorXd& _x, int numContacts, double mu, int numDir, double _cfm = 0.0, bool _bWarmStart = false);
+
+        /// Number of pivoting steps taken by the last ODE solve; 0 if the
+        /// warm start guess was accepted.
+        int getNumPivots() const { return mNumPivots; }
+
+        /// Sweep budget, convergence tolerance and over-relaxation factor of
+        /// the iterative solve
+        void setPGSParameters(int _maxIterations, double _tolerance, double _relaxation);
+        /// Number of sweeps taken by the last iterative solve
+        int getNumIterations() const { return mNumIterations; }
     private:
         void transferToODEFormulation(const MatrixXd& _A, const VectorXd& _b, MatrixXd& _AOut, VectorXd& _bOut, int _numDir, int _numContacts);
         void transferSolFromODEFormulation(const VectorXd& _x, VectorXd& _xOut, int _numDir, int _numContacts);
         bool checkIfSolution(const MatrixXd& _A, const VectorXd& _b, const VectorXd& _x);
+
+        int mNumPivots;
+        int mNumIterations;
+        int mMaxIterations;
+        double mTolerance;
+        double mRelaxation;
+        vector<double> mWarmStartWork;
     };
 } // namespace lcpsolver
 #endif
@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2011, Georgia Tech Research Corporation
+ * All rights reserved.
+ *
+ * Author(s):
+ * Date:
+ *
+ * Geoorgia Tech Graphics Lab and Humanoid Robotics Lab
+ *
+ * Directed by Prof. C. Karen Liu and Prof. Mike Stilman
+ * <karenliu@cc.gatech.edu> <mstilman@cc.gatech.edu>
+ *
+ * This file is provided under the following "BSD-style" License:
+ *   Redistribution and use in source and binary forms, with or
+ *   without modification, are permitted provided that the following
+ *   conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *   CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *   INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *   MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ *   USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ *   AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *   LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *   ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *   POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "PGS.h"
+#include <cmath>
+#include <algorithm>
+
+using namespace Eigen;
+using namespace std;
+
+namespace lcpsolver {
+
+    bool PGS(const MatrixXd& _J, const MatrixXd& _MInvJt, const VectorXd& _cfm,
+             const VectorXd& _b, const VectorXd& _lo, const VectorXd& _hi,
+             const vector<int>& _findex, VectorXd& _x,
+             int _maxIterations, double _tolerance, double _relaxation, int* _numIterations)
+    {
+        int n = _J.rows();
+        if (_x.size() != n)
+            _x = VectorXd::Zero(n);
+        if (_numIterations)
+            *_numIterations = 0;
+        if (n == 0)
+            return true;
+
+        // diagonal of A; variables of rows without any coupling stay zero
+        VectorXd invDiag(n);
+        for (int i = 0; i < n; i++) {
+            double d = _J.row(i).dot(_MInvJt.col(i)) + _cfm[i];
+            invDiag[i] = d > 0.0 ? 1.0 / d : 0.0;
+        }
+
+        VectorXd v = _MInvJt * _x;
+        bool converged = false;
+        int iter = 0;
+        while (iter < _maxIterations && !converged) {
+            double maxDelta = 0.0;
+            double maxX = 1.0;
+            for (int i = 0; i < n; i++) {
+                double x = 0.0;
+                if (invDiag[i] != 0.0) {
+                    double w = _J.row(i).dot(v) + _cfm[i] * _x[i] + _b[i];
+                    x = _x[i] - _relaxation * w * invDiag[i];
+                }
+
+                double lo = _lo[i];
+                double hi = _hi[i];
+                if (_findex[i] >= 0) {
+                    hi = fabs(_hi[i] * _x[_findex[i]]);
+                    lo = -hi;
+                }
+                x = min(max(x, lo), hi);
+
+                double delta = x - _x[i];
+                if (delta != 0.0) {
+                    v.noalias() += delta * _MInvJt.col(i);
+                    _x[i] = x;
+                }
+                maxDelta = max(maxDelta, fabs(delta));
+                maxX = max(maxX, fabs(x));
+            }
+            iter++;
+            converged = maxDelta <= _tolerance * maxX;
+        }
+        if (_numIterations)
+            *_numIterations = iter;
+        return converged;
+    }
+
+} // namespace lcpsolver
@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2011, Georgia Tech Research Corporation
+ * All rights reserved.
+ *
+ * Author(s):
+ * Date:
+ *
+ * Geoorgia Tech Graphics Lab and Humanoid Robotics Lab
+ *
+ * Directed by Prof. C. Karen Liu and Prof. Mike Stilman
+ * <karenliu@cc.gatech.edu> <mstilman@cc.gatech.edu>
+ *
+ * This file is provided under the following "BSD-style" License:
+ *   Redistribution and use in source and binary forms, with or
+ *   without modification, are permitted provided that the following
+ *   conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *   CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *   INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *   MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ *   USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ *   AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *   LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *   ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *   POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef LCPSOLVER_PGS_H
+#define LCPSOLVER_PGS_H
+
+#include <vector>
+#include <Eigen/Dense>
+
+namespace lcpsolver {
+    /// Projected Gauss-Seidel with successive over-relaxation for the boxed
+    /// LCP w = A x + _b with A = _J * _MInvJt + diag(_cfm):
+    /// _lo(i) <= x(i) <= _hi(i) and w(i) >= 0 if x(i) = _lo(i), w(i) <= 0 if
+    /// x(i) = _hi(i), w(i) = 0 otherwise. If _findex[i] >= 0 the bounds of
+    /// x(i) are -+_hi(i) * x(_findex[i]) instead, e.g. for friction.
+    ///
+    /// A is never formed: the iteration keeps v = _MInvJt * x up to date and
+    /// evaluates a row of A x as a row of _J times v, so a sweep costs
+    /// O(rows * cols of _J). _x holds the initial guess (zero if the size does
+    /// not match) and receives the solution. The iteration stops when no
+    /// variable changes by more than _tolerance * max(1, max|x|) in a sweep
+    /// or after _maxIterations sweeps. _relaxation in (0, 2) is the SOR
+    /// factor; 1 is plain Gauss-Seidel.
+    /// Returns true on convergence. _numIterations receives the sweeps taken.
+    bool PGS(const Eigen::MatrixXd& _J, const Eigen::MatrixXd& _MInvJt, const Eigen::VectorXd& _cfm,
+             const Eigen::VectorXd& _b, const Eigen::VectorXd& _lo, const Eigen::VectorXd& _hi,
+             const std::vector<int>& _findex, Eigen::VectorXd& _x,
+             int _maxIterations, double _tolerance, double _relaxation, int* _numIterations = NULL);
+} // namespace lcpsolver
+
+#endif // #ifndef LCPSOLVER_PGS_H
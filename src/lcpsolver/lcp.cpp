@@ -774,11 +774,197 @@ void dLCP::unpermute()
 #endif // dLCP_FAST
 
 
+//***************************************************************************
+// solve M*x = rhs in place by Gaussian elimination with partial pivoting. M is
+// m*m with row skip mskip and is destroyed. returns false if M is singular.
+
+static bool dSolveGaussian (dReal *M, dReal *rhs, int m, int mskip)
+{
+  for (int i=0; i<m; ++i) {
+    int p = i;
+    for (int j=i+1; j<m; ++j) if (dFabs(M[j*mskip+i]) > dFabs(M[p*mskip+i])) p = j;
+    if (!(dFabs(M[p*mskip+i]) > 0)) return false;
+    if (p != i) {
+      for (int k=i; k<m; ++k) {
+        dReal tmp = M[i*mskip+k];
+        M[i*mskip+k] = M[p*mskip+k];
+        M[p*mskip+k] = tmp;
+      }
+      dReal tmp = rhs[i];
+      rhs[i] = rhs[p];
+      rhs[p] = tmp;
+    }
+    for (int j=i+1; j<m; ++j) {
+      dReal f = M[j*mskip+i] / M[i*mskip+i];
+      if (f == 0) continue;
+      for (int k=i+1; k<m; ++k) M[j*mskip+k] -= f*M[i*mskip+k];
+      rhs[j] -= f*rhs[i];
+    }
+  }
+  for (int i=m-1; i>=0; --i) {
+    dReal sum = rhs[i];
+    for (int k=i+1; k<m; ++k) sum -= M[i*mskip+k]*rhs[k];
+    rhs[i] = sum / M[i*mskip+i];
+  }
+  return true;
+}
+
+//***************************************************************************
+// warm start: start from the index sets implied by the guess in x (x at lo,
+// at hi or clamped in between), solve for the clamped variables with the
+// others at their bounds and move the variables that violate the LCP
+// conditions to the other set, all at once, until none is left. friction
+// variables at their bounds follow the normal force they depend on, which
+// couples them into the linear system. A, b, lo and hi are not modified.
+// the number of index changes is added to num_pivots. returns false, leaving
+// x unchanged, if this does not converge in a few iterations. the work
+// arrays are taken from `work' if it is nonzero, see
+// dEstimateWarmStartMemoryReq().
+
+static bool dSolveLCPFromGuess (int n, const dReal *A, dReal *x, const dReal *b,
+                                dReal *w, int nub, const dReal *lo, const dReal *hi,
+                                const int *findex, int *num_pivots, void *work)
+{
+  const int nskip = dPAD(n);
+  const int max_iterations = 10;
+
+  dReal scale_b = 1, scale_x = 1;
+  for (int i=0; i<n; ++i) {
+    if (dFabs(b[i]) > scale_b) scale_b = dFabs(b[i]);
+    if (dFabs(x[i]) > scale_x) scale_x = dFabs(x[i]);
+  }
+  const dReal tol_x = REAL(1e-9) * scale_x;
+  const dReal tol_w = REAL(1e-9) * scale_b;
+
+  char *block = work ? (char*)work : new char[dEstimateWarmStartMemoryReq(n)];
+  dReal *xg = (dReal*)block;
+  dReal *lo2 = xg + n;
+  dReal *hi2 = lo2 + n;
+  dReal *rhs = hi2 + n;
+  dReal *M = rhs + n;
+  int *C = (int*)(M + n*nskip);
+  int *pos = C + n;	// position in C, or -1
+  int *state = pos + n;	// -1: x=lo, 1: x=hi, 0: clamped
+  memcpy (xg,x,n*sizeof(dReal));
+
+  bool solved = false;
+  for (int iter=0; iter<max_iterations; ++iter) {
+    // friction bounds follow the current normal forces
+    for (int k=0; k<n; ++k) {
+      if (findex && findex[k] >= 0) {
+        hi2[k] = dFabs (hi[k] * xg[findex[k]]);
+        lo2[k] = -hi2[k];
+      }
+      else {
+        lo2[k] = lo[k];
+        hi2[k] = hi[k];
+      }
+    }
+    if (iter == 0) {
+      for (int k=0; k<n; ++k) {
+        if (k < nub) state[k] = 0;
+        else if (xg[k] <= lo2[k] + tol_x) state[k] = -1;
+        else if (xg[k] >= hi2[k] - tol_x) state[k] = 1;
+        else state[k] = 0;
+      }
+    }
+    int nC = 0;
+    for (int k=0; k<n; ++k) {
+      pos[k] = -1;
+      if (state[k] == 0) {
+        pos[k] = nC;
+        C[nC++] = k;
+      }
+    }
+
+    // A(C,C) x(C) = b(C) - A(C,N) x(N), where a friction variable at its
+    // bound is +-hi times a clamped normal force or a constant otherwise
+    const int mskip = dPAD(nC);
+    for (int j=0; j<nC; ++j) {
+      const dReal *Arow = A + C[j]*nskip;
+      dReal *Mrow = M + j*mskip;
+      for (int c=0; c<nC; ++c) Mrow[c] = Arow[C[c]];
+      rhs[j] = b[C[j]];
+      for (int k=0; k<n; ++k) {
+        if (state[k] == 0) continue;
+        if (findex && findex[k] >= 0 && pos[findex[k]] >= 0)
+          Mrow[pos[findex[k]]] += Arow[k] * state[k] * hi[k];
+        else
+          rhs[j] -= Arow[k] * (state[k] < 0 ? lo2[k] : hi2[k]);
+      }
+    }
+    if (nC > 0 && !dSolveGaussian (M,rhs,nC,mskip)) break;
+    for (int j=0; j<nC; ++j) xg[C[j]] = rhs[j];
+    for (int k=0; k<n; ++k) {
+      if (state[k] == 0) continue;
+      if (findex && findex[k] >= 0 && pos[findex[k]] >= 0)
+        xg[k] = state[k] * hi[k] * xg[findex[k]];
+      else
+        xg[k] = state[k] < 0 ? lo2[k] : hi2[k];
+    }
+    for (int k=0; k<n; ++k) {
+      if (findex && findex[k] >= 0) {
+        hi2[k] = dFabs (hi[k] * xg[findex[k]]);
+        lo2[k] = -hi2[k];
+      }
+    }
+
+    int changes = 0;
+    for (int k=0; k<n; ++k) {
+      dReal wk = -b[k];
+      const dReal *Arow = A + k*nskip;
+      for (int j=0; j<n; ++j) wk += Arow[j]*xg[j];
+      w[k] = wk;
+      if (k < nub) continue;
+      if (state[k] == 0) {
+        if (xg[k] < lo2[k] - tol_x) state[k] = -1;
+        else if (xg[k] > hi2[k] + tol_x) state[k] = 1;
+        else continue;
+      }
+      else if (lo2[k] == hi2[k]) {
+        continue;
+      }
+      else if ((state[k] < 0 && wk < -tol_w) || (state[k] > 0 && wk > tol_w)) {
+        state[k] = 0;
+      }
+      else {
+        continue;
+      }
+      ++changes;
+    }
+    if (num_pivots) *num_pivots += changes;
+    if (changes == 0) {
+      solved = true;
+      break;
+    }
+  }
+  if (solved) memcpy (x,xg,n*sizeof(dReal));
+
+  if (!work)
+    delete[] block;
+  return solved;
+}
+
+size_t dEstimateWarmStartMemoryReq(int n)
+{
+  const int nskip = dPAD(n);
+
+  size_t res = 0;
+
+  res += 4 * (sizeof(dReal) * n); // for xg, lo2, hi2, rhs
+  res += (sizeof(dReal) * (n * nskip)); // for M
+  res += 3 * (sizeof(int) * n); // for C, pos, state
+
+  return res;
+}
+
 //***************************************************************************
 // an optimized Dantzig LCP driver routine for the lo-hi LCP problem.
 
 void dSolveLCP (int n, dReal *A, dReal *x, dReal *b,
-                dReal *outer_w/*=NULL*/, int nub, dReal *lo, dReal *hi, int *findex)
+                dReal *outer_w/*=NULL*/, int nub, dReal *lo, dReal *hi, int *findex,
+                bool warm_start/*=false*/, int *num_pivots/*=NULL*/,
+                void *warm_start_work/*=NULL*/)
 {
   dAASSERT (n>0 && A && x && b && lo && hi && nub >= 0 && nub <= n);
 # ifndef dNODEBUG
@@ -789,6 +975,20 @@ void dSolveLCP (int n, dReal *A, dReal *x, dReal *b,
 # endif
 
 
+  if (num_pivots) *num_pivots = 0;
+
+  if (warm_start) {
+    dReal *w = outer_w ? outer_w : (new dReal[n]);
+    bool solved = dSolveLCPFromGuess (n,A,x,b,w,nub,lo,hi,findex,num_pivots,
+                                      warm_start_work);
+    if (!outer_w)
+      delete[] w;
+    if (solved)
+      return;
+  }
+  // the Dantzig algorithm starts from x = 0
+  dSetZero (x,n);
+
   // if all the variables are unbounded then we can just factor, solve,
   // and return
   if (nub >= n) {
@@ -907,6 +1107,7 @@ void dSolveLCP (int n, dReal *A, dReal *x, dReal *b,
     else {
       // we must push x(i) and w(i)
       for (;;) {
+        if (num_pivots) ++(*num_pivots);
         int dir;
         dReal dirf;
         // find direction to push on x(i)
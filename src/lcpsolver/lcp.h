@@ -58,7 +58,30 @@ to be implemented. the first `nub' variables are assumed to have findex < 0.
 #include "common.h"
 
 void dSolveLCP (int n, dReal *A, dReal *x, dReal *b, dReal *w,
-	int nub, dReal *lo, dReal *hi, int *findex);
+	int nub, dReal *lo, dReal *hi, int *findex,
+	bool warm_start = false, int *num_pivots = 0,
+	void *warm_start_work = 0);
+
+/*
+
+warm start: if `warm_start' is true, x holds an initial guess on input,
+e.g. the solution of the previous time step. the index sets implied by the
+guess (x at lo, at hi or in between) are tried first: x is solved for with
+these sets fixed and the variables that violate the LCP conditions are moved
+between the sets until none is left. if that does not converge within a few
+iterations the problem is solved from scratch.
+
+if `num_pivots' is nonzero it receives the number of pivoting steps, i.e.
+changes of the index sets, taken by both methods. it is 0 if the guess is a
+solution.
+
+if `warm_start_work' is nonzero the warm start takes its work arrays from it
+instead of allocating them on every call. it must hold at least
+dEstimateWarmStartMemoryReq(n) bytes, aligned for dReal.
+
+*/
+
+size_t dEstimateWarmStartMemoryReq(int n);
 
 size_t dEstimateSolveLCPMemoryReq(int n, bool outer_w_avail);
 
@@ -482,4 +482,48 @@ namespace math {
         return expMapJacDot(_q, qdot);
     }
 
+    // Jdot = A*qdss + B*(qss*qdss + qdss*qss) + C*ttdot*qss + D*ttdot*qss2 with
+    // the coefficients of expMapJacDot. Since dtheta/dq_i = q_i/theta and the
+    // derivatives of A, B, C and D wrt theta divided by theta are C, D, E and
+    // F below, no division by q_i is needed
+    Matrix3d expMapJacDotDeriv( const Vector3d &_q, const Vector3d &_qdot, int _qi ) {
+        assert(_qi>=0 && _qi<=2);
+        double theta = _q.norm();
+
+        Matrix3d qss =  math::makeSkewSymmetric(_q);
+        Matrix3d qss2 =  qss*qss;
+        Matrix3d qdss = math::makeSkewSymmetric(_qdot);
+        Matrix3d ess = math::makeSkewSymmetric(Vector3d::Unit(_qi));
+        double ttdot = _q.dot(_qdot);   // theta*thetaDot
+        double st = sin(theta);
+        double ct = cos(theta);
+        double t2 = theta*theta;
+        double t3 = t2*theta;
+        double t4 = t3*theta;
+        double t5 = t4*theta;
+        double t6 = t5*theta;
+        double t7 = t6*theta;
+
+        Matrix3d dJdot = Matrix3d::Zero();
+        double B, C, D;
+        if(theta<EPSILON_EXPMAP_THETA){
+            // the coefficients are constant in the small angle approximation of expMapJacDot
+            B = 1.0/6.0;
+            C = -1.0/12;
+            D = -1.0/60;
+        }
+        else {
+            B = (theta-st)/t3;
+            C = (theta*st + 2*ct - 2)/t4;
+            D = (3*st - theta*ct - 2*theta)/t5;
+            double E = (t2*ct - 5*theta*st - 8*ct + 8)/t6;
+            double F = (t2*st + 7*theta*ct - 15*st + 8*theta)/t7;
+            dJdot = _q[_qi]*(C*qdss + D*(qss*qdss + qdss*qss) + E*ttdot*qss + F*ttdot*qss2);
+        }
+        dJdot += B*(ess*qdss + qdss*ess);
+        dJdot += C*(_qdot[_qi]*qss + ttdot*ess);
+        dJdot += D*(_qdot[_qi]*qss2 + ttdot*(ess*qss + qss*ess));
+        return dJdot;
+    }
+
 } // namespace utils
@@ -76,6 +76,7 @@ namespace math {
     Eigen::Matrix3d expMapJac(const Eigen::Vector3d &_expmap);  ///< computes the Jacobian of the expmap
     Eigen::Matrix3d expMapJacDot(const Eigen::Vector3d &_expmap, const Eigen::Vector3d &_qdot); ///< computes the time derivative of the expmap Jacobian
     Eigen::Matrix3d expMapJacDeriv(const Eigen::Vector3d &_expmap, int _qi);    ///< computes the derivative of the Jacobian of the expmap wrt to _qi indexed dof; _qi \in {0,1,2}
+    Eigen::Matrix3d expMapJacDotDeriv(const Eigen::Vector3d &_expmap, const Eigen::Vector3d &_qdot, int _qi);    ///< computes the derivative of the time derivative of the expmap Jacobian wrt to _qi indexed dof; _qi \in {0,1,2}
 
 } // namespace utils
 
@@ -0,0 +1,201 @@
+/*
+ * Copyright (c) 2011, Georgia Tech Research Corporation
+ * All rights reserved.
+ *
+ * Author(s):
+ * Date:
+ *
+ * Geoorgia Tech Graphics Lab and Humanoid Robotics Lab
+ *
+ * Directed by Prof. C. Karen Liu and Prof. Mike Stilman
+ * <karenliu@cc.gatech.edu> <mstilman@cc.gatech.edu>
+ *
+ * This file is provided under the following "BSD-style" License:
+ *   Redistribution and use in source and binary forms, with or
+ *   without modification, are permitted provided that the following
+ *   conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *   CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *   INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *   MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ *   USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ *   AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *   LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *   ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *   POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef MATH_UTILSSPATIAL_H
+#define MATH_UTILSSPATIAL_H
+
+#include <Eigen/Dense>
+#include "math/UtilsMath.h"
+
+// Spatial (6D) vector algebra in the convention of the recursive dynamics:
+// motion and force vectors are stacked as [angular; linear] and refer to the
+// origin of the frame they are expressed in.
+
+namespace math {
+
+    typedef Eigen::Matrix<double, 6, 6> Matrix6d;
+
+    // quantities of a single joint have at most six dofs; with the maximum
+    // size fixed, Eigen keeps them and their temporaries on the stack
+    typedef Eigen::Matrix<double, 6, Eigen::Dynamic, 0, 6, 6> Matrix6Xd;
+    typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, 0, 6, 6> MatrixJointd;
+    typedef Eigen::Matrix<double, Eigen::Dynamic, 1, 0, 6, 1> VectorJointd;
+
+    /// @brief Spatial cross product for motion vectors: _v x _m.
+    inline Vector6d crossMotion(const Vector6d& _v, const Vector6d& _m) {
+        Vector6d res;
+        res.head<3>() = _v.head<3>().cross(_m.head<3>());
+        res.tail<3>() = _v.head<3>().cross(_m.tail<3>()) + _v.tail<3>().cross(_m.head<3>());
+        return res;
+    }
+
+    /// @brief Spatial cross product for force vectors: _v x* _f.
+    inline Vector6d crossForce(const Vector6d& _v, const Vector6d& _f) {
+        Vector6d res;
+        res.head<3>() = _v.head<3>().cross(_f.head<3>()) + _v.tail<3>().cross(_f.tail<3>());
+        res.tail<3>() = _v.head<3>().cross(_f.tail<3>());
+        return res;
+    }
+
+    /// @brief Rigid body spatial inertia about the frame origin, stored
+    /// compactly as the mass, the first moment of mass and the rotational
+    /// inertia about the origin. Sums of rigid body inertias, e.g. the
+    /// composite inertia of a subtree, stay in this form.
+    struct SpatialInertia {
+        EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+        double mass;
+        Eigen::Vector3d h;      ///< mass * center of mass
+        Eigen::Matrix3d Ibar;   ///< rotational inertia about the origin
+
+        SpatialInertia()
+            : mass(0.0), h(Eigen::Vector3d::Zero()), Ibar(Eigen::Matrix3d::Zero()) {}
+
+        /// @param[in] _com Center of mass.
+        /// @param[in] _Icom Rotational inertia about the center of mass.
+        SpatialInertia(double _mass, const Eigen::Vector3d& _com, const Eigen::Matrix3d& _Icom)
+            : mass(_mass), h(_mass * _com) {
+            Eigen::Matrix3d comSkew = makeSkewSymmetric(_com);
+            Ibar = _Icom - _mass * comSkew * comSkew;
+        }
+
+        SpatialInertia& operator+=(const SpatialInertia& _other) {
+            mass += _other.mass;
+            h += _other.h;
+            Ibar += _other.Ibar;
+            return *this;
+        }
+
+        /// @brief Momentum (force) of a motion vector, or the columns of a
+        /// 6 x k matrix of motion vectors.
+        template <typename Derived>
+        typename Derived::PlainObject operator*(const Eigen::MatrixBase<Derived>& _m) const {
+            typename Derived::PlainObject res(6, _m.cols());
+            Eigen::Matrix3d hSkew = makeSkewSymmetric(h);
+            res.template topRows<3>().noalias() = Ibar * _m.template topRows<3>();
+            res.template topRows<3>().noalias() += hSkew * _m.template bottomRows<3>();
+            res.template bottomRows<3>().noalias() = mass * _m.template bottomRows<3>();
+            res.template bottomRows<3>().noalias() -= hSkew * _m.template topRows<3>();
+            return res;
+        }
+
+        /// @brief The full 6x6 matrix [Ibar hx; hx^T m1].
+        Matrix6d toMatrix() const {
+            Matrix6d res;
+            Eigen::Matrix3d hSkew = makeSkewSymmetric(h);
+            res.topLeftCorner<3,3>() = Ibar;
+            res.topRightCorner<3,3>() = hSkew;
+            res.bottomLeftCorner<3,3>() = hSkew.transpose();
+            res.bottomRightCorner<3,3>() = mass * Eigen::Matrix3d::Identity();
+            return res;
+        }
+    };
+
+    /// @brief Compact spatial transform of motion vectors from a parent frame
+    /// A to a child frame B, i.e. the 6x6 matrix X = [E 0; -E*rx E].
+    /// Forces go the other way, from B to A, with X^T.
+    struct SpatialTransform {
+        EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+        Eigen::Matrix3d E;  ///< rotation from A coordinates to B coordinates
+        Eigen::Vector3d r;  ///< origin of B expressed in A
+
+        SpatialTransform()
+            : E(Eigen::Matrix3d::Identity()), r(Eigen::Vector3d::Zero()) {}
+
+        /// @param[in] _T Homogeneous transform of B relative to A, e.g. the
+        /// local transform of a body node.
+        explicit SpatialTransform(const Eigen::Matrix4d& _T)
+            : E(_T.topLeftCorner<3,3>().transpose()), r(_T.topRightCorner<3,1>()) {}
+
+        /// @brief X*_m for a motion vector or the columns of a 6 x k matrix.
+        template <typename Derived>
+        typename Derived::PlainObject apply(const Eigen::MatrixBase<Derived>& _m) const {
+            typename Derived::PlainObject res(6, _m.cols());
+            res.template topRows<3>().noalias() = E * _m.template topRows<3>();
+            res.template bottomRows<3>() = _m.template bottomRows<3>();
+            for (int i = 0; i < _m.cols(); i++)
+                res.template block<3,1>(3, i) -= r.cross(_m.template block<3,1>(0, i));
+            res.template bottomRows<3>() = E * res.template bottomRows<3>();
+            return res;
+        }
+
+        /// @brief X^T*_f for a force vector or the columns of a 6 x k matrix.
+        template <typename Derived>
+        typename Derived::PlainObject applyTranspose(const Eigen::MatrixBase<Derived>& _f) const {
+            typename Derived::PlainObject res(6, _f.cols());
+            res.template bottomRows<3>().noalias() = E.transpose() * _f.template bottomRows<3>();
+            res.template topRows<3>().noalias() = E.transpose() * _f.template topRows<3>();
+            for (int i = 0; i < _f.cols(); i++)
+                res.template block<3,1>(0, i) += r.cross(res.template block<3,1>(3, i));
+            return res;
+        }
+
+        /// @brief X^T*_I*X: a rigid body inertia expressed in B, expressed in A.
+        SpatialInertia applyTranspose(const SpatialInertia& _I) const {
+            SpatialInertia res;
+            Eigen::Vector3d h = E.transpose() * _I.h;
+            Eigen::Matrix3d hSkew = makeSkewSymmetric(h);
+            Eigen::Matrix3d rSkew = makeSkewSymmetric(r);
+            res.mass = _I.mass;
+            res.h = h + _I.mass * r;
+            res.Ibar.noalias() = E.transpose() * _I.Ibar * E;
+            res.Ibar.noalias() -= hSkew * rSkew + rSkew * hSkew;
+            res.Ibar.noalias() -= _I.mass * rSkew * rSkew;
+            return res;
+        }
+
+        /// @brief X^T*_I*X for a general (e.g. articulated body) inertia.
+        Matrix6d applyCongruence(const Matrix6d& _I) const {
+            Matrix6d IX = applyTranspose(_I.transpose()).transpose();
+            return applyTranspose(IX);
+        }
+
+        /// @brief The full 6x6 matrix X.
+        Matrix6d toMatrix() const {
+            Matrix6d res;
+            res.topLeftCorner<3,3>() = E;
+            res.topRightCorner<3,3>().setZero();
+            res.bottomLeftCorner<3,3>().noalias() = -E * makeSkewSymmetric(r);
+            res.bottomRightCorner<3,3>() = E;
+            return res;
+        }
+    };
+
+} // namespace math
+
+#endif // #ifndef MATH_UTILSSPATIAL_H
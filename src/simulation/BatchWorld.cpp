@@ -0,0 +1,248 @@
+/*
+ * Copyright (c) 2011, Georgia Tech Research Corporation
+ * All rights reserved.
+ *
+ * Author(s):
+ * Date:
+ *
+ * Geoorgia Tech Graphics Lab and Humanoid Robotics Lab
+ *
+ * Directed by Prof. C. Karen Liu and Prof. Mike Stilman
+ * <karenliu@cc.gatech.edu> <mstilman@cc.gatech.edu>
+ *
+ * This file is provided under the following "BSD-style" License:
+ *   Redistribution and use in source and binary forms, with or
+ *   without modification, are permitted provided that the following
+ *   conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *   CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *   INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *   MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ *   USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ *   AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *   LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *   ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *   POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "simulation/BatchWorld.h"
+#include "simulation/World.h"
+#include "dynamics/SkeletonDynamics.h"
+#include "dynamics/ConstraintDynamics.h"
+#include "utils/Timer.h"
+
+#include <algorithm>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace simulation {
+
+////////////////////////////////////////////////////////////////////////////////
+BatchWorld::BatchWorld()
+    : mNumThreads(1),
+      mStepsPerSecond(0.0)
+{
+#ifdef _OPENMP
+    mNumThreads = omp_get_max_threads();
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+BatchWorld::~BatchWorld()
+{
+    clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void BatchWorld::clear()
+{
+    for (unsigned int i = 0; i < mWorlds.size(); i++)
+        delete mWorlds[i];
+    mWorlds.clear();
+    for (unsigned int i = 0; i < mSkeletons.size(); i++)
+        delete mSkeletons[i];
+    mSkeletons.clear();
+    mStates.resize(0, 0);
+    mForces.resize(0, 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool BatchWorld::init(const std::vector<dynamics::SkeletonDynamics*>& _model,
+                      int _numEnvironments)
+{
+    clear();
+    if (_model.empty() || _numEnvironments < 1)
+        return false;
+
+    int nDofs = 0;
+    for (unsigned int j = 0; j < _model.size(); j++)
+        nDofs += _model[j]->getNumDofs();
+
+    for (int i = 0; i < _numEnvironments; i++)
+    {
+        World* world = new World();
+        // the collision meshes of the first environment are shared by all
+        if (i > 0)
+            world->getCollisionHandle()->setCollisionPrototype(mWorlds[0]->getCollisionHandle());
+        for (unsigned int j = 0; j < _model.size(); j++)
+        {
+            dynamics::SkeletonDynamics* skel = _model[j]->clone();
+            mSkeletons.push_back(skel);
+            world->addSkeleton(skel);
+        }
+        world->getCollisionHandle()->setCollisionPrototype(NULL);
+        mWorlds.push_back(world);
+    }
+
+    mStates.resize(2 * nDofs, _numEnvironments);
+    mForces.resize(nDofs, _numEnvironments);
+    for (int i = 0; i < _numEnvironments; i++)
+    {
+        mWorlds[i]->getState(getState(i));
+        for (unsigned int j = 0; j < _model.size(); j++)
+            mForces.col(i).segment(mWorlds[i]->getIndex(j), _model[j]->getNumDofs())
+                    = mWorlds[i]->getSkeleton(j)->getInternalForces();
+    }
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void BatchWorld::stepAll()
+{
+    stepAll(1);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void BatchWorld::stepAll(int _steps)
+{
+    int numEnvironments = getNumEnvironments();
+    int numThreads = 1;
+#ifdef _OPENMP
+    numThreads = std::max(1, std::min(mNumThreads, numEnvironments));
+    double start = omp_get_wtime();
+#else
+    utils::Timer timer("stepAll");
+    timer.startTimer();
+#endif
+
+    if (numThreads == 1)
+    {
+        stepRange(0, numEnvironments, _steps);
+    }
+    else
+    {
+        // contiguous ranges of environments, one per thread
+#pragma omp parallel for schedule(static, 1) num_threads(numThreads)
+        for (int i = 0; i < numThreads; i++)
+            stepRange((long)numEnvironments * i / numThreads,
+                      (long)numEnvironments * (i + 1) / numThreads, _steps);
+    }
+
+#ifdef _OPENMP
+    double elapsed = omp_get_wtime() - start;
+#else
+    double elapsed = timer.elapsed();
+#endif
+    mStepsPerSecond = elapsed > 0.0 ? (double)numEnvironments * _steps / elapsed : 0.0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void BatchWorld::stepRange(int _begin, int _end, int _steps)
+{
+    for (int i = _begin; i < _end; i++)
+    {
+        for (int j = 0; j < _steps; j++)
+            mWorlds[i]->step(getState(i));
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void BatchWorld::setGravity(const Eigen::Vector3d& _gravity)
+{
+    for (unsigned int i = 0; i < mWorlds.size(); i++)
+    {
+        mWorlds[i]->setGravity(_gravity);
+        // the dynamics of the current state are computed with the gravity
+        mWorlds[i]->setState(getConstState(i));
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void BatchWorld::setTimeStep(double _timeStep)
+{
+    for (unsigned int i = 0; i < mWorlds.size(); i++)
+        mWorlds[i]->setTimeStep(_timeStep);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void BatchWorld::setUseArticulatedBody(bool _useABA)
+{
+    for (unsigned int i = 0; i < mWorlds.size(); i++)
+    {
+        mWorlds[i]->setUseArticulatedBody(_useABA);
+        mWorlds[i]->setState(getConstState(i));
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void BatchWorld::setStates(const Eigen::MatrixXd& _states)
+{
+    for (int i = 0; i < getNumEnvironments(); i++)
+        setState(i, _states.col(i));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void BatchWorld::setState(int _index, const Eigen::VectorXd& _state)
+{
+    getState(_index) = _state;
+    mWorlds[_index]->setState(getConstState(_index));
+    // the state as clamped by the skeletons
+    mWorlds[_index]->getState(getState(_index));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+Eigen::Map<Eigen::VectorXd> BatchWorld::getState(int _index)
+{
+    return Eigen::Map<Eigen::VectorXd>(mStates.col(_index).data(), mStates.rows());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+Eigen::Map<const Eigen::VectorXd> BatchWorld::getConstState(int _index) const
+{
+    return Eigen::Map<const Eigen::VectorXd>(mStates.col(_index).data(), mStates.rows());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void BatchWorld::setInternalForces(const Eigen::MatrixXd& _forces)
+{
+    for (int i = 0; i < getNumEnvironments(); i++)
+        setInternalForces(i, _forces.col(i));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void BatchWorld::setInternalForces(int _index, const Eigen::VectorXd& _forces)
+{
+    World* world = mWorlds[_index];
+    for (unsigned int j = 0; j < world->getNumSkeletons(); j++)
+    {
+        dynamics::SkeletonDynamics* skel = world->getSkeleton(j);
+        int start = world->getIndex(j);
+        skel->setInternalForces(_forces.segment(start, skel->getNumDofs()));
+        // the forces are clamped to the limits of the skeleton
+        mForces.col(_index).segment(start, skel->getNumDofs()) = skel->getInternalForces();
+    }
+}
+
+} // namespace simulation
@@ -0,0 +1,182 @@
+/*
+ * Copyright (c) 2011, Georgia Tech Research Corporation
+ * All rights reserved.
+ *
+ * Author(s):
+ * Date:
+ *
+ * Geoorgia Tech Graphics Lab and Humanoid Robotics Lab
+ *
+ * Directed by Prof. C. Karen Liu and Prof. Mike Stilman
+ * <karenliu@cc.gatech.edu> <mstilman@cc.gatech.edu>
+ *
+ * This file is provided under the following "BSD-style" License:
+ *   Redistribution and use in source and binary forms, with or
+ *   without modification, are permitted provided that the following
+ *   conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *   CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *   INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *   MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ *   USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ *   AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *   LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *   ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *   POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SIMULATION_BATCH_WORLD_H
+#define SIMULATION_BATCH_WORLD_H
+
+#include <vector>
+#include <Eigen/Dense>
+
+namespace dynamics {
+class SkeletonDynamics;
+} // namespace dynamics
+
+namespace simulation {
+
+class World;
+
+/// @class BatchWorld
+/// @brief Independent copies of one world, e.g. for controller rollouts.
+///
+/// The states of all environments are the columns of one matrix in the
+/// layout of World::getState, and stepAll integrates each environment in
+/// place on its column. The internal forces are the columns of another
+/// matrix in the layout of the dofs.
+///
+/// Each environment still has a World with clones of the model skeletons
+/// and a constraint solver of its own: the skeletons cache the kinematics
+/// of their current state, and the environments are stepped in parallel,
+/// so this is the workspace of one environment. The collision meshes are
+/// built once and shared by all environments. The results do not depend on
+/// the number of threads.
+///
+/// An environment stepped outside of stepAll, or given a state through its
+/// World, is out of sync with its column until the next setState.
+class BatchWorld
+{
+public:
+    /// @brief Constructor.
+    BatchWorld();
+
+    /// @brief Destructor.
+    virtual ~BatchWorld();
+
+    /// @brief Create _numEnvironments environments, each with clones of
+    /// _model, in their current states. The model skeletons are not changed
+    /// and are not owned by the batch. Any previous environments are
+    /// destroyed.
+    /// @return False if the model is empty or _numEnvironments < 1.
+    bool init(const std::vector<dynamics::SkeletonDynamics*>& _model,
+              int _numEnvironments);
+
+    /// @brief Calculate the dynamics and integrate every environment for one
+    /// step.
+    void stepAll();
+
+    /// @brief Calculate the dynamics and integrate every environment for
+    /// multiple steps.
+    /// @param[in] _steps The number of steps to proceed.
+    void stepAll(int _steps);
+
+    /// @brief Set the gravity of all environments.
+    void setGravity(const Eigen::Vector3d& _gravity);
+
+    /// @brief Set the time step of all environments.
+    void setTimeStep(double _timeStep);
+
+    /// @brief Select how the accelerations are computed in all
+    /// environments; see World::setUseArticulatedBody.
+    void setUseArticulatedBody(bool _useABA);
+
+    /// @brief Set the number of threads stepAll uses; 1 steps the
+    /// environments serially.
+    inline void setNumThreads(int _num) { mNumThreads = _num > 0 ? _num : 1; }
+
+    /// @brief Get the number of threads stepAll uses.
+    inline int getNumThreads() const { return mNumThreads; }
+
+    /// @brief Get the number of environments.
+    inline int getNumEnvironments() const { return mWorlds.size(); }
+
+    /// @brief Get the indexed environment, e.g. to add constraints to it.
+    inline World* getEnvironment(int _index) const { return mWorlds[_index]; }
+
+    /// @brief Get the number of dofs of one environment.
+    inline int getNumDofs() const { return mForces.rows(); }
+
+    /// @brief The states of all environments, one column per environment.
+    inline const Eigen::MatrixXd& getStates() const { return mStates; }
+
+    /// @brief Set the states of all environments, one column per
+    /// environment. As in World::setState, the skeletons may clamp them.
+    void setStates(const Eigen::MatrixXd& _states);
+
+    /// @brief Set the state of the indexed environment.
+    void setState(int _index, const Eigen::VectorXd& _state);
+
+    /// @brief The internal forces of all environments, one column per
+    /// environment.
+    inline const Eigen::MatrixXd& getInternalForces() const { return mForces; }
+
+    /// @brief Set the internal forces of all environments, one column per
+    /// environment; they are kept until they are set again. As in
+    /// SkeletonDynamics::setInternalForces, they are clamped to the limits of
+    /// the model.
+    void setInternalForces(const Eigen::MatrixXd& _forces);
+
+    /// @brief Set the internal forces of the indexed environment.
+    void setInternalForces(int _index, const Eigen::VectorXd& _forces);
+
+    /// @brief The number of environment steps per second of wall-clock time
+    /// of the last stepAll, summed over all environments.
+    inline double getStepsPerSecond() const { return mStepsPerSecond; }
+
+protected:
+    /// @brief Destroy the environments and the skeleton clones.
+    void clear();
+
+    /// @brief Step the environments [_begin, _end).
+    void stepRange(int _begin, int _end, int _steps);
+
+    /// @brief The column of mStates of the indexed environment.
+    Eigen::Map<Eigen::VectorXd> getState(int _index);
+
+    /// @brief The column of mStates of the indexed environment, read-only.
+    Eigen::Map<const Eigen::VectorXd> getConstState(int _index) const;
+
+    /// @brief The environments.
+    std::vector<World*> mWorlds;
+
+    /// @brief The skeleton clones, owned by the batch.
+    std::vector<dynamics::SkeletonDynamics*> mSkeletons;
+
+    /// @brief The states of the environments, one column each.
+    Eigen::MatrixXd mStates;
+
+    /// @brief The internal forces of the environments, one column each.
+    Eigen::MatrixXd mForces;
+
+    /// @brief The number of threads stepAll uses.
+    int mNumThreads;
+
+    /// @brief Throughput of the last stepAll.
+    double mStepsPerSecond;
+};
+
+} // namespace simulation
+
+#endif // #ifndef SIMULATION_BATCH_WORLD_H
@@ -46,6 +46,8 @@
 #include "kinematics/Dof.h"
 #include "collision/CollisionDetector.h"
 
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 
 namespace simulation {
@@ -56,8 +58,19 @@ World::World()
       mCollisionHandle(NULL),
       mTime(0.0),
       mTimeStep(0.001),
-      mFrame(0)
+      mFrame(0),
+      mUseArticulatedBody(false),
+      mUseImplicitPD(true),
+      mAdaptiveTimeStep(false),
+      mMinTimeStep(1e-6),
+      mMaxTimeStep(0.05),
+      mNextTimeStep(0.001),
+      mNumThreads(1),
+      mSleeping(false),
+      mSleepVelocity(0.01),
+      mSleepTime(0.5)
 {
+    resetStepStatistics();
     mIndices.push_back(0);
 
     mCollisionHandle = new dynamics::ConstraintDynamics(mSkeletons, mTimeStep);
@@ -106,20 +119,102 @@ void World::reset()
     // Reset time and number of frames.
     mTime = 0;
     mFrame = 0;
+    mNextTimeStep = mTimeStep;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 void World::step()
 {
-    step(mTimeStep);
+    if (mAdaptiveTimeStep)
+        finishStep(stepAdaptive(mMaxTimeStep));
+    else
+        step(mTimeStep);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 void World::step(double _timeStep)
 {
+    if (mAdaptiveTimeStep)
+    {
+        // the last step is cut short to land on the end of the interval
+        double remaining = _timeStep;
+        while (remaining > 1e-12 * _timeStep)
+        {
+            double dt = stepAdaptive(remaining);
+            finishStep(dt);
+            remaining -= dt;
+        }
+        return;
+    }
+
     // Calculate (q, qdot) by integrating with (qdot, qdotdot).
     mIntegrator.integrate(this, _timeStep);
 
+    finishStep(_timeStep);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void World::step(Eigen::Map<Eigen::VectorXd> _state)
+{
+    if (mAdaptiveTimeStep)
+    {
+        step();
+        getState(_state);
+        return;
+    }
+
+    // the step of mIntegrator with _state as its state vector
+    evalDeriv(mDeriv);
+    _state += mTimeStep * mDeriv;
+    setState(Eigen::Map<const Eigen::VectorXd>(_state.data(), _state.size()));
+
+    finishStep(mTimeStep);
+
+    // the skeletons may have clamped the state
+    getState(_state);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+double World::stepAdaptive(double _maxTimeStep)
+{
+    // the contact impulses are computed for the size of each trial step
+    double contactTimeStep = mCollisionHandle->getTimeStep();
+
+    double dt = std::min(mNextTimeStep, _maxTimeStep);
+    bool truncated = mNextTimeStep > _maxTimeStep;
+    double error;
+    while (true)
+    {
+        mCollisionHandle->setTimeStep(dt);
+        error = mAdaptiveIntegrator.step(this, dt);
+        if (error <= 1.0 || dt <= mMinTimeStep)
+            break;
+
+        // shrink the step by the usual safety factor for a fifth order error
+        mNumRejectedSteps++;
+        mAdaptiveIntegrator.reject(this);
+        dt = std::max(mMinTimeStep,
+                      dt * std::max(0.2, 0.9 * std::pow(error, -0.2)));
+        truncated = false;
+    }
+    mCollisionHandle->setTimeStep(contactTimeStep);
+
+    // suggest the next step; a step cut short by _maxTimeStep says nothing
+    // about how large the next one can be
+    double factor = error > 0.0 ? std::min(5.0, 0.9 * std::pow(error, -0.2)) : 5.0;
+    double next = std::min(mMaxTimeStep, std::max(mMinTimeStep, dt * factor));
+    if (!truncated || next < mNextTimeStep)
+        mNextTimeStep = next;
+
+    return dt;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void World::finishStep(double _timeStep)
+{
+    if (mSleeping)
+        updateSleeping(_timeStep);
+
     // TODO: We need to consider better way.
     // Calculate body node's velocities represented in world frame.
     dynamics::BodyNodeDynamics* itrBodyNodeDyn = NULL;
@@ -135,6 +230,113 @@ void World::step(double _timeStep)
 
     mTime += _timeStep;
     mFrame++;
+
+    mNumAcceptedSteps++;
+    mLastTimeStep = _timeStep;
+    mAcceptedTime += _timeStep;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void World::updateSleeping(double _timeStep)
+{
+    for (unsigned int i = 0; i < getNumSkeletons(); ++i)
+    {
+        if (mSkeletons[i]->getImmobileState() || mSkeletons[i]->isAsleep())
+            continue;
+        const Eigen::VectorXd& qDot = mSkeletons[i]->getPoseVelocity();
+        if (qDot.size() > 0 && qDot.lpNorm<Eigen::Infinity>() >= mSleepVelocity)
+            mRestTimes[i] = 0.0;
+        else
+            mRestTimes[i] += _timeStep;
+    }
+
+    // the skeletons in contact go to sleep together, when all of them have
+    // rested long enough; one by one, an awake skeleton would wake its
+    // sleeping neighbors again
+    std::vector<double> islandRestTimes(mCollisionHandle->getNumIslands(),
+                                        mSleepTime);
+    for (unsigned int i = 0; i < getNumSkeletons(); ++i)
+    {
+        int island = mCollisionHandle->getSkeletonIsland(i);
+        if (island >= 0)
+            islandRestTimes[island] = std::min(islandRestTimes[island], mRestTimes[i]);
+    }
+
+    for (unsigned int i = 0; i < getNumSkeletons(); ++i)
+    {
+        if (mSkeletons[i]->getImmobileState() || mSkeletons[i]->isAsleep())
+            continue;
+        int island = mCollisionHandle->getSkeletonIsland(i);
+        if ((island >= 0 ? islandRestTimes[island] : mRestTimes[i]) < mSleepTime)
+            continue;
+
+        // freeze the skeleton with zero velocities; its dynamics stay valid
+        // for when it is woken in the middle of a step
+        mSkeletons[i]->setAsleep(true);
+        mRestTimes[i] = 0.0;
+        mVels[i].setZero(mSkeletons[i]->getNumDofs());
+        mSkeletons[i]->computeDynamics(mGravity, mVels[i], true, false,
+                                       !mUseArticulatedBody);
+        mSkeletons[i]->computePDForces(
+                    mUseImplicitPD && !mAdaptiveTimeStep ? mTimeStep : 0.0);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void World::setSleeping(bool _sleeping)
+{
+    mSleeping = _sleeping;
+    if (!mSleeping)
+    {
+        for (unsigned int i = 0; i < getNumSkeletons(); ++i)
+            mSkeletons[i]->setAsleep(false);
+    }
+    mRestTimes.assign(getNumSkeletons(), 0.0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int World::getNumSleepingSkeletons() const
+{
+    int numSleeping = 0;
+    for (unsigned int i = 0; i < getNumSkeletons(); ++i)
+    {
+        if (mSkeletons[i]->isAsleep())
+            numSleeping++;
+    }
+    return numSleeping;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void World::setAdaptiveTimeStep(bool _adaptive)
+{
+    mAdaptiveTimeStep = _adaptive;
+    mNextTimeStep = std::min(mMaxTimeStep, std::max(mMinTimeStep, mTimeStep));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void World::setTimeStepRange(double _minTimeStep, double _maxTimeStep)
+{
+    mMinTimeStep = _minTimeStep;
+    mMaxTimeStep = _maxTimeStep;
+    mNextTimeStep = std::min(mMaxTimeStep, std::max(mMinTimeStep, mNextTimeStep));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+double World::getEffectiveTimeStep() const
+{
+    if (mNumAcceptedSteps == 0)
+        return 0.0;
+    return mAcceptedTime / mNumAcceptedSteps;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void World::resetStepStatistics()
+{
+    mNumAcceptedSteps = 0;
+    mNumRejectedSteps = 0;
+    mNumDerivEvals = 0;
+    mLastTimeStep = 0.0;
+    mAcceptedTime = 0.0;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -170,77 +372,167 @@ dynamics::SkeletonDynamics* World::getSkeleton(const char* const _name) const
 ////////////////////////////////////////////////////////////////////////////////
 Eigen::VectorXd World::getState()
 {
-    Eigen::VectorXd state(mIndices.back() * 2);
+    Eigen::VectorXd state;
+    getState(state);
+    return state;
+}
 
+////////////////////////////////////////////////////////////////////////////////
+void World::getState(Eigen::VectorXd& _state)
+{
+    _state.resize(mIndices.back() * 2);
+    getState(Eigen::Map<Eigen::VectorXd>(_state.data(), _state.size()));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void World::getState(Eigen::Map<Eigen::VectorXd> _state)
+{
     for (unsigned int i = 0; i < getNumSkeletons(); i++)
     {
         int start = mIndices[i] * 2;
         int size = getSkeleton(i)->getNumDofs();
-        state.segment(start, size) = getSkeleton(i)->getPose();
-        state.segment(start + size, size) = getSkeleton(i)->getPoseVelocity();
+        for (int j = 0; j < size; j++)
+            _state[start + j] = getSkeleton(i)->getDof(j)->getValue();
+        _state.segment(start + size, size) = getSkeleton(i)->getPoseVelocity();
     }
-
-    return state;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 void World::setState(const Eigen::VectorXd& _newState)
 {
-    for (int i = 0; i < getNumSkeletons(); i++)
-    {
-        int start = mIndices[i] * 2;
-        int size = getSkeleton(i)->getNumDofs();
+    setState(Eigen::Map<const Eigen::VectorXd>(_newState.data(), _newState.size()));
+}
 
-        VectorXd pose = _newState.segment(start, size);
-        VectorXd qDot = _newState.segment(start + size, size);
-        getSkeleton(i)->clampRotation(pose, qDot);
-        if (getSkeleton(i)->getImmobileState())
-        {
-            // need to update node transformation for collision
-            getSkeleton(i)->setPose(pose, true, false);
-        }
-        else
-        {
-            // need to update first derivatives for collision
-            getSkeleton(i)->setPose(pose, false, true);
-            getSkeleton(i)->computeDynamics(mGravity, qDot, true);
-        }
+////////////////////////////////////////////////////////////////////////////////
+void World::setState(const Eigen::Map<const Eigen::VectorXd>& _newState)
+{
+    // the skeletons are independent until the constraint solver couples
+    // them, and each one only writes its own state
+    int numSkeletons = getNumSkeletons();
+    int numThreads = std::max(1, std::min(mNumThreads, numSkeletons));
+    if (numThreads == 1)
+    {
+        for (int i = 0; i < numSkeletons; i++)
+            setSkeletonState(i, _newState);
+    }
+    else
+    {
+#pragma omp parallel for schedule(dynamic, 1) num_threads(numThreads)
+        for (int i = 0; i < numSkeletons; i++)
+            setSkeletonState(i, _newState);
+    }
+}
 
+////////////////////////////////////////////////////////////////////////////////
+void World::setSkeletonState(int _index, const Eigen::Map<const Eigen::VectorXd>& _newState)
+{
+    // a sleeping skeleton keeps its state and the dynamics it fell asleep
+    // with
+    if (getSkeleton(_index)->isAsleep())
+        return;
+
+    int start = mIndices[_index] * 2;
+    int size = getSkeleton(_index)->getNumDofs();
+
+    Eigen::VectorXd& pose = mPoses[_index];
+    Eigen::VectorXd& qDot = mVels[_index];
+    pose = _newState.segment(start, size);
+    qDot = _newState.segment(start + size, size);
+    getSkeleton(_index)->clampRotation(pose, qDot);
+    if (getSkeleton(_index)->getImmobileState())
+    {
+        // need to update node transformation for collision
+        getSkeleton(_index)->setPose(pose, true, false);
+    }
+    else
+    {
+        // need to update first derivatives for collision
+        getSkeleton(_index)->setPose(pose, false, true);
+        // the mass matrix is left to the constraint solver if the
+        // articulated body algorithm is used; its inverse is never needed
+        getSkeleton(_index)->computeDynamics(mGravity, qDot, true, false,
+                                             !mUseArticulatedBody);
+        // PD servos are folded into the mass matrix over one time step,
+        // which only makes sense for the fixed-step integrator
+        getSkeleton(_index)->computePDForces(
+                    mUseImplicitPD && !mAdaptiveTimeStep ? mTimeStep : 0.0);
     }
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 Eigen::VectorXd World::evalDeriv()
 {
+    Eigen::VectorXd deriv;
+    evalDeriv(deriv);
+    return deriv;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void World::evalDeriv(Eigen::VectorXd& _deriv)
+{
+    mNumDerivEvals++;
+
     // compute contact forces
     mCollisionHandle->computeConstraintForces();
 
-    // compute derivatives for integration
-    Eigen::VectorXd deriv = Eigen::VectorXd::Zero(mIndices.back() * 2);
+    // compute derivatives for integration, each skeleton writing its own
+    // segments
+    _deriv.setZero(mIndices.back() * 2);
 
-    for (unsigned int i = 0; i < getNumSkeletons(); i++)
+    int numSkeletons = getNumSkeletons();
+    int numThreads = std::max(1, std::min(mNumThreads, numSkeletons));
+    if (numThreads == 1)
     {
-        // skip immobile objects in forward simulation
-        if (mSkeletons[i]->getImmobileState())
-            continue;
-        int start = mIndices[i] * 2;
-        int size = getSkeleton(i)->getNumDofs();
+        for (int i = 0; i < numSkeletons; i++)
+            evalSkeletonDeriv(i, _deriv);
+    }
+    else
+    {
+#pragma omp parallel for schedule(dynamic, 1) num_threads(numThreads)
+        for (int i = 0; i < numSkeletons; i++)
+            evalSkeletonDeriv(i, _deriv);
+    }
+}
 
-        Eigen::VectorXd qddot = mSkeletons[i]->getInvMassMatrix()
-                                * (-mSkeletons[i]->getCombinedVector()
-                                   + mSkeletons[i]->getExternalForces()
-                                   + mSkeletons[i]->getInternalForces()
-                                   + mCollisionHandle->getTotalConstraintForce(i)
-                                   );
-        
-        // set velocities
-        deriv.segment(start, size) = getSkeleton(i)->getPoseVelocity() + (qddot * mTimeStep);
-
-        // set qddot (accelerations)
-        deriv.segment(start + size, size) = qddot;
+////////////////////////////////////////////////////////////////////////////////
+void World::evalSkeletonDeriv(int _index, Eigen::VectorXd& _deriv)
+{
+    // skip immobile and sleeping objects in forward simulation
+    if (mSkeletons[_index]->getImmobileState() || mSkeletons[_index]->isAsleep())
+        return;
+    int start = mIndices[_index] * 2;
+    int size = getSkeleton(_index)->getNumDofs();
+
+    // sum the generalized forces into the workspace of the skeleton, so
+    // that a step allocates nothing once the workspaces are sized
+    Eigen::VectorXd& forces = mForces[_index];
+    Eigen::VectorXd& qddot = mAccs[_index];
+    forces = mSkeletons[_index]->getExternalForces();
+    forces += mSkeletons[_index]->getInternalForces();
+    forces += mSkeletons[_index]->getPDForces();
+    forces += mCollisionHandle->getTotalConstraintForce(_index);
+    if (mUseArticulatedBody)
+    {
+        // external forces were already converted to generalized forces
+        // in setState
+        mSkeletons[_index]->computeForwardDynamics(
+                    mGravity, mSkeletons[_index]->getPoseVelocity(), forces,
+                    qddot);
+    }
+    else
+    {
+        forces -= mSkeletons[_index]->getCombinedVector();
+        mSkeletons[_index]->solveMassMatrix(forces, qddot);
     }
 
-    return deriv;
+    // set velocities; the fixed-step integrator takes the velocities at the
+    // end of the step (semi-implicit Euler), the adaptive one needs the
+    // exact derivatives
+    double velocityStep = mAdaptiveTimeStep ? 0.0 : mTimeStep;
+    _deriv.segment(start, size) = getSkeleton(_index)->getPoseVelocity() + (qddot * velocityStep);
+
+    // set qddot (accelerations)
+    _deriv.segment(start + size, size) = qddot;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -258,6 +550,11 @@ bool World::addSkeleton(dynamics::SkeletonDynamics* _skeleton)
     //--------------------------------------------------------------------------
     mSkeletons.push_back(_skeleton);
     _skeleton->initDynamics();
+    mPoses.push_back(Eigen::VectorXd::Zero(_skeleton->getNumDofs()));
+    mVels.push_back(Eigen::VectorXd::Zero(_skeleton->getNumDofs()));
+    mForces.push_back(Eigen::VectorXd::Zero(_skeleton->getNumDofs()));
+    mAccs.push_back(Eigen::VectorXd::Zero(_skeleton->getNumDofs()));
+    mRestTimes.push_back(0.0);
 
     // Indices update
     mIndices.push_back(mIndices.back() + _skeleton->getNumDofs());
@@ -49,6 +49,7 @@
 
 #include "integration/EulerIntegrator.h"
 #include "integration/RK4Integrator.h"
+#include "integration/DormandPrinceIntegrator.h"
 #include "dynamics/SkeletonDynamics.h"
 #include "utils/Deprecated.h"
 //#include "utils/Console.h"
@@ -78,12 +79,29 @@ public:
     void reset();
 
     /// @brief Calculate the dynamics and integrate the world for one step.
+    ///
+    /// In adaptive mode, the step is the largest one that meets the
+    /// tolerance, starting from the size suggested by the previous step.
     void step();
 
     /// @brief Calculate the dynamics and integrate the world for one step.
+    ///
+    /// In adaptive mode, the world is advanced by exactly _timeStep in as
+    /// many adaptive steps as needed.
     /// @param[in] _timeStep The time step.
     void step(double _timeStep);
 
+    /// @brief Calculate the dynamics and integrate the world for one step
+    /// in place on _state, e.g. a column of a matrix holding the states of
+    /// many worlds.
+    ///
+    /// The fixed step is the one of step() with _state as the state vector
+    /// of the integrator. In adaptive mode, the world takes one step() and
+    /// its state is written to _state.
+    /// @param[in,out] _state The current state of the world, as from
+    /// getState; the new state on return.
+    void step(Eigen::Map<Eigen::VectorXd> _state);
+
     /// @brief Calculate the dynamics and integrate the world for multiple
     /// steps.
     /// @param[in] _steps The number of steps to proceed.
@@ -104,6 +122,125 @@ public:
     /// @brief Get the time step.
     inline double getTimeStep(void) const { return mTimeStep; }
 
+    /// @brief Select how the accelerations of the skeletons are computed.
+    ///
+    /// If true, the accelerations are computed by the articulated body
+    /// algorithm and the mass matrix and its inverse are only built when
+    /// the constraint solver needs them, i.e. when there are contacts, joint
+    /// limits or constraints. Otherwise, qddot = MInv * (...) is used.
+    /// @param[in] _useABA
+    inline void setUseArticulatedBody(bool _useABA) { mUseArticulatedBody = _useABA; }
+
+    /// @brief Whether the articulated body algorithm is used.
+    inline bool getUseArticulatedBody(void) const { return mUseArticulatedBody; }
+
+    /// @brief Select how the PD servos of the skeletons are integrated.
+    ///
+    /// If true, the servo forces are those of a linearized backward Euler
+    /// step (see SkeletonDynamics::computePDForces), which stays stable for
+    /// high gains at large time steps. Otherwise they are evaluated
+    /// explicitly at the current state.
+    /// @param[in] _implicit
+    inline void setUseImplicitPD(bool _implicit) { mUseImplicitPD = _implicit; }
+
+    /// @brief Whether the PD servos are integrated implicitly.
+    inline bool getUseImplicitPD(void) const { return mUseImplicitPD; }
+
+    /// @brief Set the number of threads that evaluate the skeletons in
+    /// setState and evalDeriv; 1 (the default) evaluates them serially.
+    ///
+    /// Only the per-skeleton kinematics and dynamics run in parallel; the
+    /// constraint solver that couples the skeletons does not, and the result
+    /// does not depend on the number of threads.
+    inline void setNumThreads(int _num) { mNumThreads = _num > 0 ? _num : 1; }
+
+    /// @brief Get the number of threads that evaluate the skeletons.
+    inline int getNumThreads() const { return mNumThreads; }
+
+    /// @brief Select automatic sleeping of the skeletons at rest (off by
+    /// default).
+    ///
+    /// A skeleton whose generalized velocities all stay below the sleep
+    /// velocity for the sleep time is put to sleep: its velocities are set
+    /// to zero, its dynamics are no longer computed and its bodies are not
+    /// checked for collision against other sleeping or immobile bodies. It
+    /// is woken when an awake skeleton touches it or when a force is applied
+    /// to it by BodyNodeDynamics::addExtForce. Turning sleeping off wakes all
+    /// the skeletons.
+    /// @param[in] _sleeping
+    void setSleeping(bool _sleeping);
+
+    /// @brief Whether the skeletons at rest are put to sleep.
+    inline bool getSleeping(void) const { return mSleeping; }
+
+    /// @brief Set how slow and for how long a skeleton has to move before it
+    /// is put to sleep.
+    /// @param[in] _velocity Bound on the absolute value of every generalized
+    /// velocity.
+    /// @param[in] _time
+    inline void setSleepThreshold(double _velocity, double _time)
+    { mSleepVelocity = _velocity; mSleepTime = _time; }
+
+    /// @brief
+    inline double getSleepVelocity(void) const { return mSleepVelocity; }
+
+    /// @brief
+    inline double getSleepTime(void) const { return mSleepTime; }
+
+    /// @brief Get the number of sleeping skeletons.
+    int getNumSleepingSkeletons(void) const;
+
+    /// @brief Select adaptive time stepping.
+    ///
+    /// If true, the world is integrated by the Dormand-Prince 5(4) pair and
+    /// the step size is adapted so that the estimated local error stays
+    /// within the tolerance. The derivatives are then the exact (qdot, qddot)
+    /// and the PD servos are evaluated explicitly; the contact impulses are
+    /// computed for each trial step size.
+    /// @param[in] _adaptive
+    void setAdaptiveTimeStep(bool _adaptive);
+
+    /// @brief Whether the time step is adapted.
+    inline bool getAdaptiveTimeStep(void) const { return mAdaptiveTimeStep; }
+
+    /// @brief Set the absolute and relative error tolerance of the adaptive
+    /// steps.
+    /// @param[in] _tolerance
+    inline void setTolerance(double _tolerance)
+    { mAdaptiveIntegrator.setTolerance(_tolerance, _tolerance); }
+
+    /// @brief Get the error tolerance of the adaptive steps.
+    inline double getTolerance(void) const
+    { return mAdaptiveIntegrator.getAbsTolerance(); }
+
+    /// @brief Set the range of the adaptive step sizes.
+    /// @param[in] _minTimeStep Steps of this size are accepted whatever
+    /// their error.
+    /// @param[in] _maxTimeStep
+    void setTimeStepRange(double _minTimeStep, double _maxTimeStep);
+
+    /// @brief Get the number of accepted steps since the statistics were
+    /// reset.
+    inline int getNumAcceptedSteps(void) const { return mNumAcceptedSteps; }
+
+    /// @brief Get the number of steps rejected for their error since the
+    /// statistics were reset.
+    inline int getNumRejectedSteps(void) const { return mNumRejectedSteps; }
+
+    /// @brief Get the number of evalDeriv calls since the statistics were
+    /// reset.
+    inline int getNumDerivEvals(void) const { return mNumDerivEvals; }
+
+    /// @brief Get the size of the last accepted step.
+    inline double getLastTimeStep(void) const { return mLastTimeStep; }
+
+    /// @brief Get the average size of the accepted steps since the
+    /// statistics were reset.
+    double getEffectiveTimeStep(void) const;
+
+    /// @brief Reset the step statistics.
+    void resetStepStatistics();
+
     inline void setTime(double _time) { mTime = _time; }
 
     /// @brief Get the time step.
@@ -137,12 +274,24 @@ public:
     // Documentation inherited.
     virtual Eigen::VectorXd getState();
 
+    // Documentation inherited.
+    virtual void getState(Eigen::VectorXd& _state);
+
+    /// @brief getState into storage of the size of the state.
+    void getState(Eigen::Map<Eigen::VectorXd> _state);
+
     // Documentation inherited.
     virtual void setState(const Eigen::VectorXd& _newState);
 
+    /// @brief setState from storage of the size of the state.
+    void setState(const Eigen::Map<const Eigen::VectorXd>& _newState);
+
     // Documentation inherited.
     virtual Eigen::VectorXd evalDeriv();
 
+    // Documentation inherited.
+    virtual void evalDeriv(Eigen::VectorXd& _deriv);
+
     /// @brief .
     /// @param[in] _skel
     bool addSkeleton(dynamics::SkeletonDynamics* _skeleton);
@@ -150,6 +299,24 @@ public:
     bool checkCollision(bool checkAllCollisions = false);
 
 protected:
+    /// @brief Take one adaptive step of at most _maxTimeStep.
+    /// @return The size of the accepted step.
+    double stepAdaptive(double _maxTimeStep);
+
+    /// @brief The part of setState for the indexed skeleton.
+    void setSkeletonState(int _index, const Eigen::Map<const Eigen::VectorXd>& _newState);
+
+    /// @brief The part of evalDeriv for the indexed skeleton.
+    void evalSkeletonDeriv(int _index, Eigen::VectorXd& _deriv);
+
+    /// @brief Update the velocities of the body nodes after a step and
+    /// advance the time.
+    void finishStep(double _timeStep);
+
+    /// @brief Advance the rest time of the awake skeletons by _timeStep and
+    /// put those at rest for the sleep time to sleep.
+    void updateSleeping(double _timeStep);
+
     /// @brief Skeletones in this world.
     std::vector<dynamics::SkeletonDynamics*> mSkeletons;
 
@@ -177,6 +344,66 @@ protected:
     /// @brief The simulated frame number.
     int mFrame;
 
+    /// @brief Whether the accelerations are computed by the articulated body
+    /// algorithm instead of the inverse mass matrix.
+    bool mUseArticulatedBody;
+
+    /// @brief Whether the PD servos are integrated implicitly.
+    bool mUseImplicitPD;
+
+    /// @brief The integrator of the adaptive steps.
+    integration::DormandPrinceIntegrator mAdaptiveIntegrator;
+
+    /// @brief Whether the time step is adapted.
+    bool mAdaptiveTimeStep;
+
+    /// @brief The smallest adaptive step.
+    double mMinTimeStep;
+
+    /// @brief The largest adaptive step.
+    double mMaxTimeStep;
+
+    /// @brief Size of the next adaptive step.
+    double mNextTimeStep;
+
+    /// @brief Step statistics.
+    int mNumAcceptedSteps;
+    int mNumRejectedSteps;
+    int mNumDerivEvals;
+    double mLastTimeStep;
+    double mAcceptedTime;
+
+    /// @brief The number of threads that evaluate the skeletons.
+    int mNumThreads;
+
+    /// @brief Pose of each skeleton in setState, kept between steps.
+    std::vector<Eigen::VectorXd> mPoses;
+
+    /// @brief Velocity of each skeleton in setState, kept between steps.
+    std::vector<Eigen::VectorXd> mVels;
+
+    /// @brief Generalized forces of each skeleton in evalDeriv.
+    std::vector<Eigen::VectorXd> mForces;
+
+    /// @brief Accelerations of each skeleton in evalDeriv.
+    std::vector<Eigen::VectorXd> mAccs;
+
+    /// @brief Derivative of the state in step(Eigen::Map), kept between
+    /// steps.
+    Eigen::VectorXd mDeriv;
+
+    /// @brief Whether the skeletons at rest are put to sleep.
+    bool mSleeping;
+
+    /// @brief
+    double mSleepVelocity;
+
+    /// @brief
+    double mSleepTime;
+
+    /// @brief How long each skeleton has been at rest.
+    std::vector<double> mRestTimes;
+
 private:
 };
 
@@ -0,0 +1,8 @@
+// This file is automatically generated from CMake
+#ifndef UTILS_PATHS_H
+#define UTILS_PATHS_H
+
+#define DART_ROOT_PATH "/root/repo/"
+#define DART_DATA_PATH "/root/repo/data/"
+
+#endif // ifndef UTILS_PATHS_H
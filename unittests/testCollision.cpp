@@ -42,6 +42,11 @@
 #include "fcl/shape/geometric_shapes.h"
 #include "fcl/narrowphase/narrowphase.h"
 
+#include "collision/fcl/FCLCollisionDetector.h"
+#include "collision/fcl_mesh/FCLMESHCollisionDetector.h"
+#include "collision/fcl_mesh/FCLMESHCollisionNode.h"
+#include "TestHelpers.h"
+
 class COLLISION : public testing::Test
 {
 public:
@@ -271,6 +276,156 @@ TEST_F(COLLISION, SPHERE_SPHERE_Z) {
 //	unrotatedTest(&obj1, &obj2, 0.0, 2); // x-axis
 //}
 
+/* ********************************************************************************************* */
+/// Creates a skeleton with a single box at the given position that can rotate about z
+SkeletonDynamics* createBox(const Vector3d& _pos, const Vector3d& _dim) {
+	SkeletonDynamics* skel = new SkeletonDynamics();
+	BodyNodeDynamics* node = (BodyNodeDynamics*) skel->createBodyNode("box");
+	Joint* joint = new Joint(NULL, node, "joint");
+	add_XyzRpy(joint, _pos(0), _pos(1), _pos(2), 0.0, 0.0, 0.0);
+	add_DOF(skel, joint, 0.0, -M_PI, M_PI, DOF_YAW);
+	Shape* shape = new ShapeBox(_dim);
+	node->setVisualizationShape(shape);
+	node->setCollisionShape(shape);
+	node->setMass(1.0);
+	skel->addNode(node);
+	skel->initSkel();
+	skel->setPose(VectorXd::Zero(1));
+	return skel;
+}
+
+TEST_F(COLLISION, BROADPHASE) {
+	// A row of boxes where only the neighbors overlap
+	const int numBoxes = 10;
+	std::vector<SkeletonDynamics*> boxes;
+	collision::FCLMESHCollisionDetector detector;
+	for (int i = 0; i < numBoxes; i++) {
+		boxes.push_back(createBox(Vector3d(0.4 * i, 0.0, 0.0), Vector3d(0.5, 0.5, 0.5)));
+		detector.addCollisionSkeletonNode(boxes.back()->getNode(0));
+	}
+
+	detector.checkCollision(true, true);
+	EXPECT_EQ(detector.getNumOverlappingPairs(), numBoxes - 1);
+	EXPECT_EQ(detector.getNumBroadPhasePairs(), numBoxes - 1);
+
+	// The narrowphase of all pairs finds the same contacts
+	int numContacts = 0;
+	for (int i = 0; i < numBoxes; i++) {
+		for (int j = i + 1; j < numBoxes; j++) {
+			std::vector<collision::Contact> contacts;
+			numContacts += detector.getCollisionSkeletonNode(boxes[i]->getNode(0))->checkCollision(
+				detector.getCollisionSkeletonNode(boxes[j]->getNode(0)), &contacts, 100);
+		}
+	}
+	EXPECT_EQ(detector.getNumTriangleIntersection(), numContacts);
+
+	// Inactive pairs are not passed on to the narrowphase
+	detector.deactivatePair(boxes[0]->getNode(0), boxes[1]->getNode(0));
+	detector.checkCollision(true, true);
+	EXPECT_EQ(detector.getNumOverlappingPairs(), numBoxes - 1);
+	EXPECT_EQ(detector.getNumBroadPhasePairs(), numBoxes - 2);
+
+	// Turning the last box grows its bounding box
+	boxes[numBoxes - 1]->setPose(VectorXd::Constant(1, M_PI / 4.0));
+	detector.checkCollision(true, true);
+	Vector3d extent = detector.getCollisionSkeletonNode(boxes[numBoxes - 1]->getNode(0))->getWorldAABBMax()
+		- detector.getCollisionSkeletonNode(boxes[numBoxes - 1]->getNode(0))->getWorldAABBMin();
+	EXPECT_NEAR(extent(0), 0.5 * sqrt(2.0), 1e-6);
+	EXPECT_EQ(detector.getNumOverlappingPairs(), numBoxes - 1);
+}
+
+TEST_F(COLLISION, PARALLEL_NARROWPHASE) {
+	// A pile of boxes touching their neighbors, checked serially and with several threads
+	collision::FCLCollisionDetector serial;
+	collision::FCLCollisionDetector parallel;
+	parallel.setNumThreads(4);
+	for (int i = 0; i < 4; i++) {
+		for (int j = 0; j < 4; j++) {
+			for (int k = 0; k < 3; k++) {
+				SkeletonDynamics* box = createBox(Vector3d(0.4 * i, 0.4 * j, 0.4 * k), Vector3d(0.5, 0.5, 0.5));
+				serial.addCollisionSkeletonNode(box->getNode(0));
+				parallel.addCollisionSkeletonNode(box->getNode(0));
+			}
+		}
+	}
+
+	serial.checkCollision(true, true);
+	parallel.checkCollision(true, true);
+	EXPECT_GT(serial.getNumContacts(), 0);
+	ASSERT_EQ(serial.getNumContacts(), parallel.getNumContacts());
+	for (unsigned int i = 0; i < serial.getNumContacts(); i++) {
+		const collision::Contact& contact1 = serial.getContact(i);
+		const collision::Contact& contact2 = parallel.getContact(i);
+		EXPECT_EQ(contact1.collisionNode1->getBodyNode(), contact2.collisionNode1->getBodyNode());
+		EXPECT_EQ(contact1.collisionNode2->getBodyNode(), contact2.collisionNode2->getBodyNode());
+		EXPECT_TRUE(contact1.point == contact2.point);
+		EXPECT_TRUE(contact1.normal == contact2.normal);
+		EXPECT_EQ(contact1.penetrationDepth, contact2.penetrationDepth);
+	}
+}
+
+TEST_F(COLLISION, CONTACT_MANIFOLD) {
+	// A face contact sampled on a grid, with every point reported twice
+	std::vector<collision::Contact> contacts;
+	collision::Contact contact;
+	contact.normal = Vector3d(0.0, 0.0, 1.0);
+	for (int i = 0; i <= 10; i++) {
+		for (int j = 0; j <= 10; j++) {
+			contact.point = Vector3d(0.1 * i, 0.05 * j, 0.2);
+			contacts.push_back(contact);
+			contact.point += Vector3d(1e-8, 0.0, 0.0);
+			contacts.push_back(contact);
+		}
+	}
+
+	collision::removeDuplicateContacts(&contacts, 1e-6);
+	EXPECT_EQ(contacts.size(), 121u);
+
+	// Dense random points, many of them sharing hash buckets, keep the same
+	// contacts as the quadratic filter
+	std::vector<collision::Contact> randomContacts;
+	for (int i = 0; i < 500; i++) {
+		contact.point = Vector3d(math::random(-0.1, 0.1), math::random(-0.1, 0.1), math::random(-0.1, 0.1));
+		randomContacts.push_back(contact);
+	}
+	std::vector<collision::Contact> bruteForce;
+	for (unsigned int i = 0; i < randomContacts.size(); i++) {
+		bool duplicate = false;
+		for (unsigned int j = 0; j < bruteForce.size() && !duplicate; j++)
+			duplicate = (bruteForce[j].point - randomContacts[i].point).norm() < 0.02;
+		if (!duplicate)
+			bruteForce.push_back(randomContacts[i]);
+	}
+	collision::removeDuplicateContacts(&randomContacts, 0.02);
+	ASSERT_EQ(randomContacts.size(), bruteForce.size());
+	for (unsigned int i = 0; i < bruteForce.size(); i++)
+		EXPECT_TRUE(randomContacts[i].point == bruteForce[i].point);
+
+	// The manifold of the face is its four corners
+	collision::reduceContactManifold(&contacts, 4, 1e-6);
+	ASSERT_EQ(contacts.size(), 4u);
+	Vector3d min = contacts[0].point, max = contacts[0].point;
+	double area = 0.0;
+	for (int i = 0; i < 4; i++) {
+		min = min.cwiseMin(contacts[i].point);
+		max = max.cwiseMax(contacts[i].point);
+		area += 0.5 * contacts[i].point.cross(contacts[(i + 1) % 4].point).dot(contact.normal);
+	}
+	EXPECT_TRUE(equals(min, Vector3d(0.0, 0.0, 0.2)));
+	EXPECT_TRUE(equals(max, Vector3d(1.0, 0.5, 0.2)));
+	EXPECT_NEAR(fabs(area), 0.5, 1e-6);
+
+	// Collinear contacts reduce to the end points
+	contacts.clear();
+	for (int i = 0; i < 5; i++) {
+		contact.point = Vector3d(0.1 * i, 0.0, 0.0);
+		contacts.push_back(contact);
+	}
+	collision::reduceContactManifold(&contacts, 4, 1e-6);
+	ASSERT_EQ(contacts.size(), 2u);
+	EXPECT_NEAR(fabs(contacts[0].point(0) - contacts[1].point(0)), 0.4, 1e-10);
+}
+
 /* ********************************************************************************************* */
 int main(int argc, char* argv[]) {
     ::testing::InitGoogleTest(&argc, argv);
@@ -34,12 +34,14 @@
 
 #include "dynamics/BodyNodeDynamics.h"
 #include "dynamics/SkeletonDynamics.h"
+#include "dynamics/BatchDynamics.h"
 #include "kinematics/FileInfoSkel.hpp"
 #include "kinematics/FileInfoDof.h"
 #include "kinematics/BodyNode.h"
 #include "utils/Paths.h"
 #include "math/UtilsRotation.h"
 #include "math/UtilsMath.h"
+#include "lcpsolver/LCPSolver.h"
 #include <iostream>
 #include <Eigen/Dense>
 #include <iostream>
@@ -271,6 +273,7 @@ TEST(DYNAMICS, COMPARE_MASS) {
 
     // test/compare the dynamics result for both methods
     // test the mass matrix
+    skelDyn->setUseCRBA(false); // assemble the mass matrix from the Jacobians
     skelDyn->computeDynamics(gravity, qdot, true); // compute dynamics by using inverse dynamics
     MatrixXd Minvdyn( skelDyn->getMassMatrix() );
     skelDyn->computeDynamics(gravity, qdot, false); // compute dynamics by NOT using inverse dynamics: use regular dynamics
@@ -281,6 +284,20 @@ TEST(DYNAMICS, COMPARE_MASS) {
             EXPECT_NEAR(Minvdyn(ki,kj), Mregular(ki,kj), TOLERANCE_EXACT);
         }
     }
+
+    // test the composite rigid body algorithm against the Jacobian assembly
+    skelDyn->setUseCRBA(true);
+    skelDyn->computeDynamics(gravity, qdot, true);
+    MatrixXd Mcrba( skelDyn->getMassMatrix() );
+    skelDyn->computeDynamics(gravity, qdot, false);
+    MatrixXd McrbaRegular( skelDyn->getMassMatrix() );
+
+    for(int ki=0; ki<Minvdyn.rows(); ki++){
+        for(int kj=0; kj<Minvdyn.cols(); kj++){
+            EXPECT_NEAR(Minvdyn(ki,kj), Mcrba(ki,kj), TOLERANCE_EXACT);
+            EXPECT_NEAR(Minvdyn(ki,kj), McrbaRegular(ki,kj), TOLERANCE_EXACT);
+        }
+    }
 }
 
 
@@ -368,6 +385,590 @@ TEST(DYNAMICS, COMPARE_JOINT_TOQUE_W_EXTERNAL_FORCES) {
 		EXPECT_NEAR(Cginvdyn(i), 0.0, TOLERANCE_EXACT);
 }
 
+/* ********************************************************************************************* */
+TEST(DYNAMICS, COMPARE_FORWARD_DYNAMICS) {
+    using namespace std;
+    using namespace Eigen;
+    using namespace kinematics;
+    using namespace dynamics;
+
+    const double TOLERANCE_EXACT = 1.0e-8;
+    Vector3d gravity(0.0, -9.81, 0.0);
+
+    VectorXd q, qdot;
+    SkeletonDynamics* skelDyn = prepareSkeleton(q, qdot);
+    skelDyn->setPose(q, true, true);
+
+    VectorXd tau = VectorXd::Zero(skelDyn->getNumDofs());
+    for(int i=0; i<skelDyn->getNumDofs(); i++)
+        tau[i] = math::random(-10.0, 10.0);
+
+    // accelerations using the inverse of the mass matrix
+    addExternalForces(skelDyn);
+    skelDyn->computeDynamics(gravity, qdot, true);
+    VectorXd qddotMInv = skelDyn->getInvMassMatrix() * (tau - skelDyn->getCombinedVector() + skelDyn->getExternalForces());
+
+    // accelerations using the articulated body algorithm
+    addExternalForces(skelDyn);
+    VectorXd qddotABA = skelDyn->computeForwardDynamics(gravity, qdot, tau, true);
+
+    for(int i=0; i<skelDyn->getNumDofs(); i++)
+        EXPECT_NEAR(qddotMInv(i), qddotABA(i), TOLERANCE_EXACT);
+}
+
+/* ********************************************************************************************* */
+TEST(DYNAMICS, HYBRID_DYNAMICS) {
+    using namespace std;
+    using namespace Eigen;
+    using namespace kinematics;
+    using namespace dynamics;
+
+    const double TOLERANCE_EXACT = 1.0e-8;
+    Vector3d gravity(0.0, -9.81, 0.0);
+
+    VectorXd q, qdot;
+    SkeletonDynamics* skelDyn = prepareSkeleton(q, qdot);
+    skelDyn->setPose(q, true, true);
+    int nDof = skelDyn->getNumDofs();
+
+    // prescribe the root translation and every other dof after it
+    vector<bool> prescribed(nDof, false);
+    VectorXd qddot = VectorXd::Zero(nDof);
+    VectorXd tau = VectorXd::Zero(nDof);
+    for(int i=0; i<nDof; i++) {
+        prescribed[i] = i < 3 || i % 2 == 0;
+        if(prescribed[i])
+            qddot[i] = math::random(-10.0, 10.0);
+        else
+            tau[i] = math::random(-10.0, 10.0);
+    }
+    VectorXd qddotPrescribed = qddot;
+    VectorXd tauFree = tau;
+
+    addExternalForces(skelDyn);
+    skelDyn->computeHybridDynamics(gravity, qdot, prescribed, qddot, tau, true);
+    for(int i=0; i<nDof; i++) {
+        if(prescribed[i])
+            EXPECT_EQ(qddotPrescribed(i), qddot(i));
+        else
+            EXPECT_EQ(tauFree(i), tau(i));
+    }
+
+    // the completed accelerations and forces satisfy the equations of motion
+    addExternalForces(skelDyn);
+    VectorXd tauID = skelDyn->computeInverseDynamicsLinear(gravity, &qdot, &qddot, false, true);
+    for(int i=0; i<nDof; i++)
+        EXPECT_NEAR(tauID(i), tau(i), TOLERANCE_EXACT);
+
+    // with no dof prescribed it is the forward dynamics
+    prescribed.assign(nDof, false);
+    qddot.setZero();
+    VectorXd qddotABA = skelDyn->computeForwardDynamics(gravity, qdot, tauFree);
+    skelDyn->computeHybridDynamics(gravity, qdot, prescribed, qddot, tauFree);
+    for(int i=0; i<nDof; i++)
+        EXPECT_NEAR(qddotABA(i), qddot(i), TOLERANCE_EXACT);
+}
+
+/* ********************************************************************************************* */
+TEST(DYNAMICS, MASS_MATRIX_FACTORIZATION) {
+    using namespace std;
+    using namespace Eigen;
+    using namespace kinematics;
+    using namespace dynamics;
+
+    const double TOLERANCE_EXACT = 1.0e-8;
+    Vector3d gravity(0.0, -9.81, 0.0);
+
+    VectorXd q, qdot;
+    SkeletonDynamics* skelDyn = prepareSkeleton(q, qdot);
+    skelDyn->setPose(q, true, true);
+    skelDyn->computeDynamics(gravity, qdot, true, false);
+
+    int nDof = skelDyn->getNumDofs();
+    MatrixXd M = skelDyn->getMassMatrix();
+    VectorXd v(nDof);
+    MatrixXd B(nDof, 3);
+    for(int i=0; i<nDof; i++) {
+        v[i] = math::random(-1.0, 1.0);
+        for(int j=0; j<3; j++)
+            B(i, j) = math::random(-1.0, 1.0);
+    }
+
+    VectorXd x = skelDyn->solveMassMatrix(v);
+    VectorXd xDense = M.ldlt().solve(v);
+    for(int i=0; i<nDof; i++)
+        EXPECT_NEAR(x(i), xDense(i), TOLERANCE_EXACT);
+
+    MatrixXd X = skelDyn->solveMassMatrixMultiple(B);
+    MatrixXd XDense = M.ldlt().solve(B);
+    for(int i=0; i<nDof; i++)
+        for(int j=0; j<3; j++)
+            EXPECT_NEAR(X(i, j), XDense(i, j), TOLERANCE_EXACT);
+}
+
+/* ********************************************************************************************* */
+TEST(DYNAMICS, TASK_DYNAMICS) {
+    using namespace std;
+    using namespace Eigen;
+    using namespace kinematics;
+    using namespace dynamics;
+
+    const double TOLERANCE_EXACT = 1.0e-8;
+    const double TOLERANCE_APPROX = 1.0e-5;
+    Vector3d gravity(0.0, -9.81, 0.0);
+
+    VectorXd q, qdot;
+    SkeletonDynamics* skelDyn = prepareSkeleton(q, qdot);
+    vector<BodyNode*> nodes;
+    vector<Vector3d> offsets;
+    nodes.push_back(skelDyn->getNode(skelDyn->getNumNodes() - 1));
+    offsets.push_back(Vector3d(0.1, 0.05, -0.02));
+    nodes.push_back(skelDyn->getNode(skelDyn->getNumNodes() / 2));
+    offsets.push_back(Vector3d(0.0, 0.1, 0.0));
+
+    skelDyn->setPose(q, true, true);
+    skelDyn->computeDynamics(gravity, qdot, true, false, false);
+    skelDyn->computeTaskDynamics(nodes, offsets, true);
+    MatrixXd J = skelDyn->getTaskJacobian();
+    MatrixXd Lambda = skelDyn->getTaskInertia();
+    VectorXd JdotQdot = skelDyn->getTaskBiasAcceleration();
+    VectorXd bias = skelDyn->getTaskBiasForce();
+    ASSERT_EQ(J.rows(), 12);
+
+    // the point Jacobians agree with the kinematic ones
+    for(unsigned int k=0; k<nodes.size(); k++) {
+        MatrixXd Jk = skelDyn->getJacobian(nodes[k], offsets[k]);
+        for(int i=0; i<3; i++)
+            for(int j=0; j<skelDyn->getNumDofs(); j++)
+                EXPECT_NEAR(J(6 * k + i, j), Jk(i, j), TOLERANCE_EXACT);
+    }
+
+    // the dense operational space quantities
+    MatrixXd M = skelDyn->getMassMatrix();
+    MatrixXd LambdaInvDense = J * M.ldlt().solve(J.transpose());
+    MatrixXd LambdaDense = LambdaInvDense.inverse();
+    VectorXd biasDense = LambdaDense * (J * M.ldlt().solve(skelDyn->getCombinedVector()) - JdotQdot);
+    EXPECT_TRUE((skelDyn->getTaskInvInertia() - LambdaInvDense).norm() < TOLERANCE_EXACT * LambdaInvDense.norm());
+    EXPECT_TRUE((Lambda - LambdaDense).norm() < TOLERANCE_EXACT * LambdaDense.norm());
+    EXPECT_TRUE((bias - biasDense).norm() < TOLERANCE_EXACT * biasDense.norm());
+
+    // Jdot*qdot by central differences of J along qdot
+    double h = 1.0e-6;
+    skelDyn->setPose(q + h * qdot, true, true);
+    skelDyn->computeDynamics(gravity, qdot, true, false, false);
+    skelDyn->computeTaskDynamics(nodes, offsets, true);
+    MatrixXd Jplus = skelDyn->getTaskJacobian();
+    skelDyn->setPose(q - h * qdot, true, true);
+    skelDyn->computeDynamics(gravity, qdot, true, false, false);
+    skelDyn->computeTaskDynamics(nodes, offsets, true);
+    MatrixXd Jminus = skelDyn->getTaskJacobian();
+    VectorXd JdotQdotApprox = (Jplus - Jminus) / (2.0 * h) * qdot;
+    for(int i=0; i<J.rows(); i++)
+        EXPECT_NEAR(JdotQdot[i], JdotQdotApprox[i], TOLERANCE_APPROX * JdotQdot.norm());
+}
+
+/* ********************************************************************************************* */
+TEST(DYNAMICS, CENTROIDAL_MOMENTUM) {
+    using namespace std;
+    using namespace Eigen;
+    using namespace kinematics;
+    using namespace dynamics;
+
+    const double TOLERANCE_EXACT = 1.0e-8;
+    const double TOLERANCE_APPROX = 1.0e-5;
+
+    VectorXd q, qdot;
+    SkeletonDynamics* skelDyn = prepareSkeleton(q, qdot);
+    skelDyn->setPose(q, true, true);
+    skelDyn->computeCentroidalMomentum(qdot);
+    VectorXd hG = skelDyn->getCentroidalMomentum();
+    VectorXd bias = skelDyn->getCentroidalMomentumBias();
+    ASSERT_EQ(skelDyn->getCentroidalMomentumMatrix().cols(), skelDyn->getNumDofs());
+
+    // sum of the momenta of the bodies about the center of mass
+    Vector3d com = skelDyn->getWorldCOM();
+    Vector3d ang = Vector3d::Zero();
+    Vector3d lin = Vector3d::Zero();
+    for(int i=0; i<skelDyn->getNumNodes(); i++) {
+        BodyNode* node = skelDyn->getNode(i);
+        VectorXd qdotLocal(node->getNumDependentDofs());
+        for(int j=0; j<node->getNumDependentDofs(); j++)
+            qdotLocal[j] = qdot[node->getDependentDof(j)];
+        Vector3d v = node->getJacobianLinear() * qdotLocal;
+        Vector3d w = node->getJacobianAngular() * qdotLocal;
+        lin += node->getMass() * v;
+        ang += node->getWorldInertia() * w + node->getMass() * (node->getWorldCOM() - com).cross(v);
+    }
+    for(int i=0; i<3; i++) {
+        EXPECT_NEAR(hG[i], ang[i], TOLERANCE_EXACT * hG.norm());
+        EXPECT_NEAR(hG[3 + i], lin[i], TOLERANCE_EXACT * hG.norm());
+    }
+
+    // the bias is the rate of change of the momentum at zero acceleration
+    double h = 1.0e-6;
+    skelDyn->setPose(q + h * qdot, true, true);
+    skelDyn->computeCentroidalMomentum(qdot);
+    VectorXd hPlus = skelDyn->getCentroidalMomentum();
+    skelDyn->setPose(q - h * qdot, true, true);
+    skelDyn->computeCentroidalMomentum(qdot);
+    VectorXd hMinus = skelDyn->getCentroidalMomentum();
+    VectorXd biasApprox = (hPlus - hMinus) / (2.0 * h);
+    for(int i=0; i<6; i++)
+        EXPECT_NEAR(bias[i], biasApprox[i], TOLERANCE_APPROX * bias.norm());
+}
+
+/* ********************************************************************************************* */
+// Analytical derivatives of the inverse and forward dynamics against central
+// differences at the state q, qdot
+void checkDynamicsDerivatives(dynamics::SkeletonDynamics* skelDyn, const Eigen::VectorXd& q, const Eigen::VectorXd& qdot) {
+    using namespace std;
+    using namespace Eigen;
+    using namespace kinematics;
+    using namespace dynamics;
+
+    const double TOLERANCE_APPROX = 1.0e-5;
+    const double TOLERANCE_APPROX_FORWARD = 1.0e-4; // M^{-1} amplifies the error of the differences
+    Vector3d gravity(0.0, -9.81, 0.0);
+
+    int nDofs = skelDyn->getNumDofs();
+    VectorXd qdd = VectorXd::Zero(nDofs);
+    VectorXd tau = VectorXd::Zero(nDofs);
+    for(int i=0; i<nDofs; i++){
+        qdd[i] = math::random(-5.0, 5.0);
+        tau[i] = math::random(-10.0, 10.0);
+    }
+
+    skelDyn->setPose(q, true, false);
+    skelDyn->computeInverseDynamicsDerivatives(gravity, qdot, qdd);
+    MatrixXd dtaudq = skelDyn->getTorqueDerivPose();
+    MatrixXd dtaudqdot = skelDyn->getTorqueDerivVelocity();
+    skelDyn->computeForwardDynamicsDerivatives(gravity, qdot, tau);
+    MatrixXd dqdddq = skelDyn->getAccelerationDerivPose();
+    MatrixXd dqdddqdot = skelDyn->getAccelerationDerivVelocity();
+    MatrixXd dqdddtau = skelDyn->getAccelerationDerivForce();
+
+    // central differences of the inverse and forward dynamics
+    double h = 1.0e-4;
+    MatrixXd dtaudqApprox(nDofs, nDofs), dtaudqdotApprox(nDofs, nDofs);
+    MatrixXd dqdddqApprox(nDofs, nDofs), dqdddqdotApprox(nDofs, nDofs), dqdddtauApprox(nDofs, nDofs);
+    for(int j=0; j<nDofs; j++){
+        VectorXd dq = VectorXd::Unit(nDofs, j) * h;
+        skelDyn->setPose(q + dq, true, false);
+        VectorXd tauPlus = skelDyn->computeInverseDynamicsLinear(gravity, &qdot, &qdd, false, false);
+        VectorXd qddPlus = skelDyn->computeForwardDynamics(gravity, qdot, tau);
+        skelDyn->setPose(q - dq, true, false);
+        VectorXd tauMinus = skelDyn->computeInverseDynamicsLinear(gravity, &qdot, &qdd, false, false);
+        VectorXd qddMinus = skelDyn->computeForwardDynamics(gravity, qdot, tau);
+        dtaudqApprox.col(j) = (tauPlus - tauMinus) / (2.0 * h);
+        dqdddqApprox.col(j) = (qddPlus - qddMinus) / (2.0 * h);
+
+        skelDyn->setPose(q, true, false);
+        VectorXd qdotPlus = qdot + dq;
+        VectorXd qdotMinus = qdot - dq;
+        VectorXd tauPlusPlus = tau + dq;
+        VectorXd tauMinusMinus = tau - dq;
+        dtaudqdotApprox.col(j) = (skelDyn->computeInverseDynamicsLinear(gravity, &qdotPlus, &qdd, false, false)
+                                  - skelDyn->computeInverseDynamicsLinear(gravity, &qdotMinus, &qdd, false, false)) / (2.0 * h);
+        dqdddqdotApprox.col(j) = (skelDyn->computeForwardDynamics(gravity, qdotPlus, tau)
+                                  - skelDyn->computeForwardDynamics(gravity, qdotMinus, tau)) / (2.0 * h);
+        dqdddtauApprox.col(j) = (skelDyn->computeForwardDynamics(gravity, qdot, tauPlusPlus)
+                                 - skelDyn->computeForwardDynamics(gravity, qdot, tauMinusMinus)) / (2.0 * h);
+    }
+
+    EXPECT_TRUE((dtaudq - dtaudqApprox).norm() < TOLERANCE_APPROX * dtaudq.norm());
+    EXPECT_TRUE((dtaudqdot - dtaudqdotApprox).norm() < TOLERANCE_APPROX * dtaudqdot.norm());
+    EXPECT_TRUE((dqdddq - dqdddqApprox).norm() < TOLERANCE_APPROX_FORWARD * dqdddq.norm());
+    EXPECT_TRUE((dqdddqdot - dqdddqdotApprox).norm() < TOLERANCE_APPROX_FORWARD * dqdddqdot.norm());
+    EXPECT_TRUE((dqdddtau - dqdddtauApprox).norm() < TOLERANCE_APPROX_FORWARD * dqdddtau.norm());
+}
+
+/* ********************************************************************************************* */
+TEST(DYNAMICS, DYNAMICS_DERIVATIVES) {
+    using namespace std;
+    using namespace Eigen;
+    using namespace kinematics;
+    using namespace dynamics;
+
+    // expmap ball and free joints, hinges
+    VectorXd q, qdot;
+    SkeletonDynamics* skelDyn = prepareSkeleton(q, qdot);
+    checkDynamicsDerivatives(skelDyn, q, qdot);
+
+    // chains of Euler axes
+    FileInfoSkel<SkeletonDynamics> skelFile;
+    bool loadModelResult = skelFile.loadFile(DART_DATA_PATH"skel/YutingEuler.skel", SKEL);
+    ASSERT_TRUE(loadModelResult);
+    SkeletonDynamics* skelEuler = static_cast<SkeletonDynamics*>(skelFile.getSkel());
+    skelEuler->initDynamics();
+    q = VectorXd::Zero(skelEuler->getNumDofs());
+    qdot = VectorXd::Zero(skelEuler->getNumDofs());
+    for(int i=0; i<skelEuler->getNumDofs(); i++){
+        q[i] = math::random(-1.0, 1.0);
+        qdot[i] = math::random(-5.0, 5.0);
+    }
+    checkDynamicsDerivatives(skelEuler, q, qdot);
+}
+
+/* ********************************************************************************************* */
+TEST(DYNAMICS, INVERSE_DYNAMICS_BATCH) {
+    using namespace std;
+    using namespace Eigen;
+    using namespace dynamics;
+
+    const double TOLERANCE_EXACT = 1.0e-10;
+    Vector3d gravity(0.0, -9.81, 0.0);
+    const int nFrames = 20;
+    const double timeStep = 1.0 / 120.0;
+
+    // two instances of the same model for two workers
+    VectorXd q, qdot;
+    vector<SkeletonDynamics*> workers;
+    workers.push_back(prepareSkeleton(q, qdot));
+    workers.push_back(prepareSkeleton(q, qdot));
+    int nDof = workers[0]->getNumDofs();
+
+    MatrixXd poses(nDof, nFrames);
+    for(int i=0; i<nFrames; i++)
+        poses.col(i) = q + i * timeStep * qdot;
+    for(int i=0; i<nFrames; i++)
+        for(int j=0; j<nDof; j++)
+            poses(j, i) += 0.01 * math::random(-1.0, 1.0);
+
+    MatrixXd torques;
+    computeInverseDynamicsBatch(workers, poses, timeStep, gravity, torques);
+    ASSERT_EQ(torques.rows(), nDof);
+    ASSERT_EQ(torques.cols(), nFrames - 2);
+
+    // frame by frame on a single skeleton
+    SkeletonDynamics* skel = workers[0];
+    for(int i=0; i<nFrames-2; i++) {
+        VectorXd qd = (poses.col(i + 1) - poses.col(i)) / timeStep;
+        VectorXd qdd = (poses.col(i + 2) - 2 * poses.col(i + 1) + poses.col(i)) / (timeStep * timeStep);
+        skel->setPose(poses.col(i), true, false);
+        VectorXd tau = skel->computeInverseDynamicsLinear(gravity, &qd, &qdd, false, false);
+        for(int j=0; j<nDof; j++)
+            EXPECT_NEAR(torques(j, i), tau[j], TOLERANCE_EXACT * max(1.0, fabs(tau[j])));
+    }
+}
+
+/* ********************************************************************************************* */
+TEST(DYNAMICS, CLONE) {
+    using namespace std;
+    using namespace Eigen;
+    using namespace dynamics;
+
+    Vector3d gravity(0.0, -9.81, 0.0);
+    const int nStates = 10;
+
+    VectorXd q, qdot;
+    SkeletonDynamics* skel = prepareSkeleton(q, qdot);
+    int nDof = skel->getNumDofs();
+    int nNodes = skel->getNumNodes();
+
+    vector<VectorXd> poses(nStates), vels(nStates);
+    for(int i=0; i<nStates; i++) {
+        poses[i] = VectorXd(nDof);
+        vels[i] = VectorXd(nDof);
+        for(int j=0; j<nDof; j++) {
+            poses[i][j] = math::random(-1.0, 1.0);
+            vels[i][j] = math::random(-5.0, 5.0);
+        }
+    }
+
+    // serial evaluation on the original skeleton
+    vector<MatrixXd> M(nStates), W(nStates);
+    vector<VectorXd> Cg(nStates);
+    for(int i=0; i<nStates; i++) {
+        skel->setPose(poses[i], true, true);
+        skel->computeDynamics(gravity, vels[i], true);
+        M[i] = skel->getMassMatrix();
+        Cg[i] = skel->getCombinedVector();
+        W[i] = MatrixXd(4, 4 * nNodes);
+        for(int j=0; j<nNodes; j++)
+            W[i].block(0, 4 * j, 4, 4) = skel->getNode(j)->getWorldTransform();
+    }
+
+    // a sleeping skeleton stays asleep in its clones
+    skel->setAsleep(true);
+    vector<SkeletonDynamics*> clones;
+    clones.push_back(skel->clone());
+    clones.push_back(skel->clone());
+    ASSERT_EQ(clones[0]->getNumDofs(), nDof);
+    ASSERT_EQ(clones[0]->getNumNodes(), nNodes);
+    EXPECT_EQ(clones[0]->getNumJoints(), skel->getNumJoints());
+    EXPECT_EQ(clones[0]->getNumMarkers(), skel->getNumMarkers());
+    EXPECT_EQ(clones[0]->getMass(), skel->getMass());
+    EXPECT_TRUE(clones[0]->getPose() == skel->getPose());
+    EXPECT_TRUE(clones[0]->isAsleep());
+    EXPECT_EQ(clones[0]->getImmobileState(), skel->getImmobileState());
+    // the clones must not depend on the original
+    delete skel;
+
+    // both clones evaluate all the states at the same time; the flags are
+    // ints, as the bits of a vector<bool> share words across the threads
+    vector<int> same(clones.size(), 1);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static, 1) num_threads(2)
+#endif
+    for(int k=0; k<(int)clones.size(); k++) {
+        SkeletonDynamics* clone = clones[k];
+        for(int i=0; i<nStates; i++) {
+            clone->setPose(poses[i], true, true);
+            clone->computeDynamics(gravity, vels[i], true);
+            bool sameState = clone->getMassMatrix() == M[i] && clone->getCombinedVector() == Cg[i];
+            for(int j=0; j<nNodes; j++)
+                sameState = sameState && clone->getNode(j)->getWorldTransform() == W[i].block(0, 4 * j, 4, 4);
+            same[k] = same[k] && sameState;
+        }
+    }
+    for(unsigned int k=0; k<clones.size(); k++) {
+        EXPECT_TRUE(same[k]);
+        delete clones[k];
+    }
+}
+
+/* ********************************************************************************************* */
+// A random contact LCP in the layout of ConstraintDynamics (normal forces,
+// tangent forces and the friction cone multipliers) with a unit mass matrix:
+// _A = _J * _J^T plus the friction cone rows. Shared by the LCP solver tests.
+void prepareContactLCP(int _nDof, int _nContacts, int _numDir, double _mu,
+                       Eigen::MatrixXd& _J, Eigen::MatrixXd& _A, Eigen::VectorXd& _b) {
+    using namespace Eigen;
+
+    int cd = _nContacts * _numDir;
+    int dim = _nContacts * (2 + _numDir);
+    _J = MatrixXd(_nContacts + cd, _nDof);
+    VectorXd v(_nDof);
+    for(int i=0; i<_nDof; i++) {
+        v[i] = math::random(-1.0, 1.0);
+        for(int j=0; j<_nContacts + cd; j++)
+            _J(j, i) = math::random(-1.0, 1.0);
+    }
+    _A = MatrixXd::Zero(dim, dim);
+    _b = VectorXd::Zero(dim);
+    _A.topLeftCorner(_nContacts + cd, _nContacts + cd) = _J * _J.transpose();
+    for(int i=0; i<_nContacts; i++) {
+        _A.block(_nContacts + i * _numDir, _nContacts + cd + i, _numDir, 1).setOnes();
+        _A.block(_nContacts + cd + i, _nContacts + i * _numDir, 1, _numDir).setConstant(-1.0);
+        _A(_nContacts + cd + i, i) = _mu;
+    }
+    for(int i=0; i<_nContacts + cd; i++)
+        _A(i, i) += 0.001 * _A(i, i);
+    _b.head(_nContacts + cd) = _J * v;
+    _b[0] = -1.0; // at least one approaching contact
+}
+
+/* ********************************************************************************************* */
+TEST(DYNAMICS, LCP_WARM_START) {
+    using namespace std;
+    using namespace Eigen;
+
+    const double TOLERANCE = 1.0e-6;
+    const int nDof = 12, nContacts = 3, numDir = 4;
+    const double mu = 0.8;
+    int dim = nContacts * (2 + numDir);
+
+    MatrixXd J, A;
+    VectorXd b;
+    prepareContactLCP(nDof, nContacts, numDir, mu, J, A, b);
+
+    lcpsolver::LCPSolver solver;
+    VectorXd xCold;
+    EXPECT_TRUE(solver.Solve(A, b, xCold, nContacts, mu, numDir, true));
+    int coldPivots = solver.getNumPivots();
+    EXPECT_GT(coldPivots, 0);
+
+    // starting from the cold solution
+    VectorXd xWarm = xCold;
+    EXPECT_TRUE(solver.Solve(A, b, xWarm, nContacts, mu, numDir, true, true));
+    EXPECT_LE(solver.getNumPivots(), coldPivots);
+    VectorXd w = A * xWarm + b;
+    for(int i=0; i<nContacts; i++) {
+        EXPECT_GE(xWarm[i], -TOLERANCE);
+        EXPECT_GE(w[i], -TOLERANCE);
+        EXPECT_NEAR(xWarm[i] * w[i], 0.0, TOLERANCE);
+    }
+
+    // a solution is accepted without pivoting
+    VectorXd xSolved = xWarm;
+    EXPECT_TRUE(solver.Solve(A, b, xSolved, nContacts, mu, numDir, true, true));
+    EXPECT_EQ(solver.getNumPivots(), 0);
+    for(int i=0; i<dim; i++)
+        EXPECT_NEAR(xSolved[i], xWarm[i], TOLERANCE);
+}
+
+/* ********************************************************************************************* */
+TEST(DYNAMICS, LCP_PGS) {
+    using namespace std;
+    using namespace Eigen;
+
+    const double TOLERANCE = 1.0e-5;
+    const int nDof = 12, nContacts = 3, numDir = 4;
+    const double mu = 0.8;
+    int dim = nContacts * (2 + numDir);
+
+    MatrixXd J, A;
+    VectorXd b;
+    prepareContactLCP(nDof, nContacts, numDir, mu, J, A, b);
+
+    // reference: the pivoting solve, refined by a warm start so that the
+    // friction bounds match the final normal forces
+    lcpsolver::LCPSolver solver;
+    VectorXd xRef;
+    solver.Solve(A, b, xRef, nContacts, mu, numDir, true);
+    solver.Solve(A, b, xRef, nContacts, mu, numDir, true, true);
+
+    // the same problem from the Jacobian alone
+    VectorXd x;
+    solver.setPGSParameters(10000, 1.0e-12, 1.0);
+    EXPECT_TRUE(solver.Solve(J, J.transpose(), b.head(J.rows()), x, nContacts, mu, numDir, 0.001));
+    EXPECT_GT(solver.getNumIterations(), 1);
+    ASSERT_EQ(x.size(), dim);
+    for(int i=0; i<dim; i++)
+        EXPECT_NEAR(x[i], xRef[i], TOLERANCE);
+
+    // over-relaxed
+    VectorXd xSOR;
+    solver.setPGSParameters(10000, 1.0e-12, 1.3);
+    EXPECT_TRUE(solver.Solve(J, J.transpose(), b.head(J.rows()), xSOR, nContacts, mu, numDir, 0.001));
+    for(int i=0; i<dim; i++)
+        EXPECT_NEAR(xSOR[i], xRef[i], TOLERANCE);
+
+    // a converged solution is a fixed point of one sweep
+    solver.setPGSParameters(10000, 1.0e-8, 1.0);
+    EXPECT_TRUE(solver.Solve(J, J.transpose(), b.head(J.rows()), x, nContacts, mu, numDir, 0.001, true));
+    EXPECT_EQ(solver.getNumIterations(), 1);
+}
+
+/* ********************************************************************************************* */
+TEST(DYNAMICS, LCP_WARM_START_WORK_REUSE) {
+    using namespace std;
+    using namespace Eigen;
+
+    const double TOLERANCE = 1.0e-6;
+    const int nContacts = 3, numDir = 4;
+    const double mu = 0.8;
+
+    // one solver keeps the work arrays of the warm start across solves:
+    // they grow for a larger problem and are reused by a smaller one
+    lcpsolver::LCPSolver solver;
+    for(int k=0; k<3; k++) {
+        int n = (k == 1 ? 2 : 1) * nContacts;
+        MatrixXd J, A;
+        VectorXd b;
+        prepareContactLCP(4 * n, n, numDir, mu, J, A, b);
+
+        VectorXd x;
+        EXPECT_TRUE(solver.Solve(A, b, x, n, mu, numDir, true));
+        EXPECT_TRUE(solver.Solve(A, b, x, n, mu, numDir, true, true));
+        VectorXd xSolved = x;
+        EXPECT_TRUE(solver.Solve(A, b, xSolved, n, mu, numDir, true, true));
+        EXPECT_EQ(solver.getNumPivots(), 0);
+        for(int i=0; i<x.size(); i++)
+            EXPECT_NEAR(xSolved[i], x[i], TOLERANCE);
+    }
+}
+
 /* ********************************************************************************************* */
 // TODO
 TEST(DYNAMICS, CONVERSION_VELOCITY) {
@@ -73,6 +73,68 @@ TEST(FORWARD_KINEMATICS, TWO_ROLLS) {
 	}
 }
 
+/* ********************************************************************************************* */
+TEST(FORWARD_KINEMATICS, INCREMENTAL_UPDATE) {
+
+	// Create the world: link1 -> link2 -> link3 -> ee
+	SkeletonDynamics* robot = createThreeLinkRobot(Vector3d(0.3, 0.3, 1.0), DOF_YAW, Vector3d(0.3, 0.3, 1.0),
+		DOF_ROLL, Vector3d(0.3, 0.3, 1.0), DOF_ROLL);
+	BodyNode* ee = robot->getNode("ee");
+
+	robot->setPose(Vector3d(0.1, 0.2, 0.3));
+	ee->getJacobianLinear();
+	robot->resetUpdateCounters();
+
+	// Setting the same values again does not update anything
+	robot->setPose(Vector3d(0.1, 0.2, 0.3));
+	EXPECT_EQ(robot->getNumTransformUpdates(), 0);
+
+	// Changing the last joint only updates link3 and ee; the derivatives wait until they are needed
+	vector<int> lastJoint(1, 2);
+	robot->setConfig(lastJoint, VectorXd::Constant(1, -0.4));
+	EXPECT_EQ(robot->getNumTransformUpdates(), 2);
+	EXPECT_EQ(robot->getNumDerivUpdates(), 0);
+	MatrixXd J = ee->getJacobianLinear();
+	EXPECT_EQ(robot->getNumDerivUpdates(), 2);
+
+	// Compare against a full update
+	for(int i = 0; i < robot->getNumNodes(); i++) {
+		robot->getNode(i)->updateTransform();
+		robot->getNode(i)->updateFirstDerivatives();
+	}
+	EXPECT_TRUE(equals(J, ee->getJacobianLinear(), 1e-10));
+}
+
+/* ********************************************************************************************* */
+TEST(FORWARD_KINEMATICS, DEFERRED_UPDATE) {
+
+	// Create the world: link1 -> link2 -> link3 -> ee
+	SkeletonDynamics* robot = createThreeLinkRobot(Vector3d(0.3, 0.3, 1.0), DOF_YAW, Vector3d(0.3, 0.3, 1.0),
+		DOF_ROLL, Vector3d(0.3, 0.3, 1.0), DOF_ROLL);
+	BodyNode* ee = robot->getNode("ee");
+
+	robot->setPose(Vector3d(0.1, 0.2, 0.3));
+	MatrixXd JvBefore = ee->getJacobianLinear();
+	MatrixXd JwBefore = ee->getJacobianAngular();
+
+	// Changing the root dof without updating the transforms only marks link1;
+	// the Jacobians of the leaf must still follow it
+	robot->setPose(Vector3d(0.7, 0.2, 0.3), false);
+	EXPECT_FALSE(ee->isTransformDirty());
+	MatrixXd Jv = ee->getJacobianLinear();
+	MatrixXd Jw = ee->getJacobianAngular();
+	EXPECT_FALSE(equals(Jv, JvBefore, 1e-10));
+	EXPECT_FALSE(equals(Jw, JwBefore, 1e-10));
+
+	// Compare against a full update
+	for(int i = 0; i < robot->getNumNodes(); i++) {
+		robot->getNode(i)->updateTransform();
+		robot->getNode(i)->updateFirstDerivatives();
+	}
+	EXPECT_TRUE(equals(Jv, ee->getJacobianLinear(), 1e-10));
+	EXPECT_TRUE(equals(Jw, ee->getJacobianAngular(), 1e-10));
+}
+
 /* ********************************************************************************************* */
 int main(int argc, char* argv[]) {
 
@@ -0,0 +1,243 @@
+/*
+ * Copyright (c) 2011, Georgia Tech Research Corporation
+ * All rights reserved.
+ *
+ * Geoorgia Tech Graphics Lab and Humanoid Robotics Lab
+ *
+ * Directed by Prof. C. Karen Liu and Prof. Mike Stilman
+ * <karenliu@cc.gatech.edu> <mstilman@cc.gatech.edu>
+ *
+ * This file is provided under the following "BSD-style" License:
+ *   Redistribution and use in source and binary forms, with or
+ *   without modification, are permitted provided that the following
+ *   conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *   CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *   INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *   MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ *   USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ *   AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *   LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *   ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *   POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "integration/EulerIntegrator.h"
+#include "integration/RK4Integrator.h"
+#include "integration/DormandPrinceIntegrator.h"
+#include "simulation/World.h"
+#include "dynamics/SkeletonDynamics.h"
+#include "kinematics/FileInfoSkel.hpp"
+#include "utils/Paths.h"
+#include <cstdlib>
+#include <iostream>
+#include <Eigen/Dense>
+#include <gtest/gtest.h>
+
+using namespace std;
+
+/* ********************************************************************************************* */
+// Heap allocations are counted while gCountAllocations is set. Eigen
+// allocates with malloc, so malloc itself is interposed, which only works
+// with glibc. Elsewhere nothing would be counted and the checks would pass
+// vacuously, so they are skipped.
+#ifdef __GLIBC__
+static bool gCountAllocations = false;
+static int gNumAllocations = 0;
+
+extern "C" {
+void* __libc_malloc(size_t);
+void* __libc_calloc(size_t, size_t);
+void* __libc_realloc(void*, size_t);
+
+void* malloc(size_t _size) {
+    if (gCountAllocations) gNumAllocations++;
+    return __libc_malloc(_size);
+}
+
+void* calloc(size_t _num, size_t _size) {
+    if (gCountAllocations) gNumAllocations++;
+    return __libc_calloc(_num, _size);
+}
+
+void* realloc(void* _ptr, size_t _size) {
+    if (gCountAllocations) gNumAllocations++;
+    return __libc_realloc(_ptr, _size);
+}
+}
+#else
+static void skipAllocationChecks(const char* _what) {
+    cout << "[  SKIPPED ] " << _what << ": heap allocations are only counted with glibc" << endl;
+}
+#endif
+
+/* ********************************************************************************************* */
+// Damped springs: x'' = -k*x - d*x'; the state is [x; x']
+class SpringSystem : public integration::IntegrableSystem {
+public:
+    SpringSystem(int _n) : mState(Eigen::VectorXd::Zero(2 * _n)) {
+        for (int i = 0; i < 2 * _n; i++)
+            mState[i] = 0.1 * (i + 1);
+    }
+    virtual Eigen::VectorXd getState() { return mState; }
+    virtual void setState(const Eigen::VectorXd& _state) { mState = _state; }
+    virtual Eigen::VectorXd evalDeriv() {
+        int n = mState.size() / 2;
+        Eigen::VectorXd deriv(2 * n);
+        deriv.head(n) = mState.tail(n);
+        deriv.tail(n) = -4.0 * mState.head(n) - 0.5 * mState.tail(n);
+        return deriv;
+    }
+protected:
+    Eigen::VectorXd mState;
+};
+
+// The same system through the in-place interface
+class SpringSystemInPlace : public SpringSystem {
+public:
+    SpringSystemInPlace(int _n) : SpringSystem(_n) {}
+    virtual Eigen::VectorXd getState() { return mState; }
+    virtual void getState(Eigen::VectorXd& _state) { _state = mState; }
+    virtual Eigen::VectorXd evalDeriv() { return SpringSystem::evalDeriv(); }
+    virtual void evalDeriv(Eigen::VectorXd& _deriv) {
+        int n = mState.size() / 2;
+        _deriv.resize(2 * n);
+        _deriv.head(n) = mState.tail(n);
+        _deriv.tail(n) = -4.0 * mState.head(n) - 0.5 * mState.tail(n);
+    }
+};
+
+/* ********************************************************************************************* */
+template <class IntegratorType>
+void checkIntegrator() {
+    const int n = 50;
+    const int nSteps = 100;
+    const double dt = 0.01;
+
+    SpringSystem legacy(n);
+    SpringSystemInPlace inPlace(n);
+    IntegratorType legacyIntegrator, inPlaceIntegrator;
+
+    // warm up the workspaces
+    legacyIntegrator.integrate(&legacy, dt);
+    inPlaceIntegrator.integrate(&inPlace, dt);
+
+#ifdef __GLIBC__
+    gNumAllocations = 0;
+    gCountAllocations = true;
+    for (int i = 1; i < nSteps; i++)
+        inPlaceIntegrator.integrate(&inPlace, dt);
+    gCountAllocations = false;
+    EXPECT_EQ(gNumAllocations, 0);
+#else
+    skipAllocationChecks("in-place integration");
+    for (int i = 1; i < nSteps; i++)
+        inPlaceIntegrator.integrate(&inPlace, dt);
+#endif
+
+    // the systems without the in-place interface give the same result
+    for (int i = 1; i < nSteps; i++)
+        legacyIntegrator.integrate(&legacy, dt);
+    EXPECT_TRUE(legacy.getState() == inPlace.getState());
+}
+
+/* ********************************************************************************************* */
+TEST(INTEGRATION, EULER_NO_ALLOCATIONS) {
+    checkIntegrator<integration::EulerIntegrator>();
+}
+
+/* ********************************************************************************************* */
+TEST(INTEGRATION, RK4_NO_ALLOCATIONS) {
+    checkIntegrator<integration::RK4Integrator>();
+}
+
+/* ********************************************************************************************* */
+TEST(INTEGRATION, DORMAND_PRINCE_NO_ALLOCATIONS) {
+    checkIntegrator<integration::DormandPrinceIntegrator>();
+}
+
+/* ********************************************************************************************* */
+TEST(INTEGRATION, DORMAND_PRINCE_ERROR_ESTIMATE) {
+    const int n = 10;
+    const double dt = 0.05;
+
+    // reference from many small RK4 steps
+    SpringSystemInPlace reference(n);
+    integration::RK4Integrator rk4;
+    for (int i = 0; i < 1000; i++)
+        rk4.integrate(&reference, dt / 1000);
+
+    SpringSystemInPlace system(n);
+    integration::DormandPrinceIntegrator dp;
+    dp.setTolerance(1e-8, 1e-8);
+    double error = dp.step(&system, dt);
+    EXPECT_NEAR((system.getState() - reference.getState()).norm(), 0.0, 1e-6);
+
+    // the estimate shrinks with the fifth power of the step
+    dp.reject(&system);
+    double halfError = dp.step(&system, dt / 2);
+    EXPECT_GT(error, 8.0 * halfError);
+    EXPECT_LT(error, 64.0 * halfError);
+}
+
+/* ********************************************************************************************* */
+TEST(INTEGRATION, WORLD_STATE_NO_ALLOCATIONS) {
+#ifdef __GLIBC__
+    using namespace kinematics;
+    using namespace dynamics;
+
+    FileInfoSkel<SkeletonDynamics> skelFile;
+    bool loadModelResult = skelFile.loadFile(DART_DATA_PATH"skel/fullbody.skel", SKEL);
+    ASSERT_TRUE(loadModelResult);
+    SkeletonDynamics* skel = static_cast<SkeletonDynamics*>(skelFile.getSkel());
+
+    simulation::World world;
+    world.addSkeleton(skel);
+    world.step();
+
+    Eigen::VectorXd state;
+    world.getState(state);
+    gNumAllocations = 0;
+    gCountAllocations = true;
+    world.getState(state);
+    gCountAllocations = false;
+    EXPECT_EQ(gNumAllocations, 0);
+    EXPECT_TRUE(state == world.getState());
+
+    // after the first step has sized the workspaces, a step without contacts
+    // allocates nothing either
+    gNumAllocations = 0;
+    gCountAllocations = true;
+    world.step();
+    gCountAllocations = false;
+    EXPECT_EQ(gNumAllocations, 0);
+
+    // and neither does one of the articulated body algorithm
+    world.setUseArticulatedBody(true);
+    world.step();
+    gNumAllocations = 0;
+    gCountAllocations = true;
+    world.step();
+    gCountAllocations = false;
+    EXPECT_EQ(gNumAllocations, 0);
+#else
+    skipAllocationChecks("World::getState and World::step");
+#endif
+}
+
+/* ********************************************************************************************* */
+int main(int argc, char* argv[]) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+/* ********************************************************************************************* */
@@ -34,6 +34,7 @@
 
 #include "math/UtilsRotation.h"
 #include "math/UtilsMath.h"
+#include "math/UtilsSpatial.h"
 #include <iostream>
 #include <gtest/gtest.h>
 #include <Eigen/Dense>
@@ -93,6 +94,45 @@ TEST(UTILS, UTILS) {
   
 }
 
+/* ********************************************************************************************* */
+TEST(UTILS, SPATIAL) {
+  using namespace math;
+
+  // Random transform of a child frame B relative to a parent frame A
+  Matrix4d T = Matrix4d::Identity();
+  T.topLeftCorner<3,3>() = expMapRot(Vector3d(0.3, -0.7, 1.1));
+  T.topRightCorner<3,1>() = Vector3d(0.5, -1.0, 2.0);
+  SpatialTransform X(T);
+  Matrix6d Xm = X.toMatrix();
+
+  Vector6d v, f;
+  for (int i = 0; i < 6; i++) {
+    v[i] = random(-1.0, 1.0);
+    f[i] = random(-1.0, 1.0);
+  }
+  EXPECT_NEAR((X.apply(v) - Xm * v).norm(), 0.0, M_EPSILON);
+  EXPECT_NEAR((X.applyTranspose(f) - Xm.transpose() * f).norm(), 0.0, M_EPSILON);
+
+  // Compact rigid body inertia against the full matrix
+  Matrix3d Icom;
+  Icom << 2.0, 0.1, 0.2,
+    0.1, 3.0, 0.3,
+    0.2, 0.3, 4.0;
+  SpatialInertia I(1.5, Vector3d(0.1, 0.2, -0.3), Icom);
+  Matrix6d Im = I.toMatrix();
+  EXPECT_NEAR((I * v - Im * v).norm(), 0.0, M_EPSILON);
+  EXPECT_NEAR((X.applyTranspose(I).toMatrix() - Xm.transpose() * Im * Xm).norm(), 0.0, M_EPSILON);
+  EXPECT_NEAR((X.applyCongruence(Im) - Xm.transpose() * Im * Xm).norm(), 0.0, M_EPSILON);
+
+  // Power is invariant under the change of frame
+  EXPECT_NEAR(f.dot(X.apply(v)), X.applyTranspose(f).dot(v), M_EPSILON);
+  // v x* f is the negated transpose of v x
+  Vector6d m;
+  for (int i = 0; i < 6; i++)
+    m[i] = random(-1.0, 1.0);
+  EXPECT_NEAR(f.dot(crossMotion(v, m)), -crossForce(v, f).dot(m), M_EPSILON);
+}
+
 /* ********************************************************************************************* */
 int main(int argc, char* argv[]) {
     ::testing::InitGoogleTest(&argc, argv);
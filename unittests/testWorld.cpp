@@ -0,0 +1,561 @@
+/*
+ * Copyright (c) 2011, Georgia Tech Research Corporation
+ * All rights reserved.
+ *
+ * Geoorgia Tech Graphics Lab and Humanoid Robotics Lab
+ *
+ * Directed by Prof. C. Karen Liu and Prof. Mike Stilman
+ * <karenliu@cc.gatech.edu> <mstilman@cc.gatech.edu>
+ *
+ * This file is provided under the following "BSD-style" License:
+ *   Redistribution and use in source and binary forms, with or
+ *   without modification, are permitted provided that the following
+ *   conditions are met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND
+ *   CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+ *   INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ *   MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ *   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ *   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF
+ *   USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ *   AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *   LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *   ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *   POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "simulation/World.h"
+#include "simulation/BatchWorld.h"
+#include "dynamics/SkeletonDynamics.h"
+#include "dynamics/ConstraintDynamics.h"
+#include "dynamics/BodyNodeDynamics.h"
+#include "collision/fcl_mesh/FCLMESHCollisionDetector.h"
+#include "kinematics/FileInfoSkel.hpp"
+#include "kinematics/Dof.h"
+#include "utils/Paths.h"
+#include "math/UtilsMath.h"
+#include <iostream>
+#include <limits>
+#include <Eigen/Dense>
+#include <gtest/gtest.h>
+
+using namespace std;
+
+/* ********************************************************************************************* */
+dynamics::SkeletonDynamics* prepareWorldSkeleton() {
+    using namespace Eigen;
+    using namespace kinematics;
+    using namespace dynamics;
+
+    FileInfoSkel<SkeletonDynamics> skelFile;
+    bool loadModelResult = skelFile.loadFile(DART_DATA_PATH"skel/fullbody.skel", SKEL);
+    assert(loadModelResult);
+    SkeletonDynamics* skel = static_cast<SkeletonDynamics*>(skelFile.getSkel());
+
+    // bend the joints, leaving the root at rest
+    VectorXd q = skel->getPose();
+    for(int i=6; i<q.size(); i++)
+        q[i] = math::random(-0.8, 0.8);
+    skel->setPose(q, true, true);
+    skel->initDynamics();
+    skel->setMinInternalForces(VectorXd::Constant(q.size(), -10.0));
+    skel->setMaxInternalForces(VectorXd::Constant(q.size(), 10.0));
+    // the loaded skeleton belongs to skelFile
+    return skel->clone();
+}
+
+/* ********************************************************************************************* */
+TEST(WORLD, BATCH_STEP_ALL) {
+    using namespace Eigen;
+    using namespace dynamics;
+    using namespace simulation;
+
+    const int nEnvs = 4;
+    const int nSteps = 20;
+
+    SkeletonDynamics* model = prepareWorldSkeleton();
+    vector<SkeletonDynamics*> skels(1, model);
+    BatchWorld batch;
+    ASSERT_TRUE(batch.init(skels, nEnvs));
+    ASSERT_EQ(batch.getNumEnvironments(), nEnvs);
+    int nDof = batch.getNumDofs();
+    ASSERT_EQ(nDof, model->getNumDofs());
+    ASSERT_EQ(batch.getStates().rows(), 2 * nDof);
+
+    // different initial states and torques
+    MatrixXd states = batch.getStates();
+    MatrixXd forces(nDof, nEnvs);
+    for(int i=0; i<nEnvs; i++) {
+        for(int j=6; j<nDof; j++) {
+            states(j, i) += math::random(-0.1, 0.1);
+            states(nDof + j, i) = math::random(-1.0, 1.0);
+        }
+        for(int j=0; j<nDof; j++)
+            forces(j, i) = j < 6 ? 0.0 : math::random(-5.0, 5.0);
+    }
+    batch.setStates(states);
+    batch.setInternalForces(forces);
+    EXPECT_TRUE(batch.getInternalForces() == forces);
+
+    // the environments are integrated in place in the matrix of states
+    const double* data = batch.getStates().data();
+    batch.stepAll(nSteps);
+    EXPECT_GT(batch.getStepsPerSecond(), 0.0);
+    EXPECT_EQ(batch.getStates().data(), data);
+    EXPECT_FALSE(batch.getStates() == states);
+
+    // each environment matches a world of its own stepped serially
+    for(int i=0; i<nEnvs; i++) {
+        SkeletonDynamics* skel = model->clone();
+        World world;
+        world.addSkeleton(skel);
+        world.setState(states.col(i));
+        skel->setInternalForces(forces.col(i));
+        for(int k=0; k<nSteps; k++)
+            world.step();
+        EXPECT_TRUE(world.getState() == batch.getStates().col(i));
+        EXPECT_TRUE(batch.getEnvironment(i)->getState() == batch.getStates().col(i));
+        delete skel;
+    }
+    delete model;
+}
+
+/* ********************************************************************************************* */
+// Track the zero pose with servos too stiff for explicit forces at a step of 0.01 s.
+// Returns the final tracking error relative to the initial one, or infinity if the
+// state blew up
+double trackWithStiffServos(bool _implicitPD, double* _finalSpeed) {
+    using namespace Eigen;
+    using namespace dynamics;
+    using namespace simulation;
+
+    const double dt = 0.01;
+    SkeletonDynamics* skel = prepareWorldSkeleton();
+    int nDof = skel->getNumDofs();
+    VectorXd kp = VectorXd::Constant(nDof, 5000.0);
+    VectorXd kd = VectorXd::Constant(nDof, 50.0);
+    kp.head(6).setZero();
+    kd.head(6).setZero();
+    VectorXd target = skel->getPose();
+    target.tail(nDof - 6).setZero();
+    skel->setPDGains(kp, kd);
+    skel->setPDTarget(target);
+    double initialError = (skel->getPose() - target).tail(nDof - 6).norm();
+
+    World world;
+    world.setGravity(Vector3d::Zero());
+    world.setTimeStep(dt);
+    world.addSkeleton(skel);
+    world.setUseImplicitPD(_implicitPD);
+    world.setState(world.getState());
+    for(int i=0; i<200; i++)
+        world.step();
+
+    double ratio = (skel->getPose() - target).tail(nDof - 6).norm() / initialError;
+    VectorXd state = world.getState();
+    for(int i=0; i<state.size(); i++) {
+        if (!(std::abs(state[i]) < 1e10))
+            ratio = std::numeric_limits<double>::infinity();
+    }
+    *_finalSpeed = skel->getPoseVelocity().tail(nDof - 6).norm();
+    delete skel;
+    return ratio;
+}
+
+/* ********************************************************************************************* */
+TEST(WORLD, IMPLICIT_PD_LARGE_STEP) {
+    EXPECT_TRUE(simulation::World().getUseImplicitPD());
+
+    double speed;
+    double implicitRatio = trackWithStiffServos(true, &speed);
+    EXPECT_LT(implicitRatio, 0.25);
+    EXPECT_LT(speed, 1.0);
+
+    // the same servos evaluated explicitly diverge or at least miss the bound
+    double explicitRatio = trackWithStiffServos(false, &speed);
+    EXPECT_FALSE(explicitRatio < 0.25);
+}
+
+/* ********************************************************************************************* */
+TEST(WORLD, ADAPTIVE_TIME_STEP) {
+    using namespace Eigen;
+    using namespace dynamics;
+    using namespace simulation;
+
+    const double duration = 0.1;
+    SkeletonDynamics* skel = prepareWorldSkeleton();
+    skel->setJointLimitState(false);
+    int nDof = skel->getNumDofs();
+
+    SkeletonDynamics* refSkel = skel->clone();
+
+    World world;
+    world.addSkeleton(skel);
+    VectorXd state = world.getState();
+    for(int i=6; i<nDof; i++)
+        state[nDof + i] = math::random(-1.0, 1.0);
+    world.setState(state);
+
+    world.setAdaptiveTimeStep(true);
+    world.setTolerance(1e-4);
+    world.resetStepStatistics();
+    world.step(duration);
+    EXPECT_NEAR(world.getTime(), duration, 1e-12);
+
+    // far fewer steps than the fixed 1 ms ones, each with seven evaluations
+    int nFixedSteps = duration / world.getTimeStep();
+    EXPECT_LT(world.getNumAcceptedSteps(), nFixedSteps);
+    EXPECT_GT(world.getEffectiveTimeStep(), world.getTimeStep());
+    EXPECT_EQ(world.getNumDerivEvals(),
+              7 * (world.getNumAcceptedSteps() + world.getNumRejectedSteps()));
+
+    // the fixed steps converge to the same state at first order; at 0.02 ms
+    // they are well within the tolerance of it
+    World refWorld;
+    refWorld.addSkeleton(refSkel);
+    refWorld.setTimeStep(2e-5);
+    refWorld.setState(state);
+    for(int i=0; i<5000; i++)
+        refWorld.step();
+    VectorXd adaptiveState = world.getState();
+    VectorXd refState = refWorld.getState();
+    for(int i=0; i<adaptiveState.size(); i++)
+        EXPECT_NEAR(adaptiveState[i], refState[i], world.getTolerance());
+    delete skel;
+    delete refSkel;
+}
+
+/* ********************************************************************************************* */
+TEST(WORLD, PARALLEL_SKELETONS) {
+    using namespace Eigen;
+    using namespace dynamics;
+    using namespace simulation;
+
+    const int nSkels = 6;
+
+    SkeletonDynamics* model = prepareWorldSkeleton();
+    vector<SkeletonDynamics*> serialSkels, parallelSkels;
+    World serialWorld, parallelWorld;
+    parallelWorld.setNumThreads(4);
+    for(int i=0; i<nSkels; i++) {
+        serialSkels.push_back(model->clone());
+        parallelSkels.push_back(model->clone());
+        serialWorld.addSkeleton(serialSkels.back());
+        parallelWorld.addSkeleton(parallelSkels.back());
+    }
+
+    VectorXd state = serialWorld.getState();
+    for(int i=0; i<state.size(); i++)
+        state[i] += math::random(-0.1, 0.1);
+
+    // the same results, bit for bit, whatever the number of threads
+    serialWorld.setState(state);
+    parallelWorld.setState(state);
+    EXPECT_TRUE(serialWorld.evalDeriv() == parallelWorld.evalDeriv());
+    for(int k=0; k<10; k++) {
+        serialWorld.step();
+        parallelWorld.step();
+    }
+    EXPECT_TRUE(serialWorld.getState() == parallelWorld.getState());
+
+    for(int i=0; i<nSkels; i++) {
+        delete serialSkels[i];
+        delete parallelSkels[i];
+    }
+    delete model;
+}
+
+/* ********************************************************************************************* */
+// A ground with two stacks of two cubes far apart and a cube in the air
+void prepareCubeWorld(simulation::World& _world,
+                      kinematics::FileInfoSkel<dynamics::SkeletonDynamics>* _files) {
+    using namespace Eigen;
+    using namespace kinematics;
+    using namespace dynamics;
+
+    _files[0].loadFile(DART_DATA_PATH"skel/ground1.skel", SKEL);
+    for(int i=1; i<6; i++)
+        _files[i].loadFile(DART_DATA_PATH"skel/cube1.skel", SKEL);
+    _world.setGravity(Vector3d(0.0, -9.81, 0.0));
+    SkeletonDynamics* ground = static_cast<SkeletonDynamics*>(_files[0].getSkel());
+    ground->setImmobileState(true);
+    _world.addSkeleton(ground);
+    for(int i=1; i<6; i++)
+        _world.addSkeleton(static_cast<SkeletonDynamics*>(_files[i].getSkel()));
+
+    VectorXd pose = ground->getPose();
+    pose[1] = -0.35;
+    ground->setPose(pose);
+    // slightly sunk so that the contacts exist from the first step
+    double x[5] = {-0.5, -0.5, 0.5, 0.5, 0.0};
+    double y[5] = {-0.326, -0.277, -0.326, -0.277, 0.5};
+    for(int i=0; i<5; i++) {
+        pose = _world.getSkeleton(i + 1)->getPose();
+        pose[0] = x[i];
+        pose[1] = y[i];
+        _world.getSkeleton(i + 1)->setPose(pose);
+    }
+}
+
+/* ********************************************************************************************* */
+TEST(WORLD, CONTACT_ISLANDS) {
+    using namespace Eigen;
+    using namespace kinematics;
+    using namespace dynamics;
+    using namespace simulation;
+
+    FileInfoSkel<SkeletonDynamics> serialFiles[6], parallelFiles[6];
+    World serialWorld, parallelWorld;
+    prepareCubeWorld(serialWorld, serialFiles);
+    prepareCubeWorld(parallelWorld, parallelFiles);
+    parallelWorld.getCollisionHandle()->setNumThreads(2);
+
+    for(int k=0; k<10; k++) {
+        serialWorld.step();
+        parallelWorld.step();
+    }
+
+    // one island per stack; the ground and the falling cube are in none
+    EXPECT_EQ(serialWorld.getCollisionHandle()->getNumIslands(), 2);
+    EXPECT_GT(serialWorld.getCollisionHandle()->getNumContacts(), 0);
+    EXPECT_TRUE(serialWorld.getCollisionHandle()->getContactForce(5).isZero());
+    EXPECT_FALSE(serialWorld.getCollisionHandle()->getContactForce(1).isZero());
+    EXPECT_FALSE(serialWorld.getCollisionHandle()->getContactForce(3).isZero());
+
+    // the islands solved in parallel give the same result
+    EXPECT_EQ(parallelWorld.getCollisionHandle()->getNumIslands(), 2);
+    EXPECT_TRUE(serialWorld.getState() == parallelWorld.getState());
+}
+
+/* ********************************************************************************************* */
+TEST(WORLD, SPARSE_LCP_MATRIX) {
+    using namespace Eigen;
+    using namespace kinematics;
+    using namespace dynamics;
+    using namespace simulation;
+
+    const double TOLERANCE_EXACT = 1.0e-8;
+    FileInfoSkel<SkeletonDynamics> sparseFiles[6], denseFiles[6];
+    World sparseWorld, denseWorld;
+    prepareCubeWorld(sparseWorld, sparseFiles);
+    prepareCubeWorld(denseWorld, denseFiles);
+    EXPECT_TRUE(sparseWorld.getCollisionHandle()->getSparseLCPMatrix());
+    denseWorld.getCollisionHandle()->setSparseLCPMatrix(false);
+
+    // the LCP matrix assembled per cube is the one from the products over
+    // all the dofs of the island
+    for(int k=0; k<10; k++) {
+        sparseWorld.step();
+        denseWorld.step();
+    }
+    EXPECT_GT(sparseWorld.getCollisionHandle()->getNumContacts(), 0);
+    VectorXd sparseState = sparseWorld.getState();
+    VectorXd denseState = denseWorld.getState();
+    for(int i=0; i<sparseState.size(); i++)
+        EXPECT_NEAR(sparseState[i], denseState[i], TOLERANCE_EXACT);
+
+    // the same with joint limits: a body with dofs pushed past both bounds
+    // and still moving outward
+    SkeletonDynamics* model = prepareWorldSkeleton();
+    int nDof = model->getNumDofs();
+    VectorXd state = VectorXd::Zero(2 * nDof);
+    state.head(nDof) = model->getPose();
+    for(int i=6; i<nDof; i+=5) {
+        state[i] = model->getDof(i)->getMax() + 0.01;
+        state[nDof + i] = 1.0;
+    }
+    for(int i=8; i<nDof; i+=7) {
+        state[i] = model->getDof(i)->getMin() - 0.01;
+        state[nDof + i] = -1.0;
+    }
+    SkeletonDynamics* sparseSkel = model->clone();
+    SkeletonDynamics* denseSkel = model->clone();
+    World sparseLimitWorld, denseLimitWorld;
+    sparseLimitWorld.addSkeleton(sparseSkel);
+    denseLimitWorld.addSkeleton(denseSkel);
+    sparseLimitWorld.setState(state);
+    denseLimitWorld.setState(state);
+    denseLimitWorld.getCollisionHandle()->setSparseLCPMatrix(false);
+    sparseLimitWorld.step();
+    denseLimitWorld.step();
+    EXPECT_GT(sparseLimitWorld.getCollisionHandle()->getNumIslands(), 0);
+    EXPECT_FALSE(sparseLimitWorld.getCollisionHandle()->getTotalConstraintForce(0).isZero());
+    for(int k=1; k<10; k++) {
+        sparseLimitWorld.step();
+        denseLimitWorld.step();
+    }
+    sparseState = sparseLimitWorld.getState();
+    denseState = denseLimitWorld.getState();
+    for(int i=0; i<sparseState.size(); i++)
+        EXPECT_NEAR(sparseState[i], denseState[i], TOLERANCE_EXACT);
+    delete model;
+    delete sparseSkel;
+    delete denseSkel;
+}
+
+/* ********************************************************************************************* */
+TEST(WORLD, ITERATIVE_LCP) {
+    using namespace Eigen;
+    using namespace kinematics;
+    using namespace dynamics;
+    using namespace simulation;
+
+    const double TOLERANCE_POSE = 1.0e-5;
+    const double TOLERANCE_VELOCITY = 1.0e-3;
+    const double MAX_PENETRATION = 0.002; // the cubes start sunk by 0.001
+    FileInfoSkel<SkeletonDynamics> pivotingFiles[6], iterativeFiles[6];
+    World pivotingWorld, iterativeWorld;
+    prepareCubeWorld(pivotingWorld, pivotingFiles);
+    prepareCubeWorld(iterativeWorld, iterativeFiles);
+    iterativeWorld.getCollisionHandle()->setIterativeLCP(true);
+    iterativeWorld.getCollisionHandle()->setPGSParameters(1000, 1.0e-10, 1.0);
+
+    for(int k=0; k<100; k++) {
+        pivotingWorld.step();
+        iterativeWorld.step();
+    }
+    ConstraintDynamics* handle = iterativeWorld.getCollisionHandle();
+    ASSERT_EQ(handle->getNumIslands(), 2);
+    EXPECT_GT(handle->getNumLCPIterations(), 0);
+
+    // the stacked cubes rest on what is under them without sinking into it,
+    // where the pivoting solver leaves them
+    double groundTop = iterativeWorld.getSkeleton(0)->getPose()[1];
+    for(int i=1; i<5; i++) {
+        SkeletonDynamics* cube = iterativeWorld.getSkeleton(i);
+        double support = i % 2 ? groundTop : iterativeWorld.getSkeleton(i - 1)->getPose()[1] + 0.025;
+        EXPECT_GT(cube->getPose()[1] - 0.025, support - MAX_PENETRATION);
+        EXPECT_FALSE(handle->getContactForce(i).isZero());
+        EXPECT_LT(cube->getPoseVelocity().norm(), TOLERANCE_VELOCITY);
+        VectorXd pose = cube->getPose();
+        VectorXd pivotingPose = pivotingWorld.getSkeleton(i)->getPose();
+        for(int j=0; j<pose.size(); j++)
+            EXPECT_NEAR(pose[j], pivotingPose[j], TOLERANCE_POSE);
+    }
+}
+
+/* ********************************************************************************************* */
+// Transpose of the Jacobian of the body point p over all the dofs of the skeleton, from
+// the derivatives of the world transform of the node
+Eigen::MatrixXd getDerivJacobian(kinematics::BodyNode* _node, const Eigen::Vector3d& _p) {
+    using namespace Eigen;
+
+    MatrixXd Jt = MatrixXd::Zero(_node->getSkel()->getNumDofs(), 3);
+    Vector3d localP = math::xformHom(_node->getWorldInvTransform(), _p);
+    for(int i=0; i<_node->getNumDependentDofs(); i++)
+        Jt.row(_node->getDependentDof(i)) = math::xformHom(_node->getDerivWorldTransform(i), localP);
+    return Jt;
+}
+
+/* ********************************************************************************************* */
+TEST(WORLD, CONTACT_JACOBIANS) {
+    using namespace Eigen;
+    using namespace kinematics;
+    using namespace dynamics;
+    using namespace simulation;
+
+    const double TOLERANCE_EXACT = 1.0e-10;
+
+    // the rows from Jv + Jw x (p - COM) are those from the derivatives of the
+    // world transform
+    SkeletonDynamics* skel = prepareWorldSkeleton();
+    World world;
+    world.addSkeleton(skel);
+    for(int i=0; i<skel->getNumNodes(); i++) {
+        BodyNode* node = skel->getNode(i);
+        Vector3d p = node->getWorldCOM() + Vector3d(math::random(-0.1, 0.1), math::random(-0.1, 0.1), math::random(-0.1, 0.1));
+        MatrixXd Jt = world.getCollisionHandle()->getJacobian(node, p);
+        MatrixXd JtRef = getDerivJacobian(node, p);
+        ASSERT_EQ(Jt.rows(), node->getNumDependentDofs());
+        for(int j=0; j<node->getNumDependentDofs(); j++)
+            for(int k=0; k<3; k++)
+                EXPECT_NEAR(Jt(j, k), JtRef(node->getDependentDof(j), k), TOLERANCE_EXACT);
+    }
+    delete skel;
+
+    // a chain folded into a square so that its fourth link crosses the first:
+    // the contact forces on both sides add up in the dofs of the chain
+    FileInfoSkel<SkeletonDynamics> chainFile;
+    ASSERT_TRUE(chainFile.loadFile(DART_DATA_PATH"skel/Chain.skel", SKEL));
+    SkeletonDynamics* chain = static_cast<SkeletonDynamics*>(chainFile.getSkel());
+    chain->initDynamics();
+    World chainWorld;
+    chainWorld.addSkeleton(chain);
+    static_cast<collision::FCLMESHCollisionDetector*>(chainWorld.getCollisionHandle()->getCollisionChecker())
+            ->activatePair(chain->getNode(0), chain->getNode(3));
+    int nDof = chain->getNumDofs();
+    VectorXd state = chainWorld.getState();
+    for(int i=1; i<=3; i++)
+        state[3 * i + 2] = M_PI / 2; // about z at the joints of the second to fourth links
+    state[nDof + 11] = 1.0; // the fourth link swinging into the first
+    chainWorld.setState(state);
+    chainWorld.evalDeriv();
+
+    ConstraintDynamics* handle = chainWorld.getCollisionHandle();
+    ASSERT_GT(handle->getNumContacts(), 0);
+    VectorXd expected = VectorXd::Zero(nDof);
+    for(int i=0; i<handle->getNumContacts(); i++) {
+        collision::Contact& contact = handle->getCollisionChecker()->getContact(i);
+        BodyNode* node1 = contact.collisionNode1->getBodyNode();
+        BodyNode* node2 = contact.collisionNode2->getBodyNode();
+        expected += (getDerivJacobian(node1, contact.point) - getDerivJacobian(node2, contact.point)) * contact.force;
+    }
+    EXPECT_FALSE(expected.isZero());
+    VectorXd contactForce = handle->getContactForce(0);
+    for(int i=0; i<nDof; i++)
+        EXPECT_NEAR(contactForce[i], expected[i], TOLERANCE_EXACT);
+}
+
+/* ********************************************************************************************* */
+TEST(WORLD, SLEEPING) {
+    using namespace Eigen;
+    using namespace kinematics;
+    using namespace dynamics;
+    using namespace simulation;
+
+    FileInfoSkel<SkeletonDynamics> files[6];
+    World world;
+    prepareCubeWorld(world, files);
+    world.setSleeping(true);
+    world.setSleepThreshold(0.1, 0.05);
+
+    for(int k=0; k<200; k++)
+        world.step();
+
+    // both stacks are at rest, the falling cube is not
+    EXPECT_EQ(world.getNumSleepingSkeletons(), 4);
+    EXPECT_FALSE(world.getSkeleton(5)->isAsleep());
+    EXPECT_TRUE(world.getSkeleton(1)->getPoseVelocity().isZero());
+
+    // sleeping skeletons do not move
+    VectorXd pose = world.getSkeleton(1)->getPose();
+    world.step();
+    EXPECT_TRUE(world.getSkeleton(1)->getPose() == pose);
+
+    // pushing the top cube of the first stack wakes it, and it wakes the
+    // cube under it; the other stack sleeps on
+    static_cast<BodyNodeDynamics*>(world.getSkeleton(2)->getNode(0))->addExtForce(Vector3d::Zero(), Vector3d(0.0, 1.0, 0.0));
+    EXPECT_FALSE(world.getSkeleton(2)->isAsleep());
+    world.step();
+    EXPECT_FALSE(world.getSkeleton(1)->isAsleep());
+    EXPECT_TRUE(world.getSkeleton(3)->isAsleep());
+    EXPECT_TRUE(world.getSkeleton(4)->isAsleep());
+
+    world.setSleeping(false);
+    EXPECT_EQ(world.getNumSleepingSkeletons(), 0);
+}
+
+/* ********************************************************************************************* */
+int main(int argc, char* argv[]) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+/* ********************************************************************************************* */